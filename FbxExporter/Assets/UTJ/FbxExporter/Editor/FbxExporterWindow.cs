@@ -70,8 +70,11 @@ namespace UTJ.FbxExporter
                 if (record.exporter.IsFinished())
                 {
                     var elapsed = DateTime.Now - record.started;
+                    var stats = record.exporter.GetStats();
                     record.exporter.Release();
                     Debug.Log("Export finished: " + record.path + " (" + elapsed.TotalSeconds + " seconds)");
+                    if (stats.num_tested_triangles > 0)
+                        Debug.Log("Hidden triangles removed: " + stats.num_removed_triangles + " / " + stats.num_tested_triangles);
                     finished = true;
                 }
             }
@@ -113,6 +116,34 @@ namespace UTJ.FbxExporter
             }
             m_opt.scale_factor = EditorGUILayout.FloatField("Scale Factor", m_opt.scale_factor);
             m_opt.system_unit = (FbxExporter.SystemUnit)EditorGUILayout.EnumPopup("System Unit", m_opt.system_unit);
+            m_opt.optimize_vertex_order = EditorGUILayout.Toggle("Optimize Vertex Order", m_opt.optimize_vertex_order);
+            if (m_opt.optimize_vertex_order)
+            {
+                EditorGUI.indentLevel++;
+                m_opt.vertex_cache_size = EditorGUILayout.IntField("Vertex Cache Size", m_opt.vertex_cache_size);
+                EditorGUI.indentLevel--;
+            }
+            m_opt.generate_normals = EditorGUILayout.Toggle("Generate Missing Normals", m_opt.generate_normals);
+            m_opt.generate_tangents = EditorGUILayout.Toggle("Generate Missing Tangents", m_opt.generate_tangents);
+            m_opt.lod_levels = EditorGUILayout.IntSlider("LOD Levels", m_opt.lod_levels, 0, FbxExporter.MaxLODLevels);
+            if (m_opt.lod_levels > 0)
+            {
+                EditorGUI.indentLevel++;
+                for (int i = 0; i < m_opt.lod_levels; ++i)
+                    m_opt.lod_ratios[i] = EditorGUILayout.Slider("LOD" + (i + 1) + " Ratio", m_opt.lod_ratios[i], 0.0f, 1.0f);
+                EditorGUI.indentLevel--;
+            }
+            m_opt.remove_hidden_triangles = EditorGUILayout.Toggle("Remove Hidden Triangles", m_opt.remove_hidden_triangles);
+            if (m_opt.remove_hidden_triangles)
+            {
+                EditorGUI.indentLevel++;
+                m_opt.hidden_test_rays = EditorGUILayout.IntField("Rays Per Triangle", m_opt.hidden_test_rays);
+                EditorGUI.indentLevel--;
+            }
+            m_opt.terrain_max_error = EditorGUILayout.FloatField("Terrain Max Error", m_opt.terrain_max_error);
+            m_opt.terrain_tile_size = EditorGUILayout.IntField("Terrain Tile Size", m_opt.terrain_tile_size);
+            m_opt.keep_colors_8bit = EditorGUILayout.Toggle("Keep 8 bit Colors", m_opt.keep_colors_8bit);
+            m_opt.max_bone_influences = EditorGUILayout.IntField("Max Bone Influences", m_opt.max_bone_influences);
 
             EditorGUILayout.Space();
 
@@ -1,5 +1,6 @@
 using System;
 using System.Collections.Generic;
+using System.Runtime.InteropServices;
 using UnityEngine;
 
 namespace UTJ.FbxExporter
@@ -10,6 +11,12 @@ namespace UTJ.FbxExporter
         Context m_ctx;
         Dictionary<Transform, Node> m_nodes;
 
+        // meshes found while walking a tree are passed to fbxeAddMeshes() at once.
+        // the arrays they point to must stay pinned until then.
+        List<MeshDesc> m_meshDescs = new List<MeshDesc>();
+        List<IDisposable> m_pinned = new List<IDisposable>();
+        List<KeyValuePair<IntPtr, int>> m_frameDescs = new List<KeyValuePair<IntPtr, int>>();
+
         public FbxExporter(ExportOptions opt)
         {
             m_opt = opt;
@@ -38,7 +45,10 @@ namespace UTJ.FbxExporter
         public void AddNode(GameObject go)
         {
             if (go)
+            {
                 FindOrCreateNodeTree(go.GetComponent<Transform>(), ProcessNode);
+                FlushMeshes();
+            }
         }
 
         public bool WriteAsync(string path, Format format)
@@ -51,6 +61,13 @@ namespace UTJ.FbxExporter
             return fbxeIsFinished(m_ctx);
         }
 
+        public ExportStats GetStats()
+        {
+            var ret = default(ExportStats);
+            fbxeGetStats(m_ctx, ref ret);
+            return ret;
+        }
+
 
         #region impl
         void ProcessNode(Transform trans, Node node)
@@ -88,7 +105,13 @@ namespace UTJ.FbxExporter
             }
         }
 
-        bool AddMesh(Node node, Mesh mesh)
+        T Pin<T>(T v) where T : IDisposable
+        {
+            m_pinned.Add(v);
+            return v;
+        }
+
+        bool SetupMeshDesc(Node node, Mesh mesh, ref MeshDesc desc)
         {
             if (!mesh || mesh.vertexCount == 0) { return false; }
             if (!mesh.isReadable)
@@ -97,36 +120,61 @@ namespace UTJ.FbxExporter
                 return false;
             }
 
-            Topology topology = Topology.Triangles;
-
-            var indices = new PinnedArray<int>(mesh.triangles);
-            var points = new PinnedArray<Vector3>(mesh.vertices);
-            var normals = new PinnedArray<Vector3>(mesh.normals); if (normals.Length == 0) normals = null;
-            var tangents = new PinnedArray<Vector4>(mesh.tangents); if (tangents.Length == 0) tangents = null;
-            var uv = new PinnedArray<Vector2>(mesh.uv); if (uv.Length == 0) uv = null;
-            var colors = new PinnedArray<Color>(mesh.colors); if (colors.Length == 0) colors = null;
-            fbxeAddMesh(m_ctx, node, points.Length, points, normals, tangents, uv, colors);
-            fbxeAddMeshSubmesh(m_ctx, node, topology, indices.Length, indices, -1);
+            var indices = Pin(new PinnedArray<int>(mesh.triangles));
+            var submeshes = Pin(new PinnedArray<SubmeshDesc>(1));
+            submeshes[0] = new SubmeshDesc {
+                topology = Topology.Triangles,
+                num_indices = indices.Length,
+                indices = indices,
+                material = -1,
+            };
+
+            var points = Pin(new PinnedArray<Vector3>(mesh.vertices));
+            desc.node = node;
+            desc.num_vertices = points.Length;
+            desc.points = points;
+            desc.normals = Pin(new PinnedArray<Vector3>(mesh.normals));
+            desc.tangents = Pin(new PinnedArray<Vector4>(mesh.tangents));
+            desc.uv = Pin(new PinnedArray<Vector2>(mesh.uv));
+            // colors are passed as 8 bit. the native side keeps or unpacks them depending on keep_colors_8bit
+            desc.colors32 = Pin(new PinnedArray<Color32>(mesh.colors32));
+            desc.num_submeshes = 1;
+            desc.submeshes = submeshes;
 
             int blendshapeCount = mesh.blendShapeCount;
             if (blendshapeCount > 0)
             {
-                var deltaVertices = new PinnedArray<Vector3>(mesh.vertexCount);
-                var deltaNormals = new PinnedArray<Vector3>(mesh.vertexCount);
-                var deltaTangents = new PinnedArray<Vector3>(mesh.vertexCount);
+                var frames = new List<BlendShapeFrameDesc>();
                 for (int bi = 0; bi < blendshapeCount; ++bi)
                 {
                     string name = mesh.GetBlendShapeName(bi);
                     int frameCount = mesh.GetBlendShapeFrameCount(bi);
                     for (int fi = 0; fi < frameCount; ++fi)
                     {
-                        float weight = mesh.GetBlendShapeFrameWeight(bi, fi);
+                        // each frame needs its own buffers as they are copied only when the batch is added
+                        var deltaVertices = Pin(new PinnedArray<Vector3>(mesh.vertexCount));
+                        var deltaNormals = Pin(new PinnedArray<Vector3>(mesh.vertexCount));
+                        var deltaTangents = Pin(new PinnedArray<Vector3>(mesh.vertexCount));
                         mesh.GetBlendShapeFrameVertices(bi, fi, deltaVertices, deltaNormals, deltaTangents);
-                        fbxeAddMeshBlendShape(m_ctx, node, name, weight, deltaVertices, deltaNormals, deltaTangents);
+                        frames.Add(new BlendShapeFrameDesc {
+                            name = name,
+                            weight = mesh.GetBlendShapeFrameWeight(bi, fi),
+                            delta_points = deltaVertices,
+                            delta_normals = deltaNormals,
+                            delta_tangents = deltaTangents,
+                        });
                     }
                 }
-            }
 
+                // BlendShapeFrameDesc has a string and can't be pinned. marshal it to native memory instead.
+                int size = Marshal.SizeOf(typeof(BlendShapeFrameDesc));
+                var ptr = Marshal.AllocHGlobal(size * frames.Count);
+                for (int fi = 0; fi < frames.Count; ++fi)
+                    Marshal.StructureToPtr(frames[fi], new IntPtr(ptr.ToInt64() + size * fi), false);
+                m_frameDescs.Add(new KeyValuePair<IntPtr, int>(ptr, frames.Count));
+                desc.num_blendshape_frames = frames.Count;
+                desc.blendshape_frames = ptr;
+            }
             return true;
         }
 
@@ -135,25 +183,53 @@ namespace UTJ.FbxExporter
             var mf = mr.gameObject.GetComponent<MeshFilter>();
             if (!mf)
                 return false;
-            return AddMesh(node, mf.sharedMesh);
+
+            var desc = MeshDesc.defaultValue;
+            if (!SetupMeshDesc(node, mf.sharedMesh, ref desc))
+                return false;
+            m_meshDescs.Add(desc);
+            return true;
         }
 
         bool AddSkinnedMesh(Node node, SkinnedMeshRenderer smr)
         {
             var mesh = smr.sharedMesh;
-            if (!AddMesh(node, mesh))
+            var desc = MeshDesc.defaultValue;
+            if (!SetupMeshDesc(node, mesh, ref desc))
                 return false;
 
             var bones = smr.bones;
-            var boneNodes = new PinnedArray<Node>(bones.Length);
+            var boneNodes = Pin(new PinnedArray<Node>(bones.Length));
             for (int bi = 0; bi < bones.Length; ++bi)
                 boneNodes[bi] = FindOrCreateNodeTree(bones[bi], ProcessNode);
-            var boneWeights = new PinnedArray<BoneWeight>(mesh.boneWeights);
-            var bindposes = new PinnedArray<Matrix4x4>(mesh.bindposes);
-            fbxeAddMeshSkin(m_ctx, node, boneWeights, boneNodes.Length, boneNodes, bindposes);
+            desc.num_bones = boneNodes.Length;
+            desc.weights = Pin(new PinnedArray<BoneWeight>(mesh.boneWeights));
+            desc.bones = boneNodes;
+            desc.bindposes = Pin(new PinnedArray<Matrix4x4>(mesh.bindposes));
+            m_meshDescs.Add(desc);
             return true;
         }
 
+        void FlushMeshes()
+        {
+            if (m_meshDescs.Count > 0)
+                fbxeAddMeshes(m_ctx, m_meshDescs.ToArray(), m_meshDescs.Count, null);
+            m_meshDescs.Clear();
+
+            foreach (var p in m_pinned)
+                p.Dispose();
+            m_pinned.Clear();
+
+            int size = Marshal.SizeOf(typeof(BlendShapeFrameDesc));
+            foreach (var kvp in m_frameDescs)
+            {
+                for (int fi = 0; fi < kvp.Value; ++fi)
+                    Marshal.DestroyStructure(new IntPtr(kvp.Key.ToInt64() + size * fi), typeof(BlendShapeFrameDesc));
+                Marshal.FreeHGlobal(kvp.Key);
+            }
+            m_frameDescs.Clear();
+        }
+
         bool AddTerrain(Node node, Terrain terrain)
         {
             var tdata = terrain.terrainData;
@@ -161,19 +237,8 @@ namespace UTJ.FbxExporter
             var h = tdata.heightmapHeight;
             var heightmap = tdata.GetHeights(0, 0, w, h);
 
-            int vertexCount = w * h;
-            int indexCount = (w - 1) * (h - 1) * 2 * 3;
-            var vertices = new PinnedArray<Vector3>(vertexCount);
-            var normals = new PinnedArray<Vector3>(vertexCount);
-            var uv = new PinnedArray<Vector2>(vertexCount);
-            var indices = new PinnedArray<int>(indexCount);
-            fbxeGenerateTerrainMesh(heightmap, w, h, tdata.size,
-                vertices, normals, uv, indices);
-
-            Topology topology = Topology.Triangles;
-            fbxeAddMesh(m_ctx, node, vertices.Length, vertices, normals, IntPtr.Zero, uv, IntPtr.Zero);
-            fbxeAddMeshSubmesh(m_ctx, node, topology, indices.Length, indices, -1);
-
+            // the mesh is generated (and simplified if terrain_max_error > 0) on the native side
+            fbxeAddTerrain(m_ctx, node, heightmap, w, h, tdata.size);
             return true;
         }
         #endregion
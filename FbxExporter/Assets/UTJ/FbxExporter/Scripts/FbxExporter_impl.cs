@@ -6,6 +6,8 @@ namespace UTJ.FbxExporter
 {
     public partial class FbxExporter
     {
+        public const int MaxLODLevels = 4;
+
         public struct Context
         {
             public IntPtr ptr;
@@ -44,6 +46,17 @@ namespace UTJ.FbxExporter
             Quads,
         };
 
+        public enum VertexFormat
+        {
+            Unknown,
+            V3N3,
+            V3N3C4,
+            V3N3U2,
+            V3N3C4U2,
+            V3N3U2T4,
+            V3N3C4U2T4,
+        };
+
         public struct ExportOptions
         {
             public bool flip_handedness;
@@ -53,6 +66,20 @@ namespace UTJ.FbxExporter
             public float quadify_threshold_angle;
             public float scale_factor;
             public SystemUnit system_unit;
+            public bool optimize_vertex_order;
+            public int vertex_cache_size;
+            public int num_threads;
+            public bool generate_normals;
+            public bool generate_tangents;
+            public int lod_levels;
+            [MarshalAs(UnmanagedType.ByValArray, SizeConst = MaxLODLevels)]
+            public float[] lod_ratios;
+            public bool remove_hidden_triangles;
+            public int hidden_test_rays;
+            public float terrain_max_error;
+            public int terrain_tile_size;
+            public bool keep_colors_8bit;
+            public int max_bone_influences;
             public bool transform;
 
             public static ExportOptions defaultValue
@@ -67,6 +94,19 @@ namespace UTJ.FbxExporter
                         quadify_threshold_angle = 20.0f,
                         scale_factor = 1.0f,
                         system_unit = SystemUnit.Meter,
+                        optimize_vertex_order = false,
+                        vertex_cache_size = 32,
+                        num_threads = 0,
+                        generate_normals = false,
+                        generate_tangents = false,
+                        lod_levels = 0,
+                        lod_ratios = new float[MaxLODLevels] { 0.5f, 0.25f, 0.125f, 0.0625f },
+                        remove_hidden_triangles = false,
+                        hidden_test_rays = 64,
+                        terrain_max_error = 0.0f,
+                        terrain_tile_size = 0,
+                        keep_colors_8bit = false,
+                        max_bone_influences = 0,
                         transform = true,
                     };
                 }
@@ -75,12 +115,85 @@ namespace UTJ.FbxExporter
 
 
 
+        public struct ExportStats
+        {
+            public int num_tested_triangles;
+            public int num_removed_triangles;
+        };
+
+        public struct SubmeshDesc
+        {
+            public Topology topology;
+            public int num_indices;
+            public IntPtr indices;
+            public int material;
+            public IntPtr indices16;
+        };
+
+        public struct BlendShapeFrameDesc
+        {
+            public string name;
+            public float weight;
+            public IntPtr delta_points;
+            public IntPtr delta_normals;
+            public IntPtr delta_tangents;
+        };
+
+        public struct MeshDesc
+        {
+            public Node node;
+            public string name;
+            public int parent;
+            public Node parent_node;
+            public bool set_trs;
+            public Vector3 t;
+            public Quaternion r;
+            public Vector3 s;
+
+            public int num_vertices;
+            public IntPtr points;
+            public IntPtr normals;
+            public IntPtr tangents;
+            public IntPtr uv;
+            public IntPtr colors;
+            public IntPtr colors32;
+
+            public int num_submeshes;
+            public IntPtr submeshes;
+
+            public int num_bones;
+            public IntPtr weights;
+            public IntPtr weight_counts;
+            public IntPtr bone_indices;
+            public IntPtr bone_weights;
+            public IntPtr bones;
+            public IntPtr bindposes;
+
+            public int num_blendshape_frames;
+            public IntPtr blendshape_frames;
+
+            public static MeshDesc defaultValue
+            {
+                get
+                {
+                    return new MeshDesc {
+                        parent = -1,
+                        set_trs = true,
+                        r = Quaternion.identity,
+                        s = Vector3.one,
+                    };
+                }
+            }
+        };
+
+
         [DllImport("FbxExporterCore")] static extern Context fbxeCreateContext(ref ExportOptions opt);
         [DllImport("FbxExporterCore")] static extern void fbxeReleaseContext(Context ctx);
 
         [DllImport("FbxExporterCore")] static extern bool fbxeCreateScene(Context ctx, string name);
         [DllImport("FbxExporterCore")] static extern bool fbxeWriteAsync(Context ctx, string path, Format format);
         [DllImport("FbxExporterCore")] static extern bool fbxeIsFinished(Context ctx);
+        [DllImport("FbxExporterCore")] static extern void fbxeGetStats(Context ctx, ref ExportStats dst);
 
         [DllImport("FbxExporterCore")] static extern Node fbxeGetRootNode(Context ctx);
         [DllImport("FbxExporterCore")] static extern Node fbxeFindNodeByName(Context ctx, string name);
@@ -89,12 +202,25 @@ namespace UTJ.FbxExporter
         [DllImport("FbxExporterCore")] static extern void fbxeSetTRS(Context ctx, Node node, Vector3 t, Quaternion r, Vector3 s);
         [DllImport("FbxExporterCore")] static extern void fbxeAddMesh(Context ctx, Node node,
             int num_vertices, IntPtr points, IntPtr normals, IntPtr tangents, IntPtr uv, IntPtr colors);
+        [DllImport("FbxExporterCore")] static extern void fbxeAddMeshColors32(Context ctx, Node node, IntPtr colors);
+        [DllImport("FbxExporterCore")] static extern void fbxeAddMeshInterleaved(Context ctx, Node node,
+            VertexFormat format, int stride, IntPtr vertices, int num_vertices);
         [DllImport("FbxExporterCore")] static extern void fbxeAddMeshSubmesh(Context ctx, Node node,
             Topology topology, int num_indices, IntPtr indices, int material);
+        [DllImport("FbxExporterCore")] static extern void fbxeAddMeshSubmesh16(Context ctx, Node node,
+            Topology topology, int num_indices, IntPtr indices, int material);
         [DllImport("FbxExporterCore")] static extern void fbxeAddMeshSkin(Context ctx, Node node,
             IntPtr weights, int num_bones, IntPtr bones, IntPtr bindposes);
+        [DllImport("FbxExporterCore")] static extern void fbxeAddMeshSkin8(Context ctx, Node node,
+            IntPtr weights, int num_bones, IntPtr bones, IntPtr bindposes);
+        [DllImport("FbxExporterCore")] static extern void fbxeAddMeshSkinCSR(Context ctx, Node node,
+            IntPtr counts, IntPtr bone_indices, IntPtr bone_weights, int num_bones, IntPtr bones, IntPtr bindposes);
         [DllImport("FbxExporterCore")] static extern void fbxeAddMeshBlendShape(Context ctx, Node node,
             string name, float weight, IntPtr deltaPoints, IntPtr deltaNormals, IntPtr deltaTangents);
+        [DllImport("FbxExporterCore")] static extern int fbxeAddMeshes(Context ctx, MeshDesc[] descs, int num_descs, Node[] dst_nodes);
+
+        [DllImport("FbxExporterCore")] static extern void fbxeAddTerrain(Context ctx, Node node,
+            float[,] heightmap, int width, int height, Vector3 size);
 
         [DllImport("FbxExporterCore")] static extern void fbxeGenerateTerrainMesh(
             float[,] heightmap, int width, int height, Vector3 size,
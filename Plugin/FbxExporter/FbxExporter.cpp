@@ -34,6 +34,12 @@ fbxeAPI int fbxeIsFinished(fbxe::IContext *ctx)
     return ctx->isFinished();
 }
 
+fbxeAPI void fbxeGetStats(fbxe::IContext *ctx, fbxe::ExportStats *dst)
+{
+    if (!ctx || !dst) { return; }
+    *dst = ctx->getStats();
+}
+
 fbxeAPI fbxe::Node* fbxeGetRootNode(fbxe::IContext *ctx)
 {
     if (!ctx) { return nullptr; }
@@ -64,18 +70,50 @@ fbxeAPI void fbxeAddMesh(fbxe::IContext *ctx, fbxe::Node *node, int num_vertices
     ctx->addMesh(node, num_vertices, points, normals, tangents, uv, colors);
 }
 
+fbxeAPI void fbxeAddMeshColors32(fbxe::IContext *ctx, fbxe::Node *node, const uint32_t colors[])
+{
+    if (!ctx) { return; }
+    ctx->addMeshColors32(node, colors);
+}
+
+fbxeAPI void fbxeAddMeshInterleaved(fbxe::IContext *ctx, fbxe::Node *node, fbxe::VertexFormat format, int stride,
+    const void *vertices, int num_vertices)
+{
+    if (!ctx) { return; }
+    ctx->addMeshInterleaved(node, format, stride, vertices, num_vertices);
+}
+
 fbxeAPI void fbxeAddMeshSubmesh(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Topology topology, int num_indices, const int indices[], int material)
 {
     if (!ctx) { return; }
     ctx->addMeshSubmesh(node, topology, num_indices, indices, material);
 }
 
+fbxeAPI void fbxeAddMeshSubmesh16(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Topology topology, int num_indices, const uint16_t indices[], int material)
+{
+    if (!ctx) { return; }
+    ctx->addMeshSubmesh16(node, topology, num_indices, indices, material);
+}
+
 fbxeAPI void fbxeAddMeshSkin(fbxe::IContext *ctx, fbxe::Node *node, Weights4 weights[], int num_bones, fbxe::Node *bones[], float4x4 bindposes[])
 {
     if (!ctx) { return; }
     ctx->addMeshSkin(node, weights, num_bones, bones, bindposes);
 }
 
+fbxeAPI void fbxeAddMeshSkin8(fbxe::IContext *ctx, fbxe::Node *node, Weights8 weights[], int num_bones, fbxe::Node *bones[], float4x4 bindposes[])
+{
+    if (!ctx) { return; }
+    ctx->addMeshSkin8(node, weights, num_bones, bones, bindposes);
+}
+
+fbxeAPI void fbxeAddMeshSkinCSR(fbxe::IContext *ctx, fbxe::Node *node, const int counts[], const int bone_indices[], const float bone_weights[],
+    int num_bones, fbxe::Node *bones[], float4x4 bindposes[])
+{
+    if (!ctx) { return; }
+    ctx->addMeshSkinCSR(node, counts, bone_indices, bone_weights, num_bones, bones, bindposes);
+}
+
 fbxeAPI void fbxeAddMeshBlendShape(fbxe::IContext *ctx, fbxe::Node *node, const char *name, float weight,
     const fbxe::float3 delta_points[], const fbxe::float3 delta_normals[], const fbxe::float3 delta_tangents[])
 {
@@ -83,41 +121,28 @@ fbxeAPI void fbxeAddMeshBlendShape(fbxe::IContext *ctx, fbxe::Node *node, const
     ctx->addMeshBlendShape(node, name, weight, delta_points, delta_normals, delta_tangents);
 }
 
+fbxeAPI int fbxeAddMeshes(fbxe::IContext *ctx, const fbxe::MeshDesc descs[], int num_descs, fbxe::Node *dst_nodes[])
+{
+    if (!ctx) { return 0; }
+    return ctx->addMeshes(descs, num_descs, dst_nodes);
+}
+
+fbxeAPI void fbxeAddTerrain(fbxe::IContext *ctx, fbxe::Node *node, const float heightmap[], int width, int height, fbxe::float3 size)
+{
+    if (!ctx) { return; }
+    ctx->addTerrain(node, heightmap, width, height, size);
+}
+
 
 
 fbxeAPI void fbxeGenerateTerrainMesh(
     const float heightmap[], int width, int height, float3 size,
     float3 dst_vertices[], float3 dst_normals[], float2 dst_uv[], int dst_indices[])
 {
-    int num_vertices = width * height;
-    int num_triangles = (width - 1) * (height - 1) * 2;
-    auto size_unit = float3{ 1.0f / (width - 1), 1.0f, 1.0f / (height - 1) } *size;
-    auto uv_unit = float2{ 1.0f / (width - 1), 1.0f / (height - 1) };
-
-    parallel_invoke(
-        [&]() {
-        for (int iy = 0; iy < height; ++iy) {
-            for (int ix = 0; ix < width; ++ix) {
-                int i = iy * width + ix;
-                dst_vertices[i] = float3{ (float)ix, heightmap[i], (float)iy } *size_unit;
-                dst_uv[i] = float2{ (float)ix, (float)iy } *uv_unit;
-            }
-        }
-    },
-        [&]() {
-        for (int iy = 0; iy < height - 1; ++iy) {
-            for (int ix = 0; ix < width - 1; ++ix) {
-                int i6 = (iy * width + ix) * 6;
-                dst_indices[i6 + 0] = width*iy + ix;
-                dst_indices[i6 + 1] = width*(iy + 1) + ix;
-                dst_indices[i6 + 2] = width*(iy + 1) + (ix + 1);
-
-                dst_indices[i6 + 3] = width*iy + ix;
-                dst_indices[i6 + 4] = width*(iy + 1) + (ix + 1);
-                dst_indices[i6 + 5] = width*iy + (ix + 1);
-            }
-        }
-    });
-
-    GenerateNormalsTriangleIndexed(dst_normals, dst_vertices, dst_indices, num_triangles, num_vertices);
+    TerrainMesher mesher;
+    mesher.heights = IArray<float>(heightmap, width * height);
+    mesher.width = width;
+    mesher.height = height;
+    mesher.size = size;
+    mesher.generateGrid(dst_vertices, dst_normals, dst_uv, dst_indices);
 }
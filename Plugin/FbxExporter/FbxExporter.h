@@ -6,6 +6,8 @@
     #define fbxeAPI extern "C" 
 #endif
 
+#include <cstdint>
+
 namespace fbxe {
 #ifdef fbxeImpl
     using namespace mu;
@@ -23,6 +25,18 @@ namespace fbxe {
         int     indices[N] = {};
     };
     using Weights4 = Weights<4>;
+    using Weights8 = Weights<8>;
+
+    enum class VertexFormat
+    {
+        Unknown,
+        V3N3,
+        V3N3C4,
+        V3N3U2,
+        V3N3C4U2,
+        V3N3U2T4,
+        V3N3C4U2T4,
+    };
 #endif
 
     using Node = void;
@@ -53,6 +67,8 @@ namespace fbxe {
         Obj,
     };
 
+    static const int MaxLODLevels = 4;
+
     struct ExportOptions
     {
         int flip_handedness = 0;
@@ -62,6 +78,81 @@ namespace fbxe {
         float quadify_threshold_angle = 20.0f;
         float scale_factor = 1.0f;
         SystemUnit system_unit = SystemUnit::Meter;
+        int optimize_vertex_order = 0; // reorder faces and vertices for GPU vertex cache / fetch
+        int vertex_cache_size = 32;
+        int num_threads = 0; // 0: number of cores. the thread pool is shared by all contexts and never shrinks
+        int generate_normals = 0; // generate smooth normals if a mesh has no normals
+        int generate_tangents = 0; // generate tangents if a mesh has no tangents. requires uv
+        int lod_levels = 0; // number of reduced levels (0 - MaxLODLevels). if > 0, meshes are exported as LOD groups
+        float lod_ratios[MaxLODLevels] = { 0.5f, 0.25f, 0.125f, 0.0625f }; // ratio of triangles of each level to the original
+        int remove_hidden_triangles = 0; // remove triangles that can't be seen from outside. estimated by ray casting. skinned meshes are not affected
+        int hidden_test_rays = 64; // number of rays per triangle for remove_hidden_triangles
+        float terrain_max_error = 0.0f; // vertical error tolerance of terrain simplification (before scale_factor). 0: full resolution grid
+        int terrain_tile_size = 0; // split terrains into child nodes of tiles of this many quads per side. 0: no split. rounded down to a power of two if terrain_max_error > 0
+        int keep_colors_8bit = 0; // keep 8 bit vertex colors (fbxeAddMeshColors32()) as they are until written. otherwise they are unpacked to floats on input
+        int max_bone_influences = 0; // keep the strongest this many bone influences per vertex and renormalize the rest. 0: no limit
+    };
+
+    // statistics of the last export. fbxeGetStats() waits for the export to finish.
+    struct ExportStats
+    {
+        int num_tested_triangles = 0;   // triangles tested by remove_hidden_triangles. a quad counts as two
+        int num_removed_triangles = 0;
+    };
+
+    struct SubmeshDesc
+    {
+        Topology topology = Topology::Triangles;
+        int num_indices = 0;
+        const int *indices = nullptr;
+        int material = -1;
+        const uint16_t *indices16 = nullptr; // used if indices is null
+    };
+
+    // frames with the same name are put in the same channel
+    struct BlendShapeFrameDesc
+    {
+        const char *name = nullptr;
+        float weight = 100.0f;
+        const float3 *delta_points = nullptr;
+        const float3 *delta_normals = nullptr;
+        const float3 *delta_tangents = nullptr;
+    };
+
+    // a node and its mesh for fbxeAddMeshes(). equivalent to fbxeCreateNode(), fbxeSetTRS(), fbxeAddMesh(),
+    // fbxeAddMeshSubmesh(), fbxeAddMeshSkin() and fbxeAddMeshBlendShape(). all arrays are copied.
+    struct MeshDesc
+    {
+        Node *node = nullptr;           // existing node to add the mesh to. null: a node is created
+        const char *name = nullptr;     // name of the created node
+        int parent = -1;                // index of the parent in the same batch (must precede this). -1: parent_node
+        Node *parent_node = nullptr;    // null: the root node
+        int set_trs = 1;
+        float3 t = { 0.0f, 0.0f, 0.0f };
+        quatf r = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float3 s = { 1.0f, 1.0f, 1.0f };
+
+        int num_vertices = 0;           // 0: node only
+        const float3 *points = nullptr;
+        const float3 *normals = nullptr;
+        const float4 *tangents = nullptr;
+        const float2 *uv = nullptr;
+        const float4 *colors = nullptr;
+        const uint32_t *colors32 = nullptr; // used if colors is null. see fbxeAddMeshColors32()
+
+        int num_submeshes = 0;
+        const SubmeshDesc *submeshes = nullptr;
+
+        int num_bones = 0;              // 0: no skin
+        const Weights4 *weights = nullptr;
+        const int *weight_counts = nullptr; // influences in CSR form. used if weights is null. see fbxeAddMeshSkinCSR()
+        const int *bone_indices = nullptr;
+        const float *bone_weights = nullptr;
+        Node * const *bones = nullptr;
+        const float4x4 *bindposes = nullptr;
+
+        int num_blendshape_frames = 0;
+        const BlendShapeFrameDesc *blendshape_frames = nullptr;
     };
 
 } // namespace fbxe
@@ -73,6 +164,7 @@ fbxeAPI void            fbxeReleaseContext(fbxe::IContext *ctx);
 fbxeAPI int         fbxeCreateScene(fbxe::IContext *ctx, const char *name);
 fbxeAPI int         fbxeWriteAsync(fbxe::IContext *ctx, const char *path, fbxe::Format format);
 fbxeAPI int         fbxeIsFinished(fbxe::IContext *ctx);
+fbxeAPI void        fbxeGetStats(fbxe::IContext *ctx, fbxe::ExportStats *dst);
 
 fbxeAPI fbxe::Node* fbxeGetRootNode(fbxe::IContext *ctx);
 fbxeAPI fbxe::Node* fbxeFindNodeByName(fbxe::IContext *ctx, const char *name);
@@ -82,7 +174,29 @@ fbxeAPI void        fbxeSetTRS(fbxe::IContext *ctx, fbxe::Node *node, fbxe::floa
 fbxeAPI void        fbxeAddMesh(fbxe::IContext *ctx, fbxe::Node *node, int num_vertices,
     const fbxe::float3 points[], const fbxe::float3 normals[], const fbxe::float4 tangents[],
     const fbxe::float2 uv[], const fbxe::float4 colors[]);
+// 8 bit RGBA colors (r in the lowest byte. e.g. Unity's Color32) of the mesh added by fbxeAddMesh().
+fbxeAPI void        fbxeAddMeshColors32(fbxe::IContext *ctx, fbxe::Node *node, const uint32_t colors[]);
+// vertices: num_vertices interleaved vertices of format (vertex_v3n3u2t4 etc. in muVertex.h). stride: distance between
+// vertices in bytes (0: size of the format). attributes are copied straight from the vertices.
+fbxeAPI void        fbxeAddMeshInterleaved(fbxe::IContext *ctx, fbxe::Node *node, fbxe::VertexFormat format, int stride,
+    const void *vertices, int num_vertices);
 fbxeAPI void        fbxeAddMeshSubmesh(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Topology topology, int num_indices, const int indices[], int material);
+// 16 bit indices are kept as they are through quadification and export. they are widened only if needed
+// (normal / tangent generation, hidden triangle removal, LODs and vertex order optimization).
+fbxeAPI void        fbxeAddMeshSubmesh16(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Topology topology, int num_indices, const uint16_t indices[], int material);
 fbxeAPI void        fbxeAddMeshSkin(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Weights4 weights[], int num_bones, fbxe::Node *bones[], fbxe::float4x4 bindposes[]);
+fbxeAPI void        fbxeAddMeshSkin8(fbxe::IContext *ctx, fbxe::Node *node, fbxe::Weights8 weights[], int num_bones, fbxe::Node *bones[], fbxe::float4x4 bindposes[]);
+// variable number of influences per vertex. counts: number of influences of each vertex. bone_indices and bone_weights:
+// influences of all vertices in a row (sum of counts). e.g. Unity's Mesh.GetBonesPerVertex() and GetAllBoneWeights().
+fbxeAPI void        fbxeAddMeshSkinCSR(fbxe::IContext *ctx, fbxe::Node *node, const int counts[], const int bone_indices[], const float bone_weights[],
+    int num_bones, fbxe::Node *bones[], fbxe::float4x4 bindposes[]);
 fbxeAPI void        fbxeAddMeshBlendShape(fbxe::IContext *ctx, fbxe::Node *node, const char *name, float weight,
     const fbxe::float3 delta_points[], const fbxe::float3 delta_normals[], const fbxe::float3 delta_tangents[]);
+// nodes are created in order, then the arrays of all meshes are copied in parallel.
+// dst_nodes (can be null) receives the node of each desc. returns the number of nodes.
+fbxeAPI int         fbxeAddMeshes(fbxe::IContext *ctx, const fbxe::MeshDesc descs[], int num_descs, fbxe::Node *dst_nodes[]);
+// heightmap: width x height, row major. heights are scaled by size.y. the mesh is simplified if terrain_max_error > 0
+// and split into child nodes "<node name>_<x>_<y>" if terrain_tile_size > 0. the heightmap is copied, and tiles are
+// generated at export in parallel batches and released once written. so memory of tiles is bounded unless
+// remove_hidden_triangles or lod_levels need all of them at once.
+fbxeAPI void        fbxeAddTerrain(fbxe::IContext *ctx, fbxe::Node *node, const float heightmap[], int width, int height, fbxe::float3 size);
@@ -12,14 +12,29 @@ namespace fbxe {
 
 struct SubmeshData
 {
+    Topology topology = Topology::Triangles;
     RawVector<int> indices;
+    RawVector<uint16_t> indices16; // 16 bit input. kept until a pass needs 32 bit indices (quadify and export don't)
+    RawVector<int> counts; // built right before export
     int material_id = 0;
+
+    // moves indices16 to indices
+    void widenIndices()
+    {
+        if (indices16.empty()) { return; }
+        indices.resize_discard(indices16.size());
+        WidenIndices(indices.data(), indices16.data(), (int)indices16.size());
+        RawVector<uint16_t>().swap(indices16);
+    }
 };
 using SubmeshDataPtr = std::shared_ptr<SubmeshData>;
 
 struct SkinData
 {
-    RawVector<Weights4> weights;
+    // influences of each vertex in CSR form (see LimitWeights())
+    RawVector<int> counts;
+    RawVector<int> bone_indices;
+    RawVector<float> bone_weights;
     RawVector<Node*> bones;
     RawVector<float4x4> bindposes;
     FbxSkin *fbxskin = nullptr;
@@ -51,6 +66,7 @@ struct MeshData
     RawVector<float4> tangents;
     RawVector<float2> uv;
     RawVector<float4> colors;
+    RawVector<uint32_t> colors32; // 8 bit colors. used instead of colors if keep_colors_8bit
     SkinDataPtr skin;
     std::vector<SubmeshDataPtr> submeshes;
     std::vector<BlendShapeDataPtr> blendshapes;
@@ -58,10 +74,21 @@ struct MeshData
     FbxMesh *fbxmesh = nullptr;
     FbxBlendShape *fbxblendshape = nullptr;
 
+    std::function<void()> generate; // fills vertices and indices at export if set (terrain tiles)
     std::vector<std::function<void()>> tasks;
 };
 using MeshDataPtr = std::shared_ptr<MeshData>;
 
+// number of meshes generated and written at once in doWrite(). bounds the memory of deferred meshes.
+static const int MeshWriteBatchSize = 16;
+
+static void WidenSubmeshIndices(MeshData& data)
+{
+    for (auto& smptr : data.submeshes) {
+        smptr->widenIndices();
+    }
+}
+
 
 class Context : public IContext
 {
@@ -75,6 +102,7 @@ public:
     bool writeAsync(const char *path, Format format) override;
     bool isFinished() override;
     void wait() override;
+    ExportStats getStats() override;
 
     Node* getRootNode() override;
     Node* findNodeByName(const char *name) override;
@@ -83,18 +111,43 @@ public:
     void setTRS(Node *node, float3 t, quatf r, float3 s) override;
     void addMesh(Node *node, int num_vertices,
         const float3 points[], const float3 normals[], const float4 tangents[], const float2 uv[], const float4 colors[]) override;
+    void addMeshColors32(Node *node, const uint32_t colors[]) override;
+    void addMeshInterleaved(Node *node, VertexFormat format, int stride, const void *vertices, int num_vertices) override;
     void addMeshSubmesh(Node *node, Topology topology, int num_indices, const int indices[], int material) override;
+    void addMeshSubmesh16(Node *node, Topology topology, int num_indices, const uint16_t indices[], int material) override;
     void addMeshSkin(Node *node, Weights4 weights[], int num_bones, Node *bones[], float4x4 bindposes[]) override;
+    void addMeshSkin8(Node *node, Weights8 weights[], int num_bones, Node *bones[], float4x4 bindposes[]) override;
+    void addMeshSkinCSR(Node *node, const int counts[], const int bone_indices[], const float bone_weights[],
+        int num_bones, Node *bones[], float4x4 bindposes[]) override;
     void addMeshBlendShape(Node *node, const char *name, float weight,
         const float3 delta_points[], const float3 delta_normals[], const float3 delta_tangents[]) override;
+    int addMeshes(const MeshDesc descs[], int num_descs, Node *dst_nodes[]) override;
+    void addTerrain(Node *node, const float heightmap[], int width, int height, float3 size) override;
 
     bool doWrite(const char *path, Format format);
+    void generateAttributes(MeshData& data);
+    void generateLODs();
+    void removeHiddenTriangles();
 
 private:
+    MeshData& createMeshData(FbxNode *node);
+    SubmeshData& createSubmeshData(MeshData& data, Topology topology, int material);
+    void assignColors32(MeshData& data, const uint32_t *colors);
+    SkinData& createSkinData(MeshData& data, int num_vertices, int num_bones);
+    void assignWeights(SkinData& skin, int num_vertices, const int counts[], const int bone_indices[], const float bone_weights[]);
+    template<int N> void assignWeights(SkinData& skin, int num_vertices, const Weights<N> weights[]);
+    void limitWeights(SkinData& skin);
+    BlendShapeFrameData& createBlendShapeFrame(MeshData& data, const char *name, float weight, int num_vertices);
+    void buildPolygons(MeshData& data, SubmeshData& sm);
+    void optimizeVertexOrder(MeshData& data);
+    float4x4 getGlobalMatrix(FbxNode *node) const;
+
     ExportOptions m_opt;
+    ExportStats m_stats;
     FbxManager *m_manager = nullptr;
     FbxScene *m_scene = nullptr;
     std::map<Node*, MeshDataPtr> m_mesh_data;
+    std::map<Node*, float4x4> m_local_matrices; // as given to setTRS(). (before scaling and handedness conversion)
     std::future<void> m_task;
 };
 using ContextPtr = std::shared_ptr<Context>;
@@ -115,6 +168,10 @@ fbxeAPI IContext* CreateContext(const ExportOptions *opt)
 Context::Context(const ExportOptions *opt)
 {
     if (opt) { m_opt = *opt; }
+#ifdef muEnableThreadPool
+    // the pool is shared by all contexts. only grow it so that contexts don't undo each other's settings
+    ThreadPool::getInstance().growNumThreads(m_opt.num_threads);
+#endif
     m_manager = FbxManager::Create();
 }
 
@@ -135,6 +192,7 @@ void Context::release()
 void Context::clear()
 {
     wait();
+    m_local_matrices.clear();
     if (m_scene) {
         m_scene->Destroy(true);
         m_scene = nullptr;
@@ -184,11 +242,74 @@ void Context::wait()
     }
 }
 
+// m_stats is written by the export task. wait for it so that it is never read while being written.
+ExportStats Context::getStats()
+{
+    wait();
+    return m_stats;
+}
+
 bool Context::doWrite(const char *path, Format format)
 {
+    m_stats = ExportStats();
+    std::vector<MeshDataPtr*> meshes;
+    for (auto& p : m_mesh_data) {
+        meshes.push_back(&p.second);
+    }
+    int num_meshes = (int)meshes.size();
+
+    // deferred meshes are generated batch by batch right before they are written,
+    // unless passes over all meshes need them.
+    if (m_opt.remove_hidden_triangles || m_opt.lod_levels > 0) {
+        parallel_for(0, num_meshes, [&meshes](int i) {
+            auto& data = **meshes[i];
+            if (data.generate) {
+                data.generate();
+                data.generate = nullptr;
+            }
+        });
+    }
+    if (m_opt.generate_normals || m_opt.generate_tangents) {
+        parallel_for(0, num_meshes, [this, &meshes](int i) {
+            auto& data = **meshes[i];
+            if (!data.generate) {
+                generateAttributes(data);
+            }
+        });
+    }
+    if (m_opt.remove_hidden_triangles) {
+        removeHiddenTriangles();
+    }
+    if (m_opt.lod_levels > 0) {
+        generateLODs();
+    }
+
+    // each mesh is released once it is written, so deferred meshes never exist all at once.
+    // meshes are listed again as generateLODs() adds meshes of reduced levels.
+    meshes.clear();
     for (auto& p : m_mesh_data) {
-        for (auto& task : p.second->tasks) {
-            task();
+        meshes.push_back(&p.second);
+    }
+    num_meshes = (int)meshes.size();
+    for (int begin = 0; begin < num_meshes; begin += MeshWriteBatchSize) {
+        int end = std::min(begin + MeshWriteBatchSize, num_meshes);
+        parallel_for(begin, end, [this, &meshes](int i) {
+            auto& data = **meshes[i];
+            if (data.generate) {
+                data.generate();
+                data.generate = nullptr;
+                generateAttributes(data);
+            }
+        });
+        for (int i = begin; i < end; ++i) {
+            auto& data = **meshes[i];
+            if (m_opt.optimize_vertex_order) {
+                optimizeVertexOrder(data);
+            }
+            for (auto& task : data.tasks) {
+                task();
+            }
+            meshes[i]->reset();
         }
     }
     m_mesh_data.clear();
@@ -264,6 +385,7 @@ Node* Context::createNode(Node *parent, const char *name)
 void Context::setTRS(Node *node_, float3 t, quatf r, float3 s)
 {
     if (!node_) { return; }
+    m_local_matrices[node_] = transform(t, r, s);
 
     t *= m_opt.scale_factor;
     if (m_opt.flip_handedness) {
@@ -279,13 +401,63 @@ void Context::setTRS(Node *node_, float3 t, quatf r, float3 s)
 }
 
 
-void Context::addMesh(Node *node_, int num_vertices,
+void Context::addMesh(Node *node, int num_vertices,
     const float3 points[], const float3 normals[], const float4 tangents[], const float2 uv[], const float4 colors[])
 {
-    if (!node_) { return; }
+    if (!node) { return; }
     if (!points) { return; } // points must not be null
 
-    auto node = reinterpret_cast<FbxNode*>(node_);
+    auto& data = createMeshData(reinterpret_cast<FbxNode*>(node));
+    if (points) data.points.assign(points, points + num_vertices);
+    if (normals) data.normals.assign(normals, normals + num_vertices);
+    if (tangents) data.tangents.assign(tangents, tangents + num_vertices);
+    if (uv) data.uv.assign(uv, uv + num_vertices);
+    if (colors) data.colors.assign(colors, colors + num_vertices);
+}
+
+void Context::addMeshColors32(Node *node, const uint32_t colors[])
+{
+    if (!colors) { return; }
+    auto it = m_mesh_data.find(node);
+    if (it == m_mesh_data.end() || !it->second) { return; }
+
+    assignColors32(*it->second, colors);
+}
+
+// 8 bit colors are kept as they are if keep_colors_8bit, otherwise unpacked to floats
+void Context::assignColors32(MeshData& data, const uint32_t *colors)
+{
+    int num_vertices = (int)data.points.size();
+    if (m_opt.keep_colors_8bit) {
+        data.colors32.assign(colors, colors + num_vertices);
+        data.colors.clear();
+    }
+    else {
+        data.colors.resize_discard(num_vertices);
+        Color32ToFloat4(data.colors.data(), colors, num_vertices);
+        data.colors32.clear();
+    }
+}
+
+void Context::addMeshInterleaved(Node *node, VertexFormat format, int stride, const void *vertices, int num_vertices)
+{
+    if (!node || !vertices || num_vertices <= 0) { return; }
+    auto layout = GetVertexLayout(format);
+    if (layout.points < 0) { return; } // unknown format
+
+    auto& data = createMeshData(reinterpret_cast<FbxNode*>(node));
+    data.points.resize_discard(num_vertices);
+    data.normals.resize_discard(num_vertices);
+    if (layout.colors >= 0) data.colors.resize_discard(num_vertices);
+    if (layout.uvs >= 0) data.uv.resize_discard(num_vertices);
+    if (layout.tangents >= 0) data.tangents.resize_discard(num_vertices);
+    Deinterleave(vertices, format, stride, num_vertices,
+        data.points.data(), data.normals.data(), data.colors.data(), data.uv.data(), data.tangents.data());
+}
+
+// mesh attribute of the node and the task that writes vertices at export. vertex data is filled by the caller.
+MeshData& Context::createMeshData(FbxNode *node)
+{
     auto mesh = FbxMesh::Create(m_scene, "");
     node->SetNodeAttribute(mesh);
     node->SetShadingMode(FbxNode::eTextureShading);
@@ -293,15 +465,12 @@ void Context::addMesh(Node *node_, int num_vertices,
     auto ptr = new MeshData();
     auto& data = *ptr;
     m_mesh_data[node].reset(ptr);
-    if (points) data.points.assign(points, points + num_vertices);
-    if (normals) data.normals.assign(normals, normals + num_vertices);
-    if (tangents) data.tangents.assign(tangents, tangents + num_vertices);
-    if (uv) data.uv.assign(uv, uv + num_vertices);
-    if (colors) data.colors.assign(colors, colors + num_vertices);
     data.fbxnode = node;
     data.fbxmesh = mesh;
 
-    auto body = [this, &data, mesh, num_vertices]() {
+    auto body = [this, &data, mesh]() {
+        // vertices may be removed before export (remove_hidden_triangles)
+        int num_vertices = (int)data.points.size();
         {
             // set points
             if (m_opt.flip_handedness) {
@@ -368,7 +537,7 @@ void Context::addMesh(Node *node_, int num_vertices,
             }
             da.Release((void**)&dst);
         }
-        if (!data.colors.empty()) {
+        if (!data.colors.empty() || !data.colors32.empty()) {
             // set colors
             auto element = mesh->CreateElementVertexColor();
             element->SetMappingMode(FbxGeometryElement::eByControlPoint);
@@ -377,13 +546,21 @@ void Context::addMesh(Node *node_, int num_vertices,
             auto& da = element->GetDirectArray();
             da.Resize(num_vertices);
             auto dst = (FbxColor*)da.GetLocked();
-            for (int i = 0; i < num_vertices; ++i) {
-                dst[i] = ToC4(data.colors[i]);
+            if (!data.colors32.empty()) {
+                for (int i = 0; i < num_vertices; ++i) {
+                    dst[i] = ToC4(data.colors32[i]);
+                }
+            }
+            else {
+                for (int i = 0; i < num_vertices; ++i) {
+                    dst[i] = ToC4(data.colors[i]);
+                }
             }
             da.Release((void**)&dst);
         }
     };
     data.tasks.push_back(body);
+    return data;
 }
 
 void Context::addMeshSubmesh(Node *node, Topology topology, int num_indices, const int indices[], int material)
@@ -391,18 +568,89 @@ void Context::addMeshSubmesh(Node *node, Topology topology, int num_indices, con
     auto it = m_mesh_data.find(node);
     if (it == m_mesh_data.end() || !it->second) { return; }
 
-    auto& data = *it->second;
+    auto& sm = createSubmeshData(*it->second, topology, material);
+    sm.indices.assign(indices, indices + num_indices);
+}
+
+void Context::addMeshSubmesh16(Node *node, Topology topology, int num_indices, const uint16_t indices[], int material)
+{
+    auto it = m_mesh_data.find(node);
+    if (it == m_mesh_data.end() || !it->second) { return; }
+
+    auto& sm = createSubmeshData(*it->second, topology, material);
+    sm.indices16.assign(indices, indices + num_indices);
+}
+
+template<class IndexT>
+static void AddPolygons(FbxMesh *mesh, const RawVector<int>& counts, const IndexT *indices, int material, bool flip)
+{
+    int pi = 0;
+    int num_faces = (int)counts.size();
+    if (flip) {
+        for (int fi = 0; fi < num_faces; ++fi) {
+            int count = counts[fi];
+            mesh->BeginPolygon(material);
+            for (int vi = count - 1; vi >= 0; --vi) {
+                mesh->AddPolygon(indices[pi + vi]);
+            }
+            pi += count;
+            mesh->EndPolygon();
+        }
+    }
+    else {
+        for (int fi = 0; fi < num_faces; ++fi) {
+            int count = counts[fi];
+            mesh->BeginPolygon(material);
+            for (int vi = 0; vi < count; ++vi) {
+                mesh->AddPolygon(indices[pi + vi]);
+            }
+            pi += count;
+            mesh->EndPolygon();
+        }
+    }
+}
+
+// the task that writes polygons at export. indices are filled by the caller.
+SubmeshData& Context::createSubmeshData(MeshData& data, Topology topology, int material)
+{
     auto smptr = new SubmeshData();
     auto& sm = *smptr;
     data.submeshes.emplace_back(smptr);
+    sm.topology = topology;
     sm.material_id = material;
-    sm.indices.assign(indices, indices + num_indices);
 
-    auto body = [this, &data, &sm, topology, num_indices, material]() {
-        auto mesh = data.fbxmesh;
+    auto body = [this, &data, &sm, material]() {
+        buildPolygons(data, sm);
+        if (!sm.indices16.empty()) {
+            AddPolygons(data.fbxmesh, sm.counts, sm.indices16.data(), material, m_opt.flip_faces != 0);
+        }
+        else {
+            AddPolygons(data.fbxmesh, sm.counts, sm.indices.data(), material, m_opt.flip_faces != 0);
+        }
+    };
+    data.tasks.push_back(body);
+    return sm;
+}
+
+void Context::buildPolygons(MeshData& data, SubmeshData& sm)
+{
+    if (!sm.counts.empty()) { return; }
 
+    if (sm.topology == Topology::Triangles && m_opt.quadify) {
+        if (!sm.indices16.empty()) {
+            RawVector<uint16_t> qindices;
+            QuadifyTriangles(data.points, sm.indices16, m_opt.quadify_full_search, m_opt.quadify_threshold_angle, qindices, sm.counts);
+            sm.indices16.swap(qindices);
+        }
+        else {
+            RawVector<int> qindices;
+            QuadifyTriangles(data.points, sm.indices, m_opt.quadify_full_search, m_opt.quadify_threshold_angle, qindices, sm.counts);
+            sm.indices.swap(qindices);
+        }
+    }
+    else {
         int vertices_in_primitive = 1;
-        switch (topology)
+        switch (sm.topology)
         {
         case Topology::Points:    vertices_in_primitive = 1; break;
         case Topology::Lines:     vertices_in_primitive = 2; break;
@@ -410,62 +658,574 @@ void Context::addMeshSubmesh(Node *node, Topology topology, int num_indices, con
         case Topology::Quads:     vertices_in_primitive = 4; break;
         default: break;
         }
+        int num_indices = sm.indices16.empty() ? (int)sm.indices.size() : (int)sm.indices16.size();
+        sm.counts.resize(num_indices / vertices_in_primitive, vertices_in_primitive);
+    }
+}
 
-        if (topology == Topology::Triangles && m_opt.quadify) {
-            RawVector<int> qindices;
-            RawVector<int> qcounts;
-            QuadifyTriangles(data.points, sm.indices, m_opt.quadify_full_search, m_opt.quadify_threshold_angle, qindices, qcounts);
-
-            int pi = 0;
-            int num_faces = (int)qcounts.size();
-            if (m_opt.flip_faces) {
-                for (int fi = 0; fi < num_faces; ++fi) {
-                    int count = qcounts[fi];
-                    mesh->BeginPolygon(material);
-                    for (int vi = count - 1; vi >= 0; --vi) {
-                        mesh->AddPolygon(qindices[pi + vi]);
-                    }
-                    pi += count;
-                    mesh->EndPolygon();
+// checks bits because fast math builds may assume NaN and inf never appear
+static inline bool IsFinite(const float *v, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        uint32_t bits;
+        memcpy(&bits, &v[i], sizeof(bits));
+        if ((bits & 0x7f800000u) == 0x7f800000u) { return false; }
+    }
+    return true;
+}
+
+// vertices with nothing to average (used only by points or lines, unreferenced, or used only by
+// degenerate faces) get NaN from the normal and tangent generators. replace them with value.
+template<class T>
+static void ReplaceNonFinite(RawVector<T>& data, const T& value)
+{
+    for (auto& v : data) {
+        if (!IsFinite((const float*)&v, sizeof(T) / sizeof(float))) { v = value; }
+    }
+}
+
+void Context::generateAttributes(MeshData& data)
+{
+    bool gen_normals = m_opt.generate_normals && data.normals.empty();
+    bool gen_tangents = m_opt.generate_tangents && data.tangents.empty() && !data.uv.empty();
+    if (!gen_normals && !gen_tangents) { return; }
+    WidenSubmeshIndices(data);
+
+    // gather faces of all submeshes. points and lines don't contribute.
+    int num_vertices = (int)data.points.size();
+    RawVector<int> counts, indices;
+    bool triangles_only = true;
+    for (auto& smptr : data.submeshes) {
+        auto& sm = *smptr;
+        int ngon = 0;
+        switch (sm.topology) {
+        case Topology::Triangles: ngon = 3; break;
+        case Topology::Quads: ngon = 4; triangles_only = false; break;
+        default: break;
+        }
+        if (ngon == 0) { continue; }
+
+        if (sm.counts.empty()) {
+            counts.resize(counts.size() + sm.indices.size() / ngon, ngon);
+        }
+        else {
+            // polygons are already built (quadified)
+            counts.insert(counts.end(), sm.counts.begin(), sm.counts.end());
+            triangles_only = false;
+        }
+        indices.insert(indices.end(), sm.indices.begin(), sm.indices.end());
+    }
+    if (indices.empty()) { return; }
+
+    RawVector<int> offsets;
+    ConnectionData connection;
+    if (!triangles_only) {
+        int num_indices, num_indices_tri;
+        CountIndices(counts, offsets, num_indices, num_indices_tri);
+    }
+
+    if (gen_normals) {
+        data.normals.resize_discard(num_vertices);
+        if (triangles_only) {
+            GenerateNormalsTriangleIndexed(data.normals.data(), data.points.data(), indices.data(), (int)counts.size(), num_vertices);
+        }
+        else {
+            connection.buildConnection(indices, counts, offsets, data.points);
+            GenerateNormalsPoly(data.normals, data.points, counts, offsets, indices, false, &connection);
+        }
+        ReplaceNonFinite(data.normals, float3{ 0.0f, 1.0f, 0.0f });
+    }
+    if (gen_tangents && !data.normals.empty()) {
+        data.tangents.resize_discard(num_vertices);
+        if (triangles_only) {
+            GenerateTangentsTriangleIndexed(data.tangents.data(), data.points.data(), data.uv.data(), data.normals.data(),
+                indices.data(), (int)counts.size(), num_vertices);
+        }
+        else {
+            GenerateTangentsPoly(data.tangents, data.points, data.normals, data.uv, counts, offsets, indices);
+        }
+        ReplaceNonFinite(data.tangents, float4{ 1.0f, 0.0f, 0.0f, 1.0f });
+    }
+}
+
+struct LODData
+{
+    RawVector<int> new2old; // vertices of the level refer to the original vertices
+    std::vector<RawVector<int>> indices; // per submesh. triangles and quads become triangles
+};
+
+static bool HasFaces(const MeshData& data)
+{
+    for (auto& smptr : data.submeshes) {
+        if (smptr->topology == Topology::Triangles || smptr->topology == Topology::Quads) { return true; }
+    }
+    return false;
+}
+
+// triangles and quads of all submeshes are decimated at once so that submeshes stay connected.
+// points and lines are kept as they are.
+static void BuildLOD(const MeshData& data, float ratio, LODData& dst)
+{
+    int num_vertices = (int)data.points.size();
+    int num_submeshes = (int)data.submeshes.size();
+
+    RawVector<int> indices, groups;
+    for (int si = 0; si < num_submeshes; ++si) {
+        auto& sm = *data.submeshes[si];
+        if (sm.topology == Topology::Triangles) {
+            indices.insert(indices.end(), sm.indices.begin(), sm.indices.end());
+            groups.resize(groups.size() + sm.indices.size() / 3, si);
+        }
+        else if (sm.topology == Topology::Quads) {
+            int num_quads = (int)sm.indices.size() / 4;
+            for (int qi = 0; qi < num_quads; ++qi) {
+                const int *q = &sm.indices[qi * 4];
+                int tris[6] = { q[0], q[1], q[2], q[0], q[2], q[3] };
+                indices.insert(indices.end(), tris, tris + 6);
+            }
+            groups.resize(groups.size() + num_quads * 2, si);
+        }
+    }
+
+    RawVector<int> dindices, dgroups;
+    MeshDecimator decimator;
+    decimator.indices = indices;
+    decimator.points = data.points;
+    decimator.groups = groups;
+    decimator.decimate(ratio, FLT_MAX, dindices, &dgroups);
+
+    // split into submeshes
+    dst.indices.resize(num_submeshes);
+    for (int si = 0; si < num_submeshes; ++si) {
+        auto& sm = *data.submeshes[si];
+        if (sm.topology != Topology::Triangles && sm.topology != Topology::Quads) {
+            dst.indices[si] = sm.indices;
+        }
+    }
+    int num_triangles = (int)dgroups.size();
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        auto& d = dst.indices[dgroups[ti]];
+        d.insert(d.end(), &dindices[ti * 3], &dindices[ti * 3] + 3);
+    }
+
+    // remove unused vertices
+    RawVector<int> old2new;
+    old2new.resize(num_vertices, -1);
+    dst.new2old.clear();
+    for (auto& idx : dst.indices) {
+        for (int& i : idx) {
+            if (old2new[i] < 0) {
+                old2new[i] = (int)dst.new2old.size();
+                dst.new2old.push_back(i);
+            }
+            i = old2new[i];
+        }
+    }
+}
+
+template<class T>
+static inline void Gather(RawVector<T>& dst, const RawVector<T>& src, const RawVector<int>& new2old)
+{
+    if (src.empty()) { return; }
+
+    dst.resize_discard(new2old.size());
+    CopyWithIndices(dst.data(), src.data(), new2old);
+}
+
+// influences of vertices new2old[i] of skin
+static void GatherWeights(RawVector<int>& dst_counts, RawVector<int>& dst_bone_indices, RawVector<float>& dst_bone_weights,
+    const SkinData& skin, const RawVector<int>& new2old)
+{
+    // offsets of the influences of each source vertex
+    int num_src_vertices = (int)skin.counts.size();
+    RawVector<int> offsets;
+    offsets.resize_discard(num_src_vertices);
+    int num_influences = 0;
+    for (int vi = 0; vi < num_src_vertices; ++vi) {
+        offsets[vi] = num_influences;
+        num_influences += skin.counts[vi];
+    }
+
+    int num_vertices = (int)new2old.size();
+    dst_counts.resize_discard(num_vertices);
+    int num_dst_influences = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        dst_counts[vi] = skin.counts[new2old[vi]];
+        num_dst_influences += dst_counts[vi];
+    }
+
+    dst_bone_indices.resize_discard(num_dst_influences);
+    dst_bone_weights.resize_discard(num_dst_influences);
+    int di = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        int si = offsets[new2old[vi]];
+        int count = dst_counts[vi];
+        std::copy(skin.bone_indices.data() + si, skin.bone_indices.data() + si + count, dst_bone_indices.data() + di);
+        std::copy(skin.bone_weights.data() + si, skin.bone_weights.data() + si + count, dst_bone_weights.data() + di);
+        di += count;
+    }
+}
+
+template<class T>
+static inline T* DataOrNull(RawVector<T>& v)
+{
+    return v.empty() ? nullptr : v.data();
+}
+
+void Context::generateLODs()
+{
+    int num_levels = std::min(m_opt.lod_levels, MaxLODLevels);
+
+    std::vector<MeshData*> meshes;
+    for (auto& p : m_mesh_data) {
+        if (HasFaces(*p.second)) {
+            WidenSubmeshIndices(*p.second);
+            meshes.push_back(p.second.get());
+        }
+    }
+    int num_meshes = (int)meshes.size();
+
+    // each level is decimated from the original mesh. so all levels of all meshes can be processed in parallel.
+    std::vector<LODData> lods(num_meshes * num_levels);
+    parallel_for(0, (int)lods.size(), [this, &meshes, &lods, num_levels](int i) {
+        BuildLOD(*meshes[i / num_levels], m_opt.lod_ratios[i % num_levels], lods[i]);
+    });
+
+    for (int mi = 0; mi < num_meshes; ++mi) {
+        auto& data = *meshes[mi];
+        auto node = data.fbxnode;
+        std::string name = node->GetName();
+
+        // make the node a LOD group and move the original mesh to its first child
+        auto group = FbxLODGroup::Create(m_scene, "");
+        group->ThresholdsUsedAsPercentage.Set(true);
+        node->RemoveNodeAttribute(data.fbxmesh);
+        node->SetNodeAttribute(group);
+
+        auto lod0 = reinterpret_cast<FbxNode*>(createNode(node, (name + "_LOD0").c_str()));
+        lod0->SetNodeAttribute(data.fbxmesh);
+        lod0->SetShadingMode(FbxNode::eTextureShading);
+        data.fbxnode = lod0;
+
+        for (int li = 0; li < num_levels; ++li) {
+            auto& lod = lods[mi * num_levels + li];
+            group->AddThreshold(m_opt.lod_ratios[li] * 100.0);
+
+            // blendshapes are not carried to reduced levels
+            auto lodnode = createNode(node, (name + "_LOD" + std::to_string(li + 1)).c_str());
+            RawVector<float3> points, normals;
+            RawVector<float4> tangents, colors;
+            RawVector<float2> uv;
+            RawVector<uint32_t> colors32;
+            Gather(points, data.points, lod.new2old);
+            Gather(normals, data.normals, lod.new2old);
+            Gather(tangents, data.tangents, lod.new2old);
+            Gather(uv, data.uv, lod.new2old);
+            Gather(colors, data.colors, lod.new2old);
+            Gather(colors32, data.colors32, lod.new2old);
+            addMesh(lodnode, (int)lod.new2old.size(),
+                DataOrNull(points), DataOrNull(normals), DataOrNull(tangents), DataOrNull(uv), DataOrNull(colors));
+            addMeshColors32(lodnode, DataOrNull(colors32));
+
+            int num_submeshes = (int)data.submeshes.size();
+            for (int si = 0; si < num_submeshes; ++si) {
+                auto& sm = *data.submeshes[si];
+                auto topology = sm.topology == Topology::Quads ? Topology::Triangles : sm.topology;
+                addMeshSubmesh(lodnode, topology, (int)lod.indices[si].size(), lod.indices[si].data(), sm.material_id);
+            }
+            if (data.skin) {
+                auto& skin = *data.skin;
+                RawVector<int> counts, bone_indices;
+                RawVector<float> bone_weights;
+                GatherWeights(counts, bone_indices, bone_weights, skin, lod.new2old);
+                addMeshSkinCSR(lodnode, counts.data(), bone_indices.data(), bone_weights.data(),
+                    (int)skin.bones.size(), skin.bones.data(), skin.bindposes.data());
+            }
+        }
+    }
+}
+
+float4x4 Context::getGlobalMatrix(FbxNode *node) const
+{
+    auto ret = float4x4::identity();
+    for (; node; node = node->GetParent()) {
+        auto it = m_local_matrices.find(node);
+        if (it != m_local_matrices.end()) {
+            ret *= it->second;
+        }
+    }
+    return ret;
+}
+
+static inline float Hash01(uint32_t v)
+{
+    v ^= v >> 16; v *= 0x7feb352d;
+    v ^= v >> 15; v *= 0x846ca68b;
+    v ^= v >> 16;
+    return (float)(v >> 8) * (1.0f / 16777216.0f);
+}
+
+// cast rays from random points on the front side of the triangle to random directions (cosine weighted).
+// if any of them hits nothing, the triangle can be seen from outside.
+static bool IsTriangleVisible(const TriangleBVH& bvh, float3 p0, float3 p1, float3 p2, uint32_t seed, int num_rays, float offset)
+{
+    float3 e1 = p1 - p0;
+    float3 e2 = p2 - p0;
+    float3 n = cross(e1, e2);
+    float len = length(n);
+    if (len == 0.0f) { return false; } // degenerate triangles can't be seen anyway
+    n /= len;
+    float3 t = normalize(std::abs(n.x) < 0.9f ? cross(n, float3{ 1.0f, 0.0f, 0.0f }) : cross(n, float3{ 0.0f, 1.0f, 0.0f }));
+    float3 b = cross(n, t);
+
+    for (int ri = 0; ri < num_rays; ++ri) {
+        float3 pos, dir;
+        if (ri == 0) {
+            // center to normal first. this is enough for most visible triangles.
+            pos = (p0 + p1 + p2) / 3.0f;
+            dir = n;
+        }
+        else {
+            uint32_t h = seed + (uint32_t)ri * 4;
+            float u = Hash01(h + 0), v = Hash01(h + 1);
+            if (u + v > 1.0f) { u = 1.0f - u; v = 1.0f - v; }
+            pos = p0 + e1 * u + e2 * v;
+
+            float phi = Hash01(h + 2) * 2.0f * PI;
+            float r2 = Hash01(h + 3);
+            float r = std::sqrt(r2);
+            dir = t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * std::sqrt(1.0f - r2);
+        }
+        pos += n * offset;
+
+        int ti;
+        float distance;
+        if (!bvh.raycast(pos, dir, ti, distance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class T>
+static inline void Compact(RawVector<T>& data, const RawVector<int>& new2old)
+{
+    RawVector<T> tmp;
+    Gather(tmp, data, new2old);
+    data.swap(tmp);
+}
+
+void Context::removeHiddenTriangles()
+{
+    // skinned meshes and meshes with blendshapes deform. they are neither tested nor used as occluders.
+    struct Target
+    {
+        MeshData *data;
+        float4x4 matrix;
+        int vertex_offset;
+        int triangle_offset;
+    };
+    std::vector<Target> targets;
+    int num_vertices = 0, num_triangles = 0;
+    for (auto& p : m_mesh_data) {
+        auto& data = *p.second;
+        if (data.skin || !data.blendshapes.empty() || !HasFaces(data)) { continue; }
+        WidenSubmeshIndices(data);
+
+        targets.push_back({ &data, getGlobalMatrix(data.fbxnode), num_vertices, num_triangles });
+        num_vertices += (int)data.points.size();
+        for (auto& smptr : data.submeshes) {
+            auto& sm = *smptr;
+            if (sm.topology == Topology::Triangles) { num_triangles += (int)sm.indices.size() / 3; }
+            else if (sm.topology == Topology::Quads) { num_triangles += (int)sm.indices.size() / 4 * 2; }
+        }
+    }
+    if (num_triangles == 0) { return; }
+
+    // gather all triangles in world space. winding is flipped on mirrored nodes to keep front faces.
+    RawVector<float3> vertices;
+    RawVector<int> indices;
+    vertices.resize_discard(num_vertices);
+    indices.resize_discard(num_triangles * 3);
+    parallel_for(0, (int)targets.size(), [&](int i) {
+        auto& target = targets[i];
+        auto& data = *target.data;
+        auto& m = target.matrix;
+        MulPoints(m, data.points.data(), vertices.data() + target.vertex_offset, data.points.size());
+
+        bool mirrored = dot(cross((float3&)m[0], (float3&)m[1]), (float3&)m[2]) < 0.0f;
+        int i1 = mirrored ? 2 : 1, i2 = mirrored ? 1 : 2;
+        int vo = target.vertex_offset;
+        int *dst = indices.data() + target.triangle_offset * 3;
+        for (auto& smptr : data.submeshes) {
+            auto& sm = *smptr;
+            if (sm.topology == Topology::Triangles) {
+                int n = (int)sm.indices.size() / 3;
+                for (int ti = 0; ti < n; ++ti) {
+                    const int *t = &sm.indices[ti * 3];
+                    *dst++ = t[0] + vo; *dst++ = t[i1] + vo; *dst++ = t[i2] + vo;
                 }
             }
-            else {
-                for (int fi = 0; fi < num_faces; ++fi) {
-                    int count = qcounts[fi];
-                    mesh->BeginPolygon(material);
-                    for (int vi = 0; vi < count; ++vi) {
-                        mesh->AddPolygon(qindices[pi + vi]);
-                    }
-                    pi += count;
-                    mesh->EndPolygon();
+            else if (sm.topology == Topology::Quads) {
+                int n = (int)sm.indices.size() / 4;
+                for (int qi = 0; qi < n; ++qi) {
+                    const int *q = &sm.indices[qi * 4];
+                    int t1[3] = { q[0], q[1], q[2] }, t2[3] = { q[0], q[2], q[3] };
+                    *dst++ = t1[0] + vo; *dst++ = t1[i1] + vo; *dst++ = t1[i2] + vo;
+                    *dst++ = t2[0] + vo; *dst++ = t2[i1] + vo; *dst++ = t2[i2] + vo;
                 }
             }
         }
-        else {
-            int pi = 0;
-            if (m_opt.flip_faces) {
-                while (pi < num_indices) {
-                    mesh->BeginPolygon(material);
-                    for (int vi = vertices_in_primitive - 1; vi >= 0; --vi) {
-                        mesh->AddPolygon(sm.indices[pi + vi]);
+    });
+
+    TriangleBVH bvh;
+    bvh.build(vertices, indices);
+
+    // ray origins are pushed out of the surface a bit to not hit the triangle itself or its neighbors
+    float3 bmin, bmax;
+    MinMax(vertices.data(), vertices.size(), bmin, bmax);
+    float offset = length(bmax - bmin) * 1e-5f;
+    int num_rays = std::max(m_opt.hidden_test_rays, 1);
+
+    RawVector<char> visible;
+    visible.resize_discard(num_triangles);
+    parallel_for_blocked(0, num_triangles, 256, [&](int begin, int end) {
+        for (int ti = begin; ti < end; ++ti) {
+            const int *t = &indices[ti * 3];
+            visible[ti] = IsTriangleVisible(bvh, vertices[t[0]], vertices[t[1]], vertices[t[2]],
+                (uint32_t)ti * 0x9E3779B1u, num_rays, offset);
+        }
+    });
+
+    // remove hidden faces and vertices that are no longer referenced
+    std::atomic_int num_removed{ 0 };
+    parallel_for(0, (int)targets.size(), [&](int i) {
+        auto& target = targets[i];
+        auto& data = *target.data;
+        int removed = 0;
+        const char *vis = visible.data() + target.triangle_offset;
+        for (auto& smptr : data.submeshes) {
+            auto& sm = *smptr;
+            if (sm.topology == Topology::Triangles) {
+                int n = (int)sm.indices.size() / 3;
+                int di = 0;
+                for (int ti = 0; ti < n; ++ti) {
+                    if (vis[ti]) {
+                        for (int j = 0; j < 3; ++j) { sm.indices[di++] = sm.indices[ti * 3 + j]; }
+                    }
+                    else {
+                        ++removed;
                     }
-                    pi += vertices_in_primitive;
-                    mesh->EndPolygon();
                 }
+                sm.indices.resize(di);
+                vis += n;
             }
-            else {
-                while (pi < num_indices) {
-                    mesh->BeginPolygon(material);
-                    for (int vi = 0; vi < vertices_in_primitive; ++vi) {
-                        mesh->AddPolygon(sm.indices[pi + vi]);
+            else if (sm.topology == Topology::Quads) {
+                // a quad is removed only if both of its halves are hidden
+                int n = (int)sm.indices.size() / 4;
+                int di = 0;
+                for (int qi = 0; qi < n; ++qi) {
+                    if (vis[qi * 2] || vis[qi * 2 + 1]) {
+                        for (int j = 0; j < 4; ++j) { sm.indices[di++] = sm.indices[qi * 4 + j]; }
+                    }
+                    else {
+                        removed += 2;
                     }
-                    pi += vertices_in_primitive;
-                    mesh->EndPolygon();
                 }
+                sm.indices.resize(di);
+                vis += n * 2;
             }
         }
-    };
-    data.tasks.push_back(body);
+        if (removed == 0) { return; }
+        num_removed += removed;
+
+        RawVector<int> old2new, new2old;
+        old2new.resize((int)data.points.size(), -1);
+        for (auto& smptr : data.submeshes) {
+            for (int& vi : smptr->indices) {
+                if (old2new[vi] < 0) {
+                    old2new[vi] = (int)new2old.size();
+                    new2old.push_back(vi);
+                }
+                vi = old2new[vi];
+            }
+        }
+        Compact(data.points, new2old);
+        Compact(data.normals, new2old);
+        Compact(data.tangents, new2old);
+        Compact(data.uv, new2old);
+        Compact(data.colors, new2old);
+        Compact(data.colors32, new2old);
+    });
+
+    m_stats.num_tested_triangles = num_triangles;
+    m_stats.num_removed_triangles = num_removed;
+}
+
+template<class T>
+static inline void Reorder(RawVector<T>& data, const RawVector<int>& new2old)
+{
+    if (data.empty()) { return; }
+
+    RawVector<T> tmp;
+    tmp.resize_discard(data.size());
+    CopyWithIndices(tmp.data(), data.data(), new2old);
+    data.swap(tmp);
+}
+
+void Context::optimizeVertexOrder(MeshData& data)
+{
+    WidenSubmeshIndices(data);
+    int num_vertices = (int)data.points.size();
+
+    // reorder faces for post-transform vertex cache
+    RawVector<int> all_indices;
+    for (auto& smptr : data.submeshes) {
+        auto& sm = *smptr;
+        buildPolygons(data, sm);
+        if (sm.topology == Topology::Triangles || sm.topology == Topology::Quads) {
+            RawVector<int> counts, indices;
+            OptimizeVertexCache(sm.counts, sm.indices, num_vertices, m_opt.vertex_cache_size, counts, indices);
+            sm.counts.swap(counts);
+            sm.indices.swap(indices);
+        }
+        all_indices.insert(all_indices.end(), sm.indices.begin(), sm.indices.end());
+    }
+
+    // reorder vertices for vertex fetch. all submeshes share vertices so process them at once.
+    RawVector<int> new2old;
+    OptimizeVertexFetch(all_indices, num_vertices, new2old);
+    {
+        int ii = 0;
+        for (auto& smptr : data.submeshes) {
+            auto& sm = *smptr;
+            all_indices.copy_to(sm.indices.data(), sm.indices.size(), ii);
+            ii += (int)sm.indices.size();
+        }
+    }
+
+    Reorder(data.points, new2old);
+    Reorder(data.normals, new2old);
+    Reorder(data.tangents, new2old);
+    Reorder(data.uv, new2old);
+    Reorder(data.colors, new2old);
+    Reorder(data.colors32, new2old);
+    if (data.skin) {
+        auto& skin = *data.skin;
+        RawVector<int> counts, bone_indices;
+        RawVector<float> bone_weights;
+        GatherWeights(counts, bone_indices, bone_weights, skin, new2old);
+        skin.counts.swap(counts);
+        skin.bone_indices.swap(bone_indices);
+        skin.bone_weights.swap(bone_weights);
+    }
+    for (auto& bs : data.blendshapes) {
+        for (auto& frame : bs->frames) {
+            Reorder(frame->delta_points, new2old);
+            Reorder(frame->delta_normals, new2old);
+            Reorder(frame->delta_tangents, new2old);
+        }
+    }
 }
 
 void Context::addMeshSkin(Node *node, Weights4 weights[], int num_bones, Node *bones[], float4x4 bindposes[])
@@ -475,22 +1235,98 @@ void Context::addMeshSkin(Node *node, Weights4 weights[], int num_bones, Node *b
     if (it == m_mesh_data.end() || !it->second) { return; }
 
     auto& data = *it->second;
-    auto skinptr = new SkinData();
-    auto& skin = *skinptr;
-    data.skin.reset(skinptr);
+    int num_vertices = (int)data.points.size();
+    auto& skin = createSkinData(data, num_vertices, num_bones);
+    assignWeights(skin, num_vertices, weights);
+    skin.bones.assign(bones, bones + num_bones);
+    skin.bindposes.assign(bindposes, bindposes + num_bones);
+}
+
+void Context::addMeshSkin8(Node *node, Weights8 weights[], int num_bones, Node *bones[], float4x4 bindposes[])
+{
+    if (num_bones == 0) { return; }
+    auto it = m_mesh_data.find(node);
+    if (it == m_mesh_data.end() || !it->second) { return; }
+
+    auto& data = *it->second;
+    int num_vertices = (int)data.points.size();
+    auto& skin = createSkinData(data, num_vertices, num_bones);
+    assignWeights(skin, num_vertices, weights);
+    skin.bones.assign(bones, bones + num_bones);
+    skin.bindposes.assign(bindposes, bindposes + num_bones);
+}
+
+void Context::addMeshSkinCSR(Node *node, const int counts[], const int bone_indices[], const float bone_weights[],
+    int num_bones, Node *bones[], float4x4 bindposes[])
+{
+    if (num_bones == 0) { return; }
+    auto it = m_mesh_data.find(node);
+    if (it == m_mesh_data.end() || !it->second) { return; }
 
+    auto& data = *it->second;
     int num_vertices = (int)data.points.size();
-    skin.weights.assign(weights, weights + num_vertices);
+    auto& skin = createSkinData(data, num_vertices, num_bones);
+    assignWeights(skin, num_vertices, counts, bone_indices, bone_weights);
     skin.bones.assign(bones, bones + num_bones);
     skin.bindposes.assign(bindposes, bindposes + num_bones);
+}
+
+void Context::assignWeights(SkinData& skin, int num_vertices, const int counts[], const int bone_indices[], const float bone_weights[])
+{
+    int num_influences = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) { num_influences += counts[vi]; }
+    skin.counts.assign(counts, counts + num_vertices);
+    skin.bone_indices.assign(bone_indices, bone_indices + num_influences);
+    skin.bone_weights.assign(bone_weights, bone_weights + num_influences);
+    limitWeights(skin);
+}
+
+// N influences per vertex
+template<int N>
+void Context::assignWeights(SkinData& skin, int num_vertices, const Weights<N> weights[])
+{
+    skin.counts.resize_discard(num_vertices);
+    skin.bone_indices.resize_discard(num_vertices * N);
+    skin.bone_weights.resize_discard(num_vertices * N);
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        skin.counts[vi] = N;
+        std::copy(weights[vi].indices, weights[vi].indices + N, skin.bone_indices.data() + vi * N);
+        std::copy(weights[vi].weights, weights[vi].weights + N, skin.bone_weights.data() + vi * N);
+    }
+    limitWeights(skin);
+}
+
+// keep the strongest max_bone_influences of each vertex
+void Context::limitWeights(SkinData& skin)
+{
+    if (m_opt.max_bone_influences <= 0) { return; }
+
+    RawVector<int> counts, bone_indices;
+    RawVector<float> bone_weights;
+    if (LimitWeights(counts, bone_indices, bone_weights, skin.counts, skin.bone_indices, skin.bone_weights, m_opt.max_bone_influences)) {
+        skin.counts.swap(counts);
+        skin.bone_indices.swap(bone_indices);
+        skin.bone_weights.swap(bone_weights);
+    }
+}
+
+// the task that writes the skin deformer at export. weights, bones and bindposes are filled by the caller.
+// control points of all clusters are gathered in one pass over the weights.
+SkinData& Context::createSkinData(MeshData& data, int num_vertices, int num_bones)
+{
+    auto skinptr = new SkinData();
+    auto& skin = *skinptr;
+    data.skin.reset(skinptr);
 
     auto body = [this, &data, &skin, num_bones, num_vertices]() {
         auto fbxskin = FbxSkin::Create(m_scene, "");
         data.fbxmesh->AddDeformer(fbxskin);
         skin.fbxskin = fbxskin;
 
-        RawVector<int> dindices;
+        RawVector<int> doffsets, dindices;
         RawVector<double> dweights;
+        GetInfluences(skin.counts.data(), skin.bone_indices.data(), skin.bone_weights.data(), num_vertices, num_bones,
+            doffsets, dindices, dweights);
         for (int bi = 0; bi < num_bones; ++bi) {
             if (!skin.bones[bi]) { continue; }
 
@@ -506,15 +1342,16 @@ void Context::addMeshSkin(Node *node, Weights4 weights[], int num_bones, Node *b
             }
             cluster->SetTransformMatrix(ToAM44(bindpose));
 
-            GetInfluence(skin.weights.data(), num_vertices, bi, dindices, dweights);
-            cluster->SetControlPointIWCount((int)dindices.size());
-            dindices.copy_to(cluster->GetControlPointIndices());
-            dweights.copy_to(cluster->GetControlPointWeights());
+            int begin = doffsets[bi], end = doffsets[bi + 1];
+            cluster->SetControlPointIWCount(end - begin);
+            std::copy(dindices.data() + begin, dindices.data() + end, cluster->GetControlPointIndices());
+            std::copy(dweights.data() + begin, dweights.data() + end, cluster->GetControlPointWeights());
 
             fbxskin->AddCluster(cluster);
         }
     };
     data.tasks.push_back(body);
+    return skin;
 }
 
 void Context::addMeshBlendShape(Node *node, const char *name, float weight,
@@ -524,7 +1361,17 @@ void Context::addMeshBlendShape(Node *node, const char *name, float weight,
     if (it == m_mesh_data.end() || !it->second) { return; }
 
     auto& data = *it->second;
+    int num_vertices = (int)data.points.size();
+    auto& frame = createBlendShapeFrame(data, name, weight, num_vertices);
+    if (delta_points) frame.delta_points.assign(delta_points, delta_points + num_vertices);
+    if (delta_normals) frame.delta_normals.assign(delta_normals, delta_normals + num_vertices);
+    if (delta_tangents) frame.delta_tangents.assign(delta_tangents, delta_tangents + num_vertices);
+}
 
+// the frame, its channel and deformer if not exist, and the task that writes the shape at export.
+// deltas are filled by the caller.
+BlendShapeFrameData& Context::createBlendShapeFrame(MeshData& data, const char *name, float weight, int num_vertices)
+{
     // find or create blendshape deformer
     if (!data.fbxblendshape) {
         data.fbxblendshape = FbxBlendShape::Create(m_scene, "");
@@ -554,11 +1401,6 @@ void Context::addMeshBlendShape(Node *node, const char *name, float weight,
     frame.fbxshape = FbxShape::Create(m_scene, "");
     blendshape->fbxchannel->AddTargetShape(frame.fbxshape, weight);
     blendshape->frames.emplace_back(frameptr);
-
-    int num_vertices = (int)data.points.size();
-    if (delta_points) frame.delta_points.assign(delta_points, delta_points + num_vertices);
-    if (delta_normals) frame.delta_normals.assign(delta_normals, delta_normals + num_vertices);
-    if (delta_tangents) frame.delta_tangents.assign(delta_tangents, delta_tangents + num_vertices);
     frame.weight = weight;
 
     auto body = [this, &data, &frame, num_vertices]() {
@@ -632,5 +1474,158 @@ void Context::addMeshBlendShape(Node *node, const char *name, float weight,
         }
     };
     data.tasks.push_back(body);
+    return frame;
+}
+
+int Context::addMeshes(const MeshDesc descs[], int num_descs, Node *dst_nodes[])
+{
+    if (!m_scene || !descs || num_descs <= 0) { return 0; }
+
+    // fbx objects can't be created in parallel. nodes, meshes and deformers are created first in order,
+    // then the arrays of all descs are copied in parallel.
+    std::vector<Node*> nodes(num_descs);
+    std::vector<MeshData*> meshes(num_descs);
+    std::vector<BlendShapeFrameData*> frames;
+    std::vector<int> frame_offsets(num_descs);
+    int num_nodes = 0;
+    for (int di = 0; di < num_descs; ++di) {
+        auto& desc = descs[di];
+        auto node = desc.node;
+        if (!node) {
+            auto parent = desc.parent >= 0 && desc.parent < di ? nodes[desc.parent] : desc.parent_node;
+            node = createNode(parent, desc.name ? desc.name : "");
+            if (node && desc.set_trs) {
+                setTRS(node, desc.t, desc.r, desc.s);
+            }
+        }
+        nodes[di] = node;
+        if (dst_nodes) { dst_nodes[di] = node; }
+        if (node) { ++num_nodes; }
+        frame_offsets[di] = (int)frames.size();
+        if (!node || desc.num_vertices <= 0 || !desc.points) { continue; }
+
+        auto& data = createMeshData(reinterpret_cast<FbxNode*>(node));
+        meshes[di] = &data;
+        for (int si = 0; si < desc.num_submeshes; ++si) {
+            auto& smd = desc.submeshes[si];
+            createSubmeshData(data, smd.topology, smd.material);
+        }
+        if (desc.num_bones > 0 && (desc.weights || (desc.weight_counts && desc.bone_indices && desc.bone_weights)) && desc.bones && desc.bindposes) {
+            createSkinData(data, desc.num_vertices, desc.num_bones);
+        }
+        for (int fi = 0; fi < desc.num_blendshape_frames; ++fi) {
+            auto& fd = desc.blendshape_frames[fi];
+            frames.push_back(&createBlendShapeFrame(data, fd.name ? fd.name : "", fd.weight, desc.num_vertices));
+        }
+    }
+
+    parallel_for(0, num_descs, [&](int di) {
+        auto *pdata = meshes[di];
+        if (!pdata) { return; }
+
+        auto& desc = descs[di];
+        auto& data = *pdata;
+        int num_vertices = desc.num_vertices;
+        data.points.assign(desc.points, desc.points + num_vertices);
+        if (desc.normals) data.normals.assign(desc.normals, desc.normals + num_vertices);
+        if (desc.tangents) data.tangents.assign(desc.tangents, desc.tangents + num_vertices);
+        if (desc.uv) data.uv.assign(desc.uv, desc.uv + num_vertices);
+        if (desc.colors) data.colors.assign(desc.colors, desc.colors + num_vertices);
+        else if (desc.colors32) assignColors32(data, desc.colors32);
+
+        for (int si = 0; si < desc.num_submeshes; ++si) {
+            auto& smd = desc.submeshes[si];
+            if (smd.indices) data.submeshes[si]->indices.assign(smd.indices, smd.indices + smd.num_indices);
+            else if (smd.indices16) data.submeshes[si]->indices16.assign(smd.indices16, smd.indices16 + smd.num_indices);
+        }
+        if (data.skin) {
+            auto& skin = *data.skin;
+            if (desc.weights) assignWeights(skin, num_vertices, desc.weights);
+            else assignWeights(skin, num_vertices, desc.weight_counts, desc.bone_indices, desc.bone_weights);
+            skin.bones.assign(desc.bones, desc.bones + desc.num_bones);
+            skin.bindposes.assign(desc.bindposes, desc.bindposes + desc.num_bones);
+        }
+        for (int fi = 0; fi < desc.num_blendshape_frames; ++fi) {
+            auto& fd = desc.blendshape_frames[fi];
+            auto& frame = *frames[frame_offsets[di] + fi];
+            if (fd.delta_points) frame.delta_points.assign(fd.delta_points, fd.delta_points + num_vertices);
+            if (fd.delta_normals) frame.delta_normals.assign(fd.delta_normals, fd.delta_normals + num_vertices);
+            if (fd.delta_tangents) frame.delta_tangents.assign(fd.delta_tangents, fd.delta_tangents + num_vertices);
+        }
+    });
+    return num_nodes;
+}
+
+void Context::addTerrain(Node *node, const float heightmap[], int width, int height, float3 size)
+{
+    if (!node || !heightmap || width < 2 || height < 2) { return; }
+
+    // tiles are generated at export (see doWrite()), so the heightmap is copied and shared by the tiles.
+    struct TerrainSource
+    {
+        RawVector<float> heights;
+        TerrainMesher mesher;
+    };
+    auto src = std::make_shared<TerrainSource>();
+    src->heights.assign(heightmap, heightmap + width * height);
+    auto& mesher = src->mesher;
+    mesher.heights = src->heights;
+    mesher.width = width;
+    mesher.height = height;
+    mesher.size = size;
+
+    bool adaptive = m_opt.terrain_max_error > 0.0f;
+    float max_error = m_opt.terrain_max_error;
+    int tile_size = m_opt.terrain_tile_size > 0 ? m_opt.terrain_tile_size : std::max(width, height);
+    if (adaptive) {
+        // tiles of the triangulation must fit in the tiles of nodes. they are powers of two,
+        // so node tiles are rounded down to a power of two too. (otherwise 100 would allow only 4)
+        if (m_opt.terrain_tile_size > 0) {
+            int pot = 1;
+            while (pot * 2 <= tile_size) { pot *= 2; }
+            tile_size = pot;
+        }
+        mesher.buildErrors(mesher.getTileSize(m_opt.terrain_tile_size > 0 ? tile_size : 0));
+    }
+
+    // the full resolution grid is emitted as quads directly if quadify is enabled. (QuadifyTriangles() is skipped)
+    // simplified terrains are triangles and quadified as usual.
+    bool quads = !adaptive && m_opt.quadify;
+
+    // creating fbx objects and mesh data is not thread safe, so nodes and meshes of all tiles are created here.
+    // vertices and indices of each tile are generated when it is written, and released right after that.
+    int tiles_x = ceildiv(width - 1, tile_size);
+    int tiles_y = ceildiv(height - 1, tile_size);
+    for (int ty = 0; ty < tiles_y; ++ty) {
+        for (int tx = 0; tx < tiles_x; ++tx) {
+            int x0 = tx * tile_size;
+            int y0 = ty * tile_size;
+            int x1 = std::min(x0 + tile_size, width - 1);
+            int y1 = std::min(y0 + tile_size, height - 1);
+            auto *fbxnode = reinterpret_cast<FbxNode*>(node);
+            if (tiles_x * tiles_y > 1) {
+                char name[256];
+                sprintf(name, "%s_%d_%d", fbxnode->GetName(), tx, ty);
+                fbxnode = reinterpret_cast<FbxNode*>(createNode(node, name));
+            }
+            auto& data = createMeshData(fbxnode);
+            auto& sm = createSubmeshData(data, quads ? Topology::Quads : Topology::Triangles, -1);
+
+            data.generate = [&data, &sm, src, adaptive, max_error, quads, x0, y0, x1, y1]() {
+                auto& indices = sm.indices;
+                if (adaptive) {
+                    src->mesher.generateAdaptive(max_error, x0, y0, x1, y1, data.points, data.normals, data.uv, indices);
+                }
+                else {
+                    int num_vertices = (x1 - x0 + 1) * (y1 - y0 + 1);
+                    data.points.resize(num_vertices);
+                    data.normals.resize(num_vertices);
+                    data.uv.resize(num_vertices);
+                    indices.resize((x1 - x0) * (y1 - y0) * (quads ? 4 : 6));
+                    src->mesher.generateGrid(x0, y0, x1, y1, data.points.data(), data.normals.data(), data.uv.data(), indices.data(), quads);
+                }
+            };
+        }
+    }
 }
 } // namespace fbxe
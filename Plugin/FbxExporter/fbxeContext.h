@@ -14,6 +14,7 @@ public:
     virtual bool writeAsync(const char *path, Format format = Format::FbxBinary) = 0;
     virtual bool isFinished() = 0;
     virtual void wait() = 0;
+    virtual ExportStats getStats() = 0; // waits for writeAsync() to finish
 
     virtual Node* getRootNode() = 0;
     virtual Node* findNodeByName(const char *name) = 0;
@@ -22,10 +23,18 @@ public:
     virtual void setTRS(Node *node, float3 t, quatf r, float3 s) = 0;
     virtual void addMesh(Node *node, int num_vertices,
         const float3 points[], const float3 normals[], const float4 tangents[], const float2 uv[], const float4 colors[]) = 0;
+    virtual void addMeshColors32(Node *node, const uint32_t colors[]) = 0;
+    virtual void addMeshInterleaved(Node *node, VertexFormat format, int stride, const void *vertices, int num_vertices) = 0;
     virtual void addMeshSubmesh(Node *node, Topology topology, int num_indices, const int indices[], int material) = 0;
+    virtual void addMeshSubmesh16(Node *node, Topology topology, int num_indices, const uint16_t indices[], int material) = 0;
     virtual void addMeshSkin(Node *node, Weights4 weights[], int num_bones, Node *bones[], float4x4 bindposes[]) = 0;
+    virtual void addMeshSkin8(Node *node, Weights8 weights[], int num_bones, Node *bones[], float4x4 bindposes[]) = 0;
+    virtual void addMeshSkinCSR(Node *node, const int counts[], const int bone_indices[], const float bone_weights[],
+        int num_bones, Node *bones[], float4x4 bindposes[]) = 0;
     virtual void addMeshBlendShape(Node *node, const char *name, float weight,
         const float3 delta_points[], const float3 delta_normals[], const float3 delta_tangents[]) = 0;
+    virtual int addMeshes(const MeshDesc descs[], int num_descs, Node *dst_nodes[]) = 0;
+    virtual void addTerrain(Node *node, const float heightmap[], int width, int height, float3 size) = 0;
 
 protected:
     virtual ~IContext() {}
@@ -11,6 +11,7 @@ inline FbxVector4 ToV4(float3 v) { return { v.x, v.y, v.z, 0.0f }; }
 inline FbxDouble4 ToP4(float4 v) { return { v.x, v.y, v.z, v.w }; }
 inline FbxVector4 ToV4(float4 v) { return { v.x, v.y, v.z, v.w }; }
 inline FbxColor   ToC4(float4 v) { return { v.x, v.y, v.z, v.w }; }
+inline FbxColor   ToC4(uint32_t c) { return { (c & 0xff) / 255.0, ((c >> 8) & 0xff) / 255.0, ((c >> 16) & 0xff) / 255.0, (c >> 24) / 255.0 }; }
 inline FbxAMatrix ToAM44(float4x4 v)
 {
     FbxAMatrix ret;
@@ -33,25 +34,54 @@ inline void FlipHandedness(FbxVector4 *v, int n)
 
 
 
-template<int N>
-inline int GetInfluence(Weights<N> weights[], int num_vertices, int bone_index, RawVector<int>& dindices, RawVector<double>& dweights)
+// control points and weights of all bones from influences in CSR form (see LimitWeights()), bucketed in one pass.
+// those of bone bi are [dst_offsets[bi], dst_offsets[bi + 1]) of dst_indices and dst_weights. zero weights are skipped.
+// a bone that appears more than once in a vertex's influences gets one control point with the sum of its weights.
+inline void GetInfluences(const int counts[], const int bone_indices[], const float bone_weights[], int num_vertices, int num_bones,
+    RawVector<int>& dst_offsets, RawVector<int>& dst_indices, RawVector<double>& dst_weights)
 {
-    dindices.clear();
-    dweights.clear();
+    // an influence is a duplicate if an earlier valid one of the same vertex has the same bone. counts are small.
+    auto valid = [&](int i) {
+        return bone_indices[i] >= 0 && bone_indices[i] < num_bones && bone_weights[i] > 0.0f;
+    };
+    auto duplicate = [&](int begin, int i) {
+        for (int j = begin; j < i; ++j) {
+            if (bone_indices[j] == bone_indices[i] && valid(j)) { return true; }
+        }
+        return false;
+    };
+
+    dst_offsets.resize_zeroclear(num_bones + 1);
+    int i = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        int begin = i;
+        for (int ci = 0; ci < counts[vi]; ++ci, ++i) {
+            if (valid(i) && !duplicate(begin, i)) { ++dst_offsets[bone_indices[i] + 1]; }
+        }
+    }
+    for (int bi = 0; bi < num_bones; ++bi) { dst_offsets[bi + 1] += dst_offsets[bi]; }
 
+    RawVector<int> pos;
+    pos.assign(dst_offsets.data(), dst_offsets.data() + num_bones);
+    dst_indices.resize_discard(dst_offsets[num_bones]);
+    dst_weights.resize_discard(dst_offsets[num_bones]);
+    i = 0;
     for (int vi = 0; vi < num_vertices; ++vi) {
-        for (int i = 0; i < N; ++i) {
-            if (weights[vi].indices[i] == bone_index) {
-                float w = weights[vi].weights[i];
-                if (w > 0.0f) {
-                    dindices.push_back(vi);
-                    dweights.push_back(w);
-                }
-                break;
+        int begin = i;
+        for (int ci = 0; ci < counts[vi]; ++ci, ++i) {
+            if (!valid(i)) { continue; }
+            int bi = bone_indices[i];
+            if (duplicate(begin, i)) {
+                // buckets are filled in vertex order, so the last one of bi is this vertex
+                dst_weights[pos[bi] - 1] += bone_weights[i];
+            }
+            else {
+                int di = pos[bi]++;
+                dst_indices[di] = vi;
+                dst_weights[di] = bone_weights[i];
             }
         }
     }
-    return (int)dindices.size();
 }
 
 } // namespace fbxe
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "MeshUtils.h"
+#include <unordered_map>
 #include "mikktspace.h"
 
 #ifdef muEnableHalf
@@ -12,6 +13,83 @@ namespace mu {
 
 
 
+static const int NormalsBlockSize = 4096;
+
+void GenerateFaceNormals(
+    IArray<float3> dst, const IArray<float3> points, const IArray<int> offsets, const IArray<int> indices, bool flip)
+{
+    int num_faces = (int)offsets.size();
+    int i1 = flip ? 2 : 1;
+    int i2 = flip ? 1 : 2;
+
+    // gather the first 3 vertices of each face into SoA batches so that cross products can be vectorized
+    parallel_for_blocked(0, num_faces, NormalsBlockSize, [&](int begin, int end) {
+        const int BatchSize = 256;
+        float ex[2][BatchSize], ey[2][BatchSize], ez[2][BatchSize];
+        float nx[BatchSize], ny[BatchSize], nz[BatchSize];
+
+        for (int bi = begin; bi < end; bi += BatchSize) {
+            int n = std::min(BatchSize, end - bi);
+            for (int i = 0; i < n; ++i) {
+                const int *face = &indices[offsets[bi + i]];
+                float3 p0 = points[face[0]];
+                float3 e1 = points[face[i1]] - p0;
+                float3 e2 = points[face[i2]] - p0;
+                ex[0][i] = e1.x; ey[0][i] = e1.y; ez[0][i] = e1.z;
+                ex[1][i] = e2.x; ey[1][i] = e2.y; ez[1][i] = e2.z;
+            }
+            for (int i = 0; i < n; ++i) {
+                nx[i] = ey[0][i] * ez[1][i] - ez[0][i] * ey[1][i];
+                ny[i] = ez[0][i] * ex[1][i] - ex[0][i] * ez[1][i];
+                nz[i] = ex[0][i] * ey[1][i] - ey[0][i] * ex[1][i];
+            }
+            for (int i = 0; i < n; ++i) {
+                dst[bi + i] = { nx[i], ny[i], nz[i] };
+            }
+        }
+    });
+}
+
+void GenerateNormalsPoly(
+    IArray<float3> dst, const IArray<float3> points,
+    const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    bool flip, const ConnectionData *connection)
+{
+    int num_faces = (int)counts.size();
+    int num_vertices = (int)dst.size();
+
+    RawVector<float3> face_normals(num_faces);
+    GenerateFaceNormals(face_normals, points, offsets, indices, flip);
+
+    if (!connection) {
+        // building connection costs more than scattering. do it serially.
+        dst.zeroclear();
+        for (int fi = 0; fi < num_faces; ++fi) {
+            int count = counts[fi];
+            const int *face = &indices[offsets[fi]];
+            float3 n = face_normals[fi];
+            for (int ci = 0; ci < count; ++ci) {
+                dst[face[ci]] += n;
+            }
+        }
+        Normalize(dst.data(), dst.size());
+        return;
+    }
+
+    // gather face normals per vertex. connected faces are in face order,
+    // so the sum is exactly the same as scattering them face by face.
+    parallel_for_blocked(0, num_vertices, NormalsBlockSize, [&](int begin, int end) {
+        for (int vi = begin; vi < end; ++vi) {
+            float3 n = float3::zero();
+            connection->eachConnectedFaces(vi, [&](int fi, int) {
+                n += face_normals[fi];
+            });
+            dst[vi] = n;
+        }
+        Normalize(&dst[begin], end - begin);
+    });
+}
+
 bool GenerateNormalsPoly(
     IArray<float3> dst, const IArray<float3> points,
     const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices)
@@ -19,22 +97,7 @@ bool GenerateNormalsPoly(
     if (dst.size() != points.size()) {
         return false;
     }
-    dst.zeroclear();
-
-    size_t num_faces = counts.size();
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int count = counts[fi];
-        const int *face = &indices[offsets[fi]];
-        float3 p0 = points[face[0]];
-        float3 p1 = points[face[1]];
-        float3 p2 = points[face[2]];
-        float3 n = cross(p1 - p0, p2 - p0);
-        for (int ci = 0; ci < count; ++ci) {
-            dst[face[ci]] += n;
-        }
-    }
-    Normalize(dst.data(), dst.size());
+    GenerateNormalsPoly(dst, points, counts, offsets, indices, false, nullptr);
     return true;
 }
 
@@ -48,55 +111,63 @@ struct TSpaceContext
     const IArray<int> offsets;
     const IArray<int> indices;
 
+    // chunked mode. faces are remapped by face_map, and only faces that belong to chunk are written.
+    const int *face_map;
+    const int *face_chunks;
+    int num_faces;
+    int chunk;
+
+    int face(int i) const { return face_map ? face_map[i] : i; }
+
     static int getNumFaces(const SMikkTSpaceContext *tctx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        return (int)_this->counts.size();
+        return _this->face_map ? _this->num_faces : (int)_this->counts.size();
     }
 
     static int getCount(const SMikkTSpaceContext *tctx, int i)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        return (int)_this->counts[i];
+        return (int)_this->counts[_this->face(i)];
     }
 
     static void getPosition(const SMikkTSpaceContext *tctx, float *o_pos, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        const int *face = &_this->indices[_this->offsets[iface]];
+        const int *face = &_this->indices[_this->offsets[_this->face(iface)]];
         (float3&)*o_pos = _this->points[face[ivtx]];
     }
 
     static void getPositionFlattened(const SMikkTSpaceContext *tctx, float *o_pos, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        (float3&)*o_pos = _this->points[_this->offsets[iface] + ivtx];
+        (float3&)*o_pos = _this->points[_this->offsets[_this->face(iface)] + ivtx];
     }
 
     static void getNormal(const SMikkTSpaceContext *tctx, float *o_normal, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        const int *face = &_this->indices[_this->offsets[iface]];
+        const int *face = &_this->indices[_this->offsets[_this->face(iface)]];
         (float3&)*o_normal = _this->normals[face[ivtx]];
     }
 
     static void getNormalFlattened(const SMikkTSpaceContext *tctx, float *o_normal, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        (float3&)*o_normal = _this->normals[_this->offsets[iface] + ivtx];
+        (float3&)*o_normal = _this->normals[_this->offsets[_this->face(iface)] + ivtx];
     }
 
     static void getTexCoord(const SMikkTSpaceContext *tctx, float *o_tcoord, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        const int *face = &_this->indices[_this->offsets[iface]];
+        const int *face = &_this->indices[_this->offsets[_this->face(iface)]];
         (float2&)*o_tcoord = _this->uv[face[ivtx]];
     }
 
     static void getTexCoordFlattened(const SMikkTSpaceContext *tctx, float *o_tcoord, int iface, int ivtx)
     {
         auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
-        (float2&)*o_tcoord = _this->uv[_this->offsets[iface] + ivtx];
+        (float2&)*o_tcoord = _this->uv[_this->offsets[_this->face(iface)] + ivtx];
     }
 
     static void setTangent(const SMikkTSpaceContext *tctx, const float* tangent, const float* /*bitangent*/,
@@ -115,33 +186,323 @@ struct TSpaceContext
         float sign = (IsOrientationPreserving != 0) ? 1.0f : -1.0f;
         _this->dst[_this->offsets[iface] + ivtx] = { tangent[0], tangent[1], tangent[2], sign };
     }
+
+    // dst is per face-vertex in chunked mode. faces of other chunks (halo) are ignored.
+    static void setTangentChunk(const SMikkTSpaceContext *tctx, const float* tangent, const float* /*bitangent*/,
+        float /*fMagS*/, float /*fMagT*/, tbool IsOrientationPreserving, int iface, int ivtx)
+    {
+        auto *_this = reinterpret_cast<TSpaceContext*>(tctx->m_pUserData);
+        int fi = _this->face(iface);
+        if (_this->face_chunks[fi] != _this->chunk) { return; }
+        float sign = (IsOrientationPreserving != 0) ? 1.0f : -1.0f;
+        _this->dst[_this->offsets[fi] + ivtx] = { tangent[0], tangent[1], tangent[2], sign };
+    }
+
+    bool generate()
+    {
+        SMikkTSpaceInterface iface;
+        memset(&iface, 0, sizeof(iface));
+        iface.m_getNumFaces = getNumFaces;
+        iface.m_getNumVerticesOfFace = getCount;
+        iface.m_getPosition = points.size()  == indices.size() ? getPositionFlattened : getPosition;
+        iface.m_getNormal   = normals.size() == indices.size() ? getNormalFlattened : getNormal;
+        iface.m_getTexCoord = uv.size()      == indices.size() ? getTexCoordFlattened : getTexCoord;
+        if (face_map)
+            iface.m_setTSpace = setTangentChunk;
+        else
+            iface.m_setTSpace = dst.size() == indices.size() ? setTangentFlattened : setTangent;
+
+        SMikkTSpaceContext tctx;
+        memset(&tctx, 0, sizeof(tctx));
+        tctx.m_pInterface = &iface;
+        tctx.m_pUserData = this;
+
+        return genTangSpaceDefault(&tctx) != 0;
+    }
 };
 
+static const int TangentChunkSize = 8192;
+
+void WeldPositions(RawVector<int>& dst, const IArray<float3> points)
+{
+    struct Key
+    {
+        uint32_t v[3];
+        bool operator==(const Key& o) const { return v[0] == o.v[0] && v[1] == o.v[1] && v[2] == o.v[2]; }
+    };
+    struct Hash
+    {
+        size_t operator()(const Key& k) const { return (k.v[0] * 73856093u) ^ (k.v[1] * 19349663u) ^ (k.v[2] * 83492791u); }
+    };
+
+    int n = (int)points.size();
+    dst.resize_discard(n);
+    std::unordered_map<Key, int, Hash> ids;
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        float3 p = points[i] + float3::zero();
+        Key key;
+        memcpy(key.v, &p, sizeof(key.v));
+        dst[i] = ids.insert(std::make_pair(key, (int)ids.size())).first->second;
+    }
+}
+
+static inline uint32_t MortonPart1By2(uint32_t v)
+{
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// mikktspace builds tangent space per welded vertex from the faces around it.
+// so the mesh is split into spatially coherent chunks, and each chunk runs mikktspace on its own faces
+// plus the faces that share a position with them (halo). only the chunk's own faces are written.
+// relative order of faces is kept, so the result is identical to the whole-mesh result as long as
+// edges are manifold. (non-manifold edges may be paired differently, which makes slight differences)
+static bool GenerateTangentsChunked(TSpaceContext& ctx)
+{
+    const auto& counts = ctx.counts;
+    const auto& offsets = ctx.offsets;
+    const auto& indices = ctx.indices;
+    const auto& points = ctx.points;
+    int num_faces = (int)counts.size();
+    int num_indices = (int)indices.size();
+    bool points_flattened = points.size() == indices.size();
+
+    // position id of each face-vertex
+    RawVector<int> corner_pos(num_indices);
+    int num_positions;
+    {
+        RawVector<int> ids;
+        WeldPositions(ids, points);
+        num_positions = ids.empty() ? 0 : *std::max_element(ids.begin(), ids.end()) + 1;
+        parallel_for_blocked(0, num_indices, 8192, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                corner_pos[i] = ids[points_flattened ? i : indices[i]];
+            }
+        });
+    }
+    ConnectionData connection;
+    impl::BuildConnection(connection, corner_pos, counts, IArray<float3>(nullptr, num_positions));
+
+    // sort faces by morton code of their first vertex (counting sort. 32 cells per axis)
+    const int CellBits = 5;
+    const int NumCells = 1 << (CellBits * 3);
+    RawVector<int> face_cells(num_faces);
+    RawVector<int> sorted_faces(num_faces);
+    {
+        float3 bmin, bmax;
+        MinMax(points.data(), points.size(), bmin, bmax);
+        float3 scale = float3::zero();
+        for (int i = 0; i < 3; ++i) {
+            float extent = bmax[i] - bmin[i];
+            if (extent > 0.0f) { scale[i] = ((1 << CellBits) - 1) / extent; }
+        }
+        parallel_for_blocked(0, num_faces, 8192, [&](int begin, int end) {
+            for (int fi = begin; fi < end; ++fi) {
+                int ci = offsets[fi];
+                float3 c = (points[points_flattened ? ci : indices[ci]] - bmin) * scale;
+                face_cells[fi] =
+                    (MortonPart1By2((uint32_t)c.x) << 2) |
+                    (MortonPart1By2((uint32_t)c.y) << 1) |
+                    (MortonPart1By2((uint32_t)c.z) << 0);
+            }
+        });
+
+        RawVector<int> cell_offsets(NumCells);
+        cell_offsets.zeroclear();
+        for (int cell : face_cells) { ++cell_offsets[cell]; }
+        int offset = 0;
+        for (auto& n : cell_offsets) {
+            int c = n;
+            n = offset;
+            offset += c;
+        }
+        for (int fi = 0; fi < num_faces; ++fi) {
+            sorted_faces[cell_offsets[face_cells[fi]]++] = fi;
+        }
+    }
+
+    int num_chunks = ceildiv(num_faces, TangentChunkSize);
+    RawVector<int>& face_chunks = face_cells; // reuse
+    for (int ci = 0; ci < num_chunks; ++ci) {
+        int begin = ci * TangentChunkSize;
+        int end = std::min(begin + TangentChunkSize, num_faces);
+        for (int i = begin; i < end; ++i) {
+            face_chunks[sorted_faces[i]] = ci;
+        }
+    }
+
+    // per face-vertex tangents. write to dst directly if it is flattened.
+    bool dst_flattened = ctx.dst.size() == indices.size();
+    RawVector<float4> corner_tangents;
+    IArray<float4> corner_dst = ctx.dst;
+    if (!dst_flattened) {
+        corner_tangents.resize_discard(num_indices);
+        corner_dst = corner_tangents;
+    }
+
+    RawVector<int> results(num_chunks); // 1: succeeded, 0: failed, -1: no faces mikktspace can handle
+    parallel_for(0, num_chunks, 1, [&](int ci) {
+        int begin = ci * TangentChunkSize;
+        int end = std::min(begin + TangentChunkSize, num_faces);
+
+        RawVector<int> faces;
+        faces.assign(&sorted_faces[begin], &sorted_faces[end]);
+        bool has_valid_faces = false;
+        for (int i = begin; i < end; ++i) {
+            int fi = sorted_faces[i];
+            int count = counts[fi];
+            has_valid_faces |= count == 3 || count == 4;
+
+            int offset = offsets[fi];
+            for (int vi = 0; vi < count; ++vi) {
+                connection.eachConnectedFaces(corner_pos[offset + vi], [&](int f, int) {
+                    if (face_chunks[f] != ci) { faces.push_back(f); }
+                });
+            }
+        }
+        if (!has_valid_faces) {
+            results[ci] = -1;
+            return;
+        }
+        std::sort(faces.begin(), faces.end());
+        faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+
+        TSpaceContext cctx = ctx;
+        cctx.dst = corner_dst;
+        cctx.face_map = faces.data();
+        cctx.face_chunks = face_chunks.data();
+        cctx.num_faces = (int)faces.size();
+        cctx.chunk = ci;
+        results[ci] = cctx.generate() ? 1 : 0;
+    });
+
+    bool ret = false;
+    for (int r : results) {
+        if (r == 0) { return false; }
+        if (r == 1) { ret = true; }
+    }
+
+    // indexed output: the last face that references a vertex wins, as in the serial version
+    if (!dst_flattened) {
+        for (int fi = 0; fi < num_faces; ++fi) {
+            int count = counts[fi];
+            if (count != 3 && count != 4) { continue; }
+            int offset = offsets[fi];
+            for (int vi = 0; vi < count; ++vi) {
+                ctx.dst[indices[offset + vi]] = corner_tangents[offset + vi];
+            }
+        }
+    }
+    return ret;
+}
+
 bool GenerateTangentsPoly(
     IArray<float4> dst, const IArray<float3> points, const IArray<float3> normals, const IArray<float2> uv,
     const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices)
 {
-    TSpaceContext ctx = {dst, points, normals, uv, counts, offsets, indices};
-
-    SMikkTSpaceInterface iface;
-    memset(&iface, 0, sizeof(iface));
-    iface.m_getNumFaces = TSpaceContext::getNumFaces;
-    iface.m_getNumVerticesOfFace = TSpaceContext::getCount;
-    iface.m_getPosition = points.size()  == indices.size() ? TSpaceContext::getPositionFlattened : TSpaceContext::getPosition;
-    iface.m_getNormal   = normals.size() == indices.size() ? TSpaceContext::getNormalFlattened : TSpaceContext::getNormal;
-    iface.m_getTexCoord = uv.size()      == indices.size() ? TSpaceContext::getTexCoordFlattened : TSpaceContext::getTexCoord;
-    iface.m_setTSpace   = dst.size()     == indices.size() ? TSpaceContext::setTangentFlattened : TSpaceContext::setTangent;
-
-    SMikkTSpaceContext tctx;
-    memset(&tctx, 0, sizeof(tctx));
-    tctx.m_pInterface = &iface;
-    tctx.m_pUserData = &ctx;
-
-    return genTangSpaceDefault(&tctx) != 0;
+    return GenerateTangentsPoly(dst, points, normals, uv, counts, offsets, indices, true);
+}
+
+bool GenerateTangentsPoly(
+    IArray<float4> dst, const IArray<float3> points, const IArray<float3> normals, const IArray<float2> uv,
+    const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    bool chunked)
+{
+    TSpaceContext ctx = {dst, points, normals, uv, counts, offsets, indices, nullptr, nullptr, 0, 0};
+    if (chunked && (int)counts.size() >= TangentChunkSize * 2) {
+        return GenerateTangentsChunked(ctx);
+    }
+    return ctx.generate();
 }
 
 
 
+// copy the k largest weights of src to dst in descending order and normalize them. returns the number of copied weights.
+// if n <= k, src is copied as it is.
+static int SelectWeights(int *dst_indices, float *dst_weights, const int *src_indices, const float *src_weights, int n, int k)
+{
+    if (n <= k) {
+        std::copy(src_indices, src_indices + n, dst_indices);
+        std::copy(src_weights, src_weights + n, dst_weights);
+        return n;
+    }
+
+    // insertion into the sorted top k
+    int num = 0;
+    for (int i = 0; i < n; ++i) {
+        float w = src_weights[i];
+        if (num == k && w <= dst_weights[k - 1]) { continue; }
+
+        int j = num < k ? num++ : k - 1;
+        for (; j > 0 && dst_weights[j - 1] < w; --j) {
+            dst_indices[j] = dst_indices[j - 1];
+            dst_weights[j] = dst_weights[j - 1];
+        }
+        dst_indices[j] = src_indices[i];
+        dst_weights[j] = w;
+    }
+
+    // normalize weights
+    float total = 0.0f;
+    for (int i = 0; i < k; ++i) { total += dst_weights[i]; }
+    if (total > 0.0f) {
+        float rcp_total = 1.0f / total;
+        for (int i = 0; i < k; ++i) { dst_weights[i] *= rcp_total; }
+    }
+    return k;
+}
+
+// M: influences per vertex of the kernel. fewer influences are padded with weights that are never selected.
+template<int M, class WeightsN, class Kernel>
+static void SelectWeightsBlocked(WeightsN *dst, const int *bone_indices, const float *bone_weights, int bones_per_vertex, int num,
+    const Kernel& kernel)
+{
+    parallel_for_blocked(0, num, 1024, [&](int begin, int end) {
+        int n = end - begin;
+        const int *src_indices = bone_indices + bones_per_vertex * begin;
+        const float *src_weights = bone_weights + bones_per_vertex * begin;
+        if (bones_per_vertex == M) {
+            kernel(dst + begin, src_indices, src_weights, n);
+            return;
+        }
+
+        RawVector<int> indices;
+        RawVector<float> weights;
+        indices.resize_zeroclear(M * n);
+        weights.resize(M * n, -FLT_MAX);
+        for (int vi = 0; vi < n; ++vi) {
+            std::copy(src_indices + bones_per_vertex * vi, src_indices + bones_per_vertex * (vi + 1), &indices[M * vi]);
+            std::copy(src_weights + bones_per_vertex * vi, src_weights + bones_per_vertex * (vi + 1), &weights[M * vi]);
+        }
+        kernel(dst + begin, indices.data(), weights.data(), n);
+    });
+}
+
+// sorting network kernels (muSIMD.h) for up to 16 influences. returns false if there is none
+static bool SelectWeightsSIMD(Weights4 *dst, const int *bone_indices, const float *bone_weights, int bones_per_vertex, int num)
+{
+    if (bones_per_vertex <= 8) {
+        SelectWeightsBlocked<8>(dst, bone_indices, bone_weights, bones_per_vertex, num, SelectWeights8To4);
+        return true;
+    }
+    if (bones_per_vertex <= 16) {
+        SelectWeightsBlocked<16>(dst, bone_indices, bone_weights, bones_per_vertex, num, SelectWeights16To4);
+        return true;
+    }
+    return false;
+}
+static bool SelectWeightsSIMD(Weights8 *dst, const int *bone_indices, const float *bone_weights, int bones_per_vertex, int num)
+{
+    if (bones_per_vertex <= 16) {
+        SelectWeightsBlocked<16>(dst, bone_indices, bone_weights, bones_per_vertex, num, SelectWeights16To8);
+        return true;
+    }
+    return false;
+}
+
 template<int N>
 bool GenerateWeightsN(RawVector<Weights<N>>& dst, IArray<int> bone_indices, IArray<float> bone_weights, int bones_per_vertex)
 {
@@ -167,41 +528,62 @@ bool GenerateWeightsN(RawVector<Weights<N>>& dst, IArray<int> bone_indices, IArr
             }
         }
     }
-    else {
-        int *order = (int*)alloca(sizeof(int) * bones_per_vertex);
-        for (int wi = 0; wi < num_weightsN; ++wi) {
-            auto *bindices = &bone_indices[bones_per_vertex * wi];
-            auto *bweights = &bone_weights[bones_per_vertex * wi];
-
-            // sort order
-            std::iota(order, order + bones_per_vertex, 0);
-            std::nth_element(order, order + N, order + bones_per_vertex,
-                [&](int a, int b) { return bweights[a] > bweights[b]; });
-
-            // copy (up to) N elements
-            auto& w4 = dst[wi];
-            float w = 0.0f;
-            for (int oi = 0; oi < N; ++oi) {
-                int o = order[oi];
-                w4.indices[oi] = bindices[o];
-                w4.weights[oi] = bweights[o];
-                w += bweights[o];
+    // select N largest weights and normalize them
+    else if (!SelectWeightsSIMD(dst.data(), bone_indices.data(), bone_weights.data(), bones_per_vertex, num_weightsN)) {
+        parallel_for_blocked(0, num_weightsN, 1024, [&](int begin, int end) {
+            for (int wi = begin; wi < end; ++wi) {
+                SelectWeights(dst[wi].indices, dst[wi].weights,
+                    &bone_indices[bones_per_vertex * wi], &bone_weights[bones_per_vertex * wi], bones_per_vertex, N);
             }
-
-            // normalize weights
-            float rcpw = 1.0f / w;
-            for (int oi = 0; oi < N; ++oi) {
-                w4.weights[oi] *= rcpw;
-            }
-        }
+        });
     }
     return true;
 }
 template bool GenerateWeightsN(RawVector<Weights<4>>& dst, IArray<int> bone_indices, IArray<float> bone_weights, int bones_per_vertex);
 template bool GenerateWeightsN(RawVector<Weights<8>>& dst, IArray<int> bone_indices, IArray<float> bone_weights, int bones_per_vertex);
 
+bool LimitWeights(RawVector<int>& dst_counts, RawVector<int>& dst_bone_indices, RawVector<float>& dst_bone_weights,
+    const IArray<int> counts, const IArray<int> bone_indices, const IArray<float> bone_weights, int max_influences)
+{
+    if (bone_indices.size() != bone_weights.size() || max_influences <= 0) {
+        return false;
+    }
+
+    int num_vertices = (int)counts.size();
+    RawVector<int> offsets, dst_offsets;
+    offsets.resize_discard(num_vertices);
+    dst_offsets.resize_discard(num_vertices);
+    dst_counts.resize_discard(num_vertices);
+
+    int num_influences = 0, num_dst_influences = 0;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        int count = std::min(counts[vi], max_influences);
+        offsets[vi] = num_influences;
+        dst_offsets[vi] = num_dst_influences;
+        dst_counts[vi] = count;
+        num_influences += counts[vi];
+        num_dst_influences += count;
+    }
+    if (num_influences != (int)bone_indices.size()) {
+        return false;
+    }
+
+    dst_bone_indices.resize_discard(num_dst_influences);
+    dst_bone_weights.resize_discard(num_dst_influences);
+    parallel_for_blocked(0, num_vertices, 1024, [&](int begin, int end) {
+        for (int vi = begin; vi < end; ++vi) {
+            int src = offsets[vi];
+            int dst = dst_offsets[vi];
+            SelectWeights(&dst_bone_indices[dst], &dst_bone_weights[dst],
+                &bone_indices[src], &bone_weights[src], counts[vi], max_influences);
+        }
+    });
+    return true;
+}
+
 
-inline int check_overlap(const int *a, const int *b)
+template<class IndexT>
+inline int check_overlap(const IndexT *a, const IndexT *b)
 {
     int i00 = a[0], i01 = a[1], i02 = a[2];
     int i10 = b[0], i11 = b[1], i12 = b[2];
@@ -218,8 +600,9 @@ inline int check_overlap(const int *a, const int *b)
     return ret;
 }
 
-void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> indices, bool full_search, float threshold_angle,
-    RawVector<int>& dst_indices, RawVector<int>& dst_counts)
+template<class IndexT>
+static void QuadifyTrianglesImpl(const IArray<float3> vertices, const IArray<IndexT> indices, bool full_search, float threshold_angle,
+    RawVector<IndexT>& dst_indices, RawVector<int>& dst_counts)
 {
     struct Connection
     {
@@ -334,6 +717,219 @@ void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> indices,
     }
 }
 
+void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> indices, bool full_search, float threshold_angle,
+    RawVector<int>& dst_indices, RawVector<int>& dst_counts)
+{
+    QuadifyTrianglesImpl(vertices, indices, full_search, threshold_angle, dst_indices, dst_counts);
+}
+
+void QuadifyTriangles(const IArray<float3> vertices, const IArray<uint16_t> indices, bool full_search, float threshold_angle,
+    RawVector<uint16_t>& dst_indices, RawVector<int>& dst_counts)
+{
+    QuadifyTrianglesImpl(vertices, indices, full_search, threshold_angle, dst_indices, dst_counts);
+}
+
+
+// vertex cache optimization
+// (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation")
+
+static const float kCacheDecayPower = 1.5f;
+static const float kLastFaceScore = 0.75f;
+static const float kValenceBoostScale = 2.0f;
+
+// score vertices at cache position [0, num).
+// plain loop without branches so that the compiler can vectorize it. it runs on at most cache_size
+// vertices per emitted face, which is too short for a call into an ISPC kernel to pay off.
+static inline void ComputeVertexCacheScores(float *dst, const int *valences, int num, int num_last, int cache_size)
+{
+    float scale = 1.0f / (float)std::max(cache_size - num_last, 1);
+    for (int i = 0; i < num; ++i) {
+        float cs = std::pow(std::max(1.0f - (float)(i - num_last) * scale, 0.0f), kCacheDecayPower);
+        cs = i < num_last ? kLastFaceScore : cs;
+        float vs = kValenceBoostScale / std::sqrt((float)std::max(valences[i], 1));
+        dst[i] = valences[i] == 0 ? -1.0f : cs + vs;
+    }
+}
+
+static inline float VertexScoreUncached(int valence)
+{
+    return valence == 0 ? -1.0f : kValenceBoostScale / std::sqrt((float)valence);
+}
+
+// heap order: higher score first, then lower face index
+struct ScoredFace
+{
+    float score;
+    int face;
+
+    bool operator<(const ScoredFace& v) const { return score < v.score || (score == v.score && face > v.face); }
+};
+
+void OptimizeVertexCache(const IArray<int> counts, const IArray<int> indices, int num_vertices, int cache_size,
+    RawVector<int>& dst_counts, RawVector<int>& dst_indices)
+{
+    int num_faces = (int)counts.size();
+    int num_indices = (int)indices.size();
+    cache_size = std::max(cache_size, 4);
+
+    RawVector<int> offsets;
+    {
+        int num_indices_counted, num_indices_triangulated;
+        CountIndices(counts, offsets, num_indices_counted, num_indices_triangulated);
+    }
+
+    ConnectionData connection;
+    impl::BuildConnection(connection, indices, counts, IArray<float3>(nullptr, num_vertices));
+
+    // remaining valence of each vertex
+    RawVector<int> valences = connection.v2f_counts;
+
+    RawVector<float> vertex_scores(num_vertices);
+    RawVector<int> stamps(num_vertices);
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        vertex_scores[vi] = VertexScoreUncached(valences[vi]);
+        stamps[vi] = -1;
+    }
+
+    RawVector<float> face_scores(num_faces);
+    RawVector<char> emitted(num_faces);
+    emitted.zeroclear();
+
+    // max-heap of faces for the fallback when the cache has no candidates.
+    // at that point no remaining face has a cached vertex, so faces are pushed only when
+    // they are rescored without cache. outdated entries are skipped when popped.
+    RawVector<ScoredFace> face_heap;
+    face_heap.reserve(num_faces);
+    auto push_face = [&](int fi) {
+        face_heap.push_back({ face_scores[fi], fi });
+        std::push_heap(face_heap.begin(), face_heap.end());
+    };
+
+    auto score_face = [&](int fi) {
+        int count = counts[fi];
+        const int *face = &indices[offsets[fi]];
+        float score = 0.0f;
+        for (int ci = 0; ci < count; ++ci) {
+            score += vertex_scores[face[ci]];
+        }
+        face_scores[fi] = score;
+    };
+    for (int fi = 0; fi < num_faces; ++fi) {
+        score_face(fi);
+        push_face(fi);
+    }
+
+    RawVector<int> cache, new_cache, cache_valences;
+    RawVector<float> cache_scores;
+    dst_counts.resize_discard(num_faces);
+    dst_indices.resize_discard(num_indices);
+
+    int best_face = -1;
+    int ii = 0;
+    for (int nth = 0; nth < num_faces; ++nth) {
+        while (best_face == -1) {
+            // no candidates in the cache. take the best scored face of all remaining ones.
+            ScoredFace top = face_heap.front();
+            std::pop_heap(face_heap.begin(), face_heap.end());
+            face_heap.pop_back();
+            if (!emitted[top.face] && face_scores[top.face] == top.score) {
+                best_face = top.face;
+            }
+        }
+
+        int fi = best_face;
+        int count = counts[fi];
+        const int *face = &indices[offsets[fi]];
+        emitted[fi] = 1;
+        dst_counts[nth] = count;
+        for (int ci = 0; ci < count; ++ci) {
+            dst_indices[ii++] = face[ci];
+        }
+
+        // vertices of the emitted face go to the front of the cache. others keep LRU order.
+        new_cache.clear();
+        for (int ci = 0; ci < count; ++ci) {
+            int vi = face[ci];
+            --valences[vi];
+            if (stamps[vi] != nth) {
+                stamps[vi] = nth;
+                new_cache.push_back(vi);
+            }
+        }
+        int num_last = (int)new_cache.size();
+        for (int vi : cache) {
+            if (stamps[vi] != nth) {
+                stamps[vi] = nth;
+                new_cache.push_back(vi);
+            }
+        }
+
+        // rescore vertices pushed out of the cache
+        for (int k = cache_size; k < (int)new_cache.size(); ++k) {
+            int vi = new_cache[k];
+            vertex_scores[vi] = VertexScoreUncached(valences[vi]);
+        }
+        int num_evicted = std::max((int)new_cache.size() - cache_size, 0);
+        int num_cached = (int)new_cache.size() - num_evicted;
+
+        // rescore cached vertices
+        cache_valences.resize_discard(num_cached);
+        cache_scores.resize_discard(num_cached);
+        for (int k = 0; k < num_cached; ++k) {
+            cache_valences[k] = valences[new_cache[k]];
+        }
+        ComputeVertexCacheScores(cache_scores.data(), cache_valences.data(), num_cached, num_last, cache_size);
+        for (int k = 0; k < num_cached; ++k) {
+            vertex_scores[new_cache[k]] = cache_scores[k];
+        }
+
+        // update scores of faces affected and pick the best candidate
+        float best_score = 0.0f;
+        best_face = -1;
+        for (int k = 0; k < (int)new_cache.size(); ++k) {
+            bool cached = k < num_cached;
+            connection.eachConnectedFaces(new_cache[k], [&](int cfi, int) {
+                if (emitted[cfi]) { return; }
+                score_face(cfi);
+                if (!cached) {
+                    push_face(cfi);
+                }
+                else if (best_face == -1 || face_scores[cfi] > best_score) {
+                    best_face = cfi;
+                    best_score = face_scores[cfi];
+                }
+            });
+        }
+
+        new_cache.resize(num_cached);
+        cache.swap(new_cache);
+    }
+}
+
+void OptimizeVertexFetch(IArray<int> indices, int num_vertices, RawVector<int>& dst_new2old)
+{
+    RawVector<int> old2new;
+    old2new.resize(num_vertices, -1);
+    dst_new2old.resize_discard(num_vertices);
+
+    int n = 0;
+    for (auto& i : indices) {
+        int& ni = old2new[i];
+        if (ni == -1) {
+            ni = n;
+            dst_new2old[n++] = i;
+        }
+        i = ni;
+    }
+
+    // unreferenced vertices
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        if (old2new[vi] == -1) {
+            dst_new2old[n++] = vi;
+        }
+    }
+}
+
 void ConnectionData::clear()
 {
     v2f_counts.clear();
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
 #include "muRawVector.h"
 #include "muIntrusiveArray.h"
 #include "muMath.h"
@@ -10,17 +11,39 @@
 #include "muTLS.h"
 #include "muMisc.h"
 #include "muConcurrency.h"
+#include "muHash.h"
 
 namespace mu {
 
+struct ConnectionData;
+
 bool GenerateNormalsPoly(
     IArray<float3> dst, const IArray<float3> points,
     const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices);
 
+// face normals are computed in parallel. if connection is given, they are gathered per vertex in parallel,
+// otherwise scattered serially. the result is the same either way.
+// flip: swap 2nd and 3rd vertex of faces.
+void GenerateNormalsPoly(
+    IArray<float3> dst, const IArray<float3> points,
+    const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    bool flip, const ConnectionData *connection);
+
+// non-normalized normal of each face. (cross product of its first 3 vertices)
+void GenerateFaceNormals(
+    IArray<float3> dst, const IArray<float3> points, const IArray<int> offsets, const IArray<int> indices, bool flip = false);
+
 bool GenerateTangentsPoly(
     IArray<float4> dst, const IArray<float3> points, const IArray<float3> normals, const IArray<float2> uv,
     const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices);
 
+// meshes with many faces are split into chunks that run mikktspace in parallel if chunked is true.
+// the result is the same as the serial one as long as edges are manifold.
+bool GenerateTangentsPoly(
+    IArray<float4> dst, const IArray<float3> points, const IArray<float3> normals, const IArray<float2> uv,
+    const IArray<int> counts, const IArray<int> offsets, const IArray<int> indices,
+    bool chunked);
+
 // PointsIter: indexed_iterator<const float3*, int*> or indexed_iterator_s<const float3*, int*>
 template<class PointsIter>
 void GenerateNormalsPoly(float3 *dst,
@@ -35,11 +58,36 @@ void GenerateTangentsPoly(float4 *dst,
     const int *counts, const int *offsets, const int *indices,
     int num_faces, int num_vertices);
 
+// the N largest weights of each vertex in descending order, normalized. vertices are processed in parallel and
+// sorting networks (SelectWeights8To4() etc.) are used for up to 16 bones per vertex.
 template<int N>
 bool GenerateWeightsN(RawVector<Weights<N>>& dst, IArray<int> bone_indices, IArray<float> bone_weights, int bones_per_vertex);
 
+// bone influences in CSR form: counts[vertex] influences per vertex, and bone_indices / bone_weights of all vertices in a row.
+// vertices with more than max_influences influences keep the largest ones (in descending order) renormalized.
+// other vertices are copied as they are.
+// vertices are processed in parallel.
+bool LimitWeights(RawVector<int>& dst_counts, RawVector<int>& dst_bone_indices, RawVector<float>& dst_bone_weights,
+    const IArray<int> counts, const IArray<int> bone_indices, const IArray<float> bone_weights, int max_influences);
+
 void QuadifyTriangles(const IArray<float3> vertices, const IArray<int> indices, bool full_search, float threshold_angle,
     RawVector<int>& dst_indices, RawVector<int>& dst_counts);
+// 16 bit indices. quads are made of the vertices of the triangles, so indices stay 16 bit.
+void QuadifyTriangles(const IArray<float3> vertices, const IArray<uint16_t> indices, bool full_search, float threshold_angle,
+    RawVector<uint16_t>& dst_indices, RawVector<int>& dst_counts);
+
+// reorder faces to improve post-transform vertex cache hits (Tom Forsyth's algorithm).
+// faces can be any n-gon. cache_size is the size of the simulated LRU cache.
+void OptimizeVertexCache(const IArray<int> counts, const IArray<int> indices, int num_vertices, int cache_size,
+    RawVector<int>& dst_counts, RawVector<int>& dst_indices);
+
+// reorder vertices in order of first reference to improve vertex fetch locality.
+// indices are remapped in-place. dst_new2old[new vertex index] = old vertex index.
+// vertices not referenced by indices are placed last.
+void OptimizeVertexFetch(IArray<int> indices, int num_vertices, RawVector<int>& dst_new2old);
+
+// dst: id of each distinct position. ids are numbered in order of first appearance. -0.0 and 0.0 are the same position.
+void WeldPositions(RawVector<int>& dst, const IArray<float3> points);
 
 struct ConnectionData
 {
@@ -341,3 +389,6 @@ inline uint32_t Float4ToColor32(const float4& c)
 
 #include "MeshUtils_impl.h"
 #include "muMeshRefiner.h"
+#include "muMeshDecimator.h"
+#include "muBVH.h"
+#include "muTerrain.h"
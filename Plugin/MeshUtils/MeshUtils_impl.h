@@ -32,50 +32,132 @@ struct OffsetsC
 };
 
 
+// dst[i] = sum of src[0, i). dst and src can be the same. returns the total.
+inline int ExclusiveScan(int *dst, const int *src, int num, int block_size = 8192)
+{
+    int num_blocks = ceildiv(num, block_size);
+    RawVector<int> block_sums(num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = block_size * bi;
+        int end = std::min<int>(begin + block_size, num);
+        int sum = 0;
+        for (int i = begin; i < end; ++i) { sum += src[i]; }
+        block_sums[bi] = sum;
+    });
+
+    int total = 0;
+    for (int bi = 0; bi < num_blocks; ++bi) {
+        int sum = block_sums[bi];
+        block_sums[bi] = total;
+        total += sum;
+    }
+
+    parallel_for(0, num_blocks, [&](int bi) {
+        int begin = block_size * bi;
+        int end = std::min<int>(begin + block_size, num);
+        int sum = block_sums[bi];
+        for (int i = begin; i < end; ++i) {
+            int c = src[i];
+            dst[i] = sum;
+            sum += c;
+        }
+    });
+    return total;
+}
+
+// Body: [](int face_index, int index_index, int vertex_index) -> void
+template<class Indices, class Counts, class Body>
+inline void EnumerateIndices(const Indices& indices, const Counts& counts, int face_begin, int face_end, int index_begin, const Body& body)
+{
+    int ii = index_begin;
+    for (int fi = face_begin; fi < face_end; ++fi) {
+        int c = counts[fi];
+        for (int ci = 0; ci < c; ++ci) {
+            body(fi, ii + ci, indices[ii + ci]);
+        }
+        ii += c;
+    }
+}
+
 template<class Indices, class Counts>
 inline void BuildConnection(
     ConnectionData& connection, const Indices& indices, const Counts& counts, const IArray<float3>& vertices)
 {
-    size_t num_points = vertices.size();
-    size_t num_faces = counts.size();
-    size_t num_indices = indices.size();
+    // each block has a counter per vertex, so the number of blocks is kept small
+    const int max_blocks = 8;
+
+    int num_points = (int)vertices.size();
+    int num_faces = (int)counts.size();
+    int num_indices = (int)indices.size();
+    int block_size = std::max(4096, ceildiv(num_faces, max_blocks)); // in faces
+    int num_blocks = ceildiv(num_faces, block_size);
 
     connection.v2f_offsets.resize_discard(num_points);
     connection.v2f_faces.resize_discard(num_indices);
     connection.v2f_indices.resize_discard(num_indices);
-
     connection.v2f_counts.resize_zeroclear(num_points);
-    {
-        int ii = 0;
-        for (size_t fi = 0; fi < num_faces; ++fi) {
-            int c = counts[fi];
-            for (int ci = 0; ci < c; ++ci) {
-                connection.v2f_counts[indices[ii + ci]]++;
-            }
-            ii += c;
-        }
 
-        int offset = 0;
-        for (size_t i = 0; i < num_points; ++i) {
-            connection.v2f_offsets[i] = offset;
-            offset += connection.v2f_counts[i];
-        }
+    if (num_blocks <= 1) {
+        EnumerateIndices(indices, counts, 0, num_faces, 0, [&](int, int, int vi) {
+            connection.v2f_counts[vi]++;
+        });
+        ExclusiveScan(connection.v2f_offsets.data(), connection.v2f_counts.data(), num_points);
+
+        connection.v2f_counts.zeroclear();
+        EnumerateIndices(indices, counts, 0, num_faces, 0, [&](int fi, int ii, int vi) {
+            int ti = connection.v2f_offsets[vi] + connection.v2f_counts[vi]++;
+            connection.v2f_faces[ti] = fi;
+            connection.v2f_indices[ti] = ii;
+        });
+        return;
     }
 
-    connection.v2f_counts.zeroclear();
-    {
-        int i = 0;
-        for (int fi = 0; fi < (int)num_faces; ++fi) {
-            int c = counts[fi];
-            for (int ci = 0; ci < c; ++ci) {
-                int vi = indices[i + ci];
-                int ti = connection.v2f_offsets[vi] + connection.v2f_counts[vi]++;
-                connection.v2f_faces[ti] = fi;
-                connection.v2f_indices[ti] = i + ci;
+    // first index of each face block
+    RawVector<int> block_offsets(num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int fend = std::min<int>(block_size * (bi + 1), num_faces);
+        int sum = 0;
+        for (int fi = block_size * bi; fi < fend; ++fi) { sum += counts[fi]; }
+        block_offsets[bi] = sum;
+    });
+    ExclusiveScan(block_offsets.data(), block_offsets.data(), num_blocks);
+
+    // count faces connected to each vertex in each block
+    RawVector<int> block_counts((size_t)num_points * num_blocks);
+    parallel_for(0, num_blocks, [&](int bi) {
+        int *bcounts = &block_counts[(size_t)num_points * bi];
+        memset(bcounts, 0, sizeof(int) * num_points);
+        int fend = std::min<int>(block_size * (bi + 1), num_faces);
+        EnumerateIndices(indices, counts, block_size * bi, fend, block_offsets[bi], [&](int, int, int vi) {
+            bcounts[vi]++;
+        });
+    });
+
+    // turn block counts into the position of each block's first face in the vertex's list
+    parallel_for_blocked(0, num_points, 8192, [&](int begin, int end) {
+        for (int vi = begin; vi < end; ++vi) {
+            int sum = 0;
+            for (int bi = 0; bi < num_blocks; ++bi) {
+                int& c = block_counts[(size_t)num_points * bi + vi];
+                int n = c;
+                c = sum;
+                sum += n;
             }
-            i += c;
+            connection.v2f_counts[vi] = sum;
         }
-    }
+    });
+    ExclusiveScan(connection.v2f_offsets.data(), connection.v2f_counts.data(), num_points);
+
+    // scatter. blocks write to disjoint ranges of each list in face order, so lists are ordered by index.
+    parallel_for(0, num_blocks, [&](int bi) {
+        int *bpos = &block_counts[(size_t)num_points * bi];
+        int fend = std::min<int>(block_size * (bi + 1), num_faces);
+        EnumerateIndices(indices, counts, block_size * bi, fend, block_offsets[bi], [&](int fi, int ii, int vi) {
+            int ti = connection.v2f_offsets[vi] + bpos[vi]++;
+            connection.v2f_faces[ti] = fi;
+            connection.v2f_indices[ti] = ii;
+        });
+    });
 }
 
 inline void BuildWeldMap(
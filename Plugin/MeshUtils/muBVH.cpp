@@ -0,0 +1,601 @@
+#include "pch.h"
+#include "MeshUtils.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+    #define muBVHSSE2
+    #include <emmintrin.h>
+#endif
+
+namespace mu {
+
+// ranges larger than this are binned in parallel and their children are built in parallel
+static const int BVHParallelThreshold = 16 * 1024;
+static const int BVHBinBlockSize = 8 * 1024;
+// cost of visiting a node relative to a ray-triangle test
+static const float BVHTraversalCost = 1.0f;
+// deeper nodes are split at the median to keep the traversal stack bounded
+static const int BVHMaxDepth = 48;
+static const int BVHStackSize = 128;
+
+struct BVHBounds
+{
+    float3 bmin, bmax;
+
+    void reset()
+    {
+        bmin = { FLT_MAX, FLT_MAX, FLT_MAX };
+        bmax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    }
+    void expand(const float3& p)
+    {
+        bmin = min(bmin, p);
+        bmax = max(bmax, p);
+    }
+    void expand(const BVHBounds& b)
+    {
+        bmin = min(bmin, b.bmin);
+        bmax = max(bmax, b.bmax);
+    }
+    // half of the surface area
+    float area() const
+    {
+        float3 d = bmax - bmin;
+        if (d.x < 0.0f) { return 0.0f; }
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+struct BVHBins
+{
+    // small nodes use fewer bins
+    int num_bins = TriangleBVH::NumBins;
+    BVHBounds bounds[3][TriangleBVH::NumBins];
+    int counts[3][TriangleBVH::NumBins];
+
+    void reset(int n)
+    {
+        num_bins = n;
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < num_bins; ++b) {
+                bounds[a][b].reset();
+                counts[a][b] = 0;
+            }
+        }
+    }
+    void merge(const BVHBins& v)
+    {
+        for (int a = 0; a < 3; ++a) {
+            for (int b = 0; b < num_bins; ++b) {
+                bounds[a][b].expand(v.bounds[a][b]);
+                counts[a][b] += v.counts[a][b];
+            }
+        }
+    }
+};
+
+struct BVHBuildNode
+{
+    BVHBounds bounds;
+    int begin = 0, end = 0;
+    int axis = 0;
+    std::unique_ptr<BVHBuildNode> children[2];
+};
+
+// triangle reference. bounds are stored directly (not through the triangle index) so that
+// partitioning and binning access memory sequentially.
+struct BVHRef
+{
+    float3 bmin;
+    int id;
+    float3 bmax;
+    int pad;
+
+    float3 centroid() const { return (bmin + bmax) * 0.5f; }
+};
+
+struct BVHBuilder
+{
+    RawVector<BVHRef> refs;
+
+    // bounds of triangles and bounds of their centroids
+    void computeBounds(int begin, int end, BVHBounds& bounds, BVHBounds& cbounds) const
+    {
+        auto body = [this](int b, int e, BVHBounds& bo, BVHBounds& cb) {
+            bo.reset();
+            cb.reset();
+            for (int i = b; i < e; ++i) {
+                auto& r = refs[i];
+                bo.bmin = min(bo.bmin, r.bmin);
+                bo.bmax = max(bo.bmax, r.bmax);
+                cb.expand(r.centroid());
+            }
+        };
+
+        int n = end - begin;
+        if (n <= BVHParallelThreshold) {
+            body(begin, end, bounds, cbounds);
+            return;
+        }
+
+        int num_blocks = ceildiv(n, BVHBinBlockSize);
+        RawVector<BVHBounds> partial;
+        partial.resize_discard(num_blocks * 2);
+        parallel_for(0, num_blocks, [&](int bi) {
+            int b = begin + bi * BVHBinBlockSize;
+            body(b, std::min(b + BVHBinBlockSize, end), partial[bi * 2 + 0], partial[bi * 2 + 1]);
+        });
+        bounds.reset();
+        cbounds.reset();
+        for (int bi = 0; bi < num_blocks; ++bi) {
+            bounds.expand(partial[bi * 2 + 0]);
+            cbounds.expand(partial[bi * 2 + 1]);
+        }
+    }
+
+    static int binIndex(float v, float base, float scale, int num_bins)
+    {
+        int b = (int)((v - base) * scale);
+        return std::min(std::max(b, 0), num_bins - 1);
+    }
+
+    void binning(int begin, int end, const BVHBounds& cbounds, int num_bins, BVHBins& dst) const
+    {
+        float3 scale;
+        for (int a = 0; a < 3; ++a) {
+            float ext = cbounds.bmax[a] - cbounds.bmin[a];
+            scale[a] = ext > 0.0f ? (float)num_bins / ext : 0.0f;
+        }
+        auto body = [&](int b, int e, BVHBins& bins) {
+            bins.reset(num_bins);
+            for (int i = b; i < e; ++i) {
+                auto& r = refs[i];
+                float3 c = r.centroid();
+                for (int a = 0; a < 3; ++a) {
+                    int bi = binIndex(c[a], cbounds.bmin[a], scale[a], num_bins);
+                    auto& bb = bins.bounds[a][bi];
+                    bb.bmin = min(bb.bmin, r.bmin);
+                    bb.bmax = max(bb.bmax, r.bmax);
+                    bins.counts[a][bi]++;
+                }
+            }
+        };
+
+        int n = end - begin;
+        if (n <= BVHParallelThreshold) {
+            body(begin, end, dst);
+            return;
+        }
+
+        int num_blocks = ceildiv(n, BVHBinBlockSize);
+        std::vector<BVHBins> partial(num_blocks);
+        parallel_for(0, num_blocks, [&](int bi) {
+            int b = begin + bi * BVHBinBlockSize;
+            body(b, std::min(b + BVHBinBlockSize, end), partial[bi]);
+        });
+        dst = partial[0];
+        for (int bi = 1; bi < num_blocks; ++bi) {
+            dst.merge(partial[bi]);
+        }
+    }
+
+    void buildNode(BVHBuildNode& node, int depth)
+    {
+        int n = node.end - node.begin;
+        BVHBounds cbounds;
+        computeBounds(node.begin, node.end, node.bounds, cbounds);
+        if (n == 1) { return; }
+
+        // find the split with the lowest SAH cost
+        int best_axis = -1, best_bin = 0;
+        int num_bins = std::min(TriangleBVH::NumBins, n);
+        float best_cost = FLT_MAX;
+        if (depth < BVHMaxDepth) {
+            BVHBins bins;
+            binning(node.begin, node.end, cbounds, num_bins, bins);
+            for (int a = 0; a < 3; ++a) {
+                if (cbounds.bmax[a] <= cbounds.bmin[a]) { continue; }
+
+                // left_cost[i]: cost of bins [0, i]
+                float left_cost[TriangleBVH::NumBins];
+                BVHBounds lb;
+                lb.reset();
+                int lc = 0;
+                for (int bi = 0; bi < num_bins - 1; ++bi) {
+                    lb.expand(bins.bounds[a][bi]);
+                    lc += bins.counts[a][bi];
+                    left_cost[bi] = lb.area() * lc;
+                }
+                BVHBounds rb;
+                rb.reset();
+                int rc = 0;
+                for (int bi = num_bins - 1; bi > 0; --bi) {
+                    rb.expand(bins.bounds[a][bi]);
+                    rc += bins.counts[a][bi];
+                    float cost = left_cost[bi - 1] + rb.area() * rc;
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = a;
+                        best_bin = bi;
+                    }
+                }
+            }
+        }
+
+        float area = node.bounds.area();
+        float split_cost = best_axis >= 0 && area > 0.0f ? BVHTraversalCost + best_cost / area : FLT_MAX;
+        if (n <= TriangleBVH::MaxLeafSize && split_cost >= (float)n) {
+            return; // leaf
+        }
+
+        BVHRef *first = refs.data() + node.begin;
+        BVHRef *last = refs.data() + node.end;
+        BVHRef *mid = nullptr;
+        if (best_axis >= 0) {
+            int a = best_axis;
+            float base = cbounds.bmin[a];
+            float scale = (float)num_bins / (cbounds.bmax[a] - cbounds.bmin[a]);
+            mid = std::partition(first, last, [&](const BVHRef& r) {
+                return binIndex(r.centroid()[a], base, scale, num_bins) < best_bin;
+            });
+            node.axis = a;
+        }
+        if (!mid || mid == first || mid == last) {
+            // all centroids are in the same place or the tree is too deep. split at the median of the largest axis.
+            float3 ext = cbounds.bmax - cbounds.bmin;
+            int a = ext.x >= ext.y && ext.x >= ext.z ? 0 : (ext.y >= ext.z ? 1 : 2);
+            mid = first + n / 2;
+            std::nth_element(first, mid, last, [&](const BVHRef& r1, const BVHRef& r2) { return r1.centroid()[a] < r2.centroid()[a]; });
+            node.axis = a;
+        }
+
+        int split = node.begin + (int)(mid - first);
+        for (int ci = 0; ci < 2; ++ci) {
+            node.children[ci].reset(new BVHBuildNode());
+        }
+        node.children[0]->begin = node.begin;
+        node.children[0]->end = split;
+        node.children[1]->begin = split;
+        node.children[1]->end = node.end;
+
+        auto& c0 = *node.children[0];
+        auto& c1 = *node.children[1];
+        if (n > BVHParallelThreshold) {
+            parallel_invoke(
+                [this, &c0, depth]() { buildNode(c0, depth + 1); },
+                [this, &c1, depth]() { buildNode(c1, depth + 1); });
+        }
+        else {
+            buildNode(c0, depth + 1);
+            buildNode(c1, depth + 1);
+        }
+    }
+
+    void flatten(const BVHBuildNode& bn, RawVector<TriangleBVH::Node>& dst) const
+    {
+        int ni = (int)dst.size();
+        dst.resize(ni + 1);
+        {
+            // ray-triangle tests accept hits slightly outside of triangles. expand boxes to not miss them.
+            auto& node = dst[ni];
+            float3 ext = bn.bounds.bmax - bn.bounds.bmin;
+            float pad = std::max(std::max(ext.x, ext.y), ext.z) * 1e-4f + 1e-7f;
+            float3 pad3 = { pad, pad, pad };
+            node.bb_min = bn.bounds.bmin - pad3;
+            node.bb_max = bn.bounds.bmax + pad3;
+            node.axis = (uint16_t)bn.axis;
+        }
+        if (!bn.children[0]) {
+            dst[ni].offset = bn.begin;
+            dst[ni].count = (uint16_t)(bn.end - bn.begin);
+        }
+        else {
+            flatten(*bn.children[0], dst);
+            dst[ni].offset = (int)dst.size();
+            dst[ni].count = 0;
+            flatten(*bn.children[1], dst);
+        }
+    }
+};
+
+
+void TriangleBVH::build(const IArray<float3> vertices, const IArray<int> indices)
+{
+    int num_triangles = (int)indices.size() / 3;
+    for (auto *a : { &m_v1x, &m_v1y, &m_v1z, &m_v2x, &m_v2y, &m_v2z, &m_v3x, &m_v3y, &m_v3z }) {
+        a->resize_discard(num_triangles);
+    }
+    parallel_for_blocked(0, num_triangles, 4096, [&](int begin, int end) {
+        for (int ti = begin; ti < end; ++ti) {
+            auto& p1 = vertices[indices[ti * 3 + 0]];
+            auto& p2 = vertices[indices[ti * 3 + 1]];
+            auto& p3 = vertices[indices[ti * 3 + 2]];
+            m_v1x[ti] = p1.x; m_v1y[ti] = p1.y; m_v1z[ti] = p1.z;
+            m_v2x[ti] = p2.x; m_v2y[ti] = p2.y; m_v2z[ti] = p2.z;
+            m_v3x[ti] = p3.x; m_v3y[ti] = p3.y; m_v3z[ti] = p3.z;
+        }
+    });
+    buildImpl(num_triangles);
+}
+
+void TriangleBVH::build(const IArray<float3> vertices)
+{
+    int num_triangles = (int)vertices.size() / 3;
+    for (auto *a : { &m_v1x, &m_v1y, &m_v1z, &m_v2x, &m_v2y, &m_v2z, &m_v3x, &m_v3y, &m_v3z }) {
+        a->resize_discard(num_triangles);
+    }
+    parallel_for_blocked(0, num_triangles, 4096, [&](int begin, int end) {
+        for (int ti = begin; ti < end; ++ti) {
+            auto& p1 = vertices[ti * 3 + 0];
+            auto& p2 = vertices[ti * 3 + 1];
+            auto& p3 = vertices[ti * 3 + 2];
+            m_v1x[ti] = p1.x; m_v1y[ti] = p1.y; m_v1z[ti] = p1.z;
+            m_v2x[ti] = p2.x; m_v2y[ti] = p2.y; m_v2z[ti] = p2.z;
+            m_v3x[ti] = p3.x; m_v3y[ti] = p3.y; m_v3z[ti] = p3.z;
+        }
+    });
+    buildImpl(num_triangles);
+}
+
+// SoA arrays are in input order when this is called. they are reordered to leaf order at the end.
+void TriangleBVH::buildImpl(int num_triangles)
+{
+    m_nodes.clear();
+    m_triangle_ids.clear();
+    if (num_triangles == 0) { return; }
+
+    BVHBuilder builder;
+    builder.refs.resize_discard(num_triangles);
+    parallel_for_blocked(0, num_triangles, 4096, [&](int begin, int end) {
+        for (int ti = begin; ti < end; ++ti) {
+            float3 p1 = { m_v1x[ti], m_v1y[ti], m_v1z[ti] };
+            float3 p2 = { m_v2x[ti], m_v2y[ti], m_v2z[ti] };
+            float3 p3 = { m_v3x[ti], m_v3y[ti], m_v3z[ti] };
+            auto& r = builder.refs[ti];
+            r.bmin = min(min(p1, p2), p3);
+            r.bmax = max(max(p1, p2), p3);
+            r.id = ti;
+            r.pad = 0;
+        }
+    });
+
+    BVHBuildNode root;
+    root.begin = 0;
+    root.end = num_triangles;
+    builder.buildNode(root, 0);
+
+    m_nodes.reserve(num_triangles * 2 / MaxLeafSize + 1);
+    builder.flatten(root, m_nodes);
+
+    m_triangle_ids.resize_discard(num_triangles);
+    for (int i = 0; i < num_triangles; ++i) {
+        m_triangle_ids[i] = builder.refs[i].id;
+    }
+    for (auto *a : { &m_v1x, &m_v1y, &m_v1z, &m_v2x, &m_v2y, &m_v2z, &m_v3x, &m_v3y, &m_v3z }) {
+        RawVector<float> tmp;
+        tmp.resize_discard(num_triangles);
+        parallel_for_blocked(0, num_triangles, 16384, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                tmp[i] = (*a)[m_triangle_ids[i]];
+            }
+        });
+        a->swap(tmp);
+    }
+}
+
+void TriangleBVH::clear()
+{
+    m_nodes.clear();
+    m_triangle_ids.clear();
+    for (auto *a : { &m_v1x, &m_v1y, &m_v1z, &m_v2x, &m_v2y, &m_v2z, &m_v3x, &m_v3y, &m_v3z }) {
+        a->clear();
+    }
+}
+
+int TriangleBVH::getNumTriangles() const
+{
+    return (int)m_triangle_ids.size();
+}
+
+const RawVector<TriangleBVH::Node>& TriangleBVH::getNodes() const
+{
+    return m_nodes;
+}
+
+
+// avoid inf * 0 = NaN in slab tests
+static inline float SafeRcp(float v)
+{
+    return std::abs(v) < 1e-30f ? (v < 0.0f ? -1e30f : 1e30f) : 1.0f / v;
+}
+
+static inline bool RayBox(const float3& org, const float3& inv_dir, const float3& bmin, const float3& bmax, float tmax)
+{
+    float3 t0 = (bmin - org) * inv_dir;
+    float3 t1 = (bmax - org) * inv_dir;
+    float3 tn = min(t0, t1);
+    float3 tf = max(t0, t1);
+    float tnear = std::max(std::max(tn.x, tn.y), std::max(tn.z, 0.0f));
+    float tfar = std::min(std::min(tf.x, tf.y), std::min(tf.z, tmax));
+    return tnear <= tfar;
+}
+
+template<bool CountAll>
+int TriangleBVH::traverse(float3 pos, float3 dir, int& tindex, float& distance) const
+{
+    int num_hits = 0;
+    distance = FLT_MAX;
+    if (m_nodes.empty()) { return 0; }
+
+    float3 inv_dir = { SafeRcp(dir.x), SafeRcp(dir.y), SafeRcp(dir.z) };
+    int stack[BVHStackSize];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        int ni = stack[--sp];
+        auto& node = m_nodes[ni];
+        if (!RayBox(pos, inv_dir, node.bb_min, node.bb_max, CountAll ? FLT_MAX : distance)) { continue; }
+
+        if (node.count > 0) {
+            int o = node.offset;
+            int ti;
+            float d;
+            int hits = RayTrianglesIntersectionSoA(pos, dir,
+                m_v1x.data() + o, m_v1y.data() + o, m_v1z.data() + o,
+                m_v2x.data() + o, m_v2y.data() + o, m_v2z.data() + o,
+                m_v3x.data() + o, m_v3y.data() + o, m_v3z.data() + o,
+                node.count, ti, d);
+            num_hits += hits;
+            if (hits > 0 && d < distance) {
+                distance = d;
+                tindex = m_triangle_ids[o + ti];
+            }
+        }
+        else {
+            // visit the near child first
+            int c0 = ni + 1, c1 = node.offset;
+            if (dir[node.axis] < 0.0f) { std::swap(c0, c1); }
+            stack[sp++] = c1;
+            stack[sp++] = c0;
+        }
+    }
+    return num_hits;
+}
+
+int TriangleBVH::raycastAll(float3 pos, float3 dir, int& tindex, float& distance) const
+{
+    return traverse<true>(pos, dir, tindex, distance);
+}
+
+bool TriangleBVH::raycast(float3 pos, float3 dir, int& tindex, float& distance) const
+{
+    return traverse<false>(pos, dir, tindex, distance) > 0;
+}
+
+
+// SoA of a ray packet. inactive lanes have negative tmax so that they never hit boxes.
+template<int N>
+struct RayPacket
+{
+    alignas(16) float ox[N], oy[N], oz[N];
+    alignas(16) float ix[N], iy[N], iz[N];
+    alignas(16) float tmax[N];
+};
+
+// returns bit mask of rays that hit the box
+template<int N>
+static inline uint32_t RayBoxPacket(const RayPacket<N>& rp, const float3& bmin, const float3& bmax)
+{
+    uint32_t mask = 0;
+#ifdef muBVHSSE2
+    const __m128 minx = _mm_set1_ps(bmin.x), miny = _mm_set1_ps(bmin.y), minz = _mm_set1_ps(bmin.z);
+    const __m128 maxx = _mm_set1_ps(bmax.x), maxy = _mm_set1_ps(bmax.y), maxz = _mm_set1_ps(bmax.z);
+    for (int i = 0; i < N; i += 4) {
+        __m128 ox = _mm_load_ps(rp.ox + i), oy = _mm_load_ps(rp.oy + i), oz = _mm_load_ps(rp.oz + i);
+        __m128 ix = _mm_load_ps(rp.ix + i), iy = _mm_load_ps(rp.iy + i), iz = _mm_load_ps(rp.iz + i);
+        __m128 t0x = _mm_mul_ps(_mm_sub_ps(minx, ox), ix), t1x = _mm_mul_ps(_mm_sub_ps(maxx, ox), ix);
+        __m128 t0y = _mm_mul_ps(_mm_sub_ps(miny, oy), iy), t1y = _mm_mul_ps(_mm_sub_ps(maxy, oy), iy);
+        __m128 t0z = _mm_mul_ps(_mm_sub_ps(minz, oz), iz), t1z = _mm_mul_ps(_mm_sub_ps(maxz, oz), iz);
+        __m128 tnear = _mm_max_ps(
+            _mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+            _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+        __m128 tfar = _mm_min_ps(
+            _mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+            _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_load_ps(rp.tmax + i)));
+        mask |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(tnear, tfar)) << i;
+    }
+#else
+    for (int i = 0; i < N; ++i) {
+        float3 org = { rp.ox[i], rp.oy[i], rp.oz[i] };
+        float3 inv_dir = { rp.ix[i], rp.iy[i], rp.iz[i] };
+        if (RayBox(org, inv_dir, bmin, bmax, rp.tmax[i])) {
+            mask |= 1u << i;
+        }
+    }
+#endif
+    return mask;
+}
+
+template<int N>
+void TriangleBVH::raycastPacket(const float3 *pos, const float3 *dir, int num_rays, int *dst_tindices, float *dst_distances) const
+{
+    RayPacket<N> rp;
+    int tindices[N];
+    for (int i = 0; i < N; ++i) {
+        if (i < num_rays) {
+            rp.ox[i] = pos[i].x; rp.oy[i] = pos[i].y; rp.oz[i] = pos[i].z;
+            rp.ix[i] = SafeRcp(dir[i].x); rp.iy[i] = SafeRcp(dir[i].y); rp.iz[i] = SafeRcp(dir[i].z);
+            rp.tmax[i] = FLT_MAX;
+        }
+        else {
+            rp.ox[i] = rp.oy[i] = rp.oz[i] = 0.0f;
+            rp.ix[i] = rp.iy[i] = rp.iz[i] = 1.0f;
+            rp.tmax[i] = -1.0f;
+        }
+        tindices[i] = -1;
+    }
+
+    if (!m_nodes.empty()) {
+        // visiting order is decided by the first ray. packets are assumed to be coherent.
+        const float3 dir0 = dir[0];
+        int stack[BVHStackSize];
+        int sp = 0;
+        stack[sp++] = 0;
+        while (sp > 0) {
+            int ni = stack[--sp];
+            auto& node = m_nodes[ni];
+            uint32_t mask = RayBoxPacket<N>(rp, node.bb_min, node.bb_max);
+            if (mask == 0) { continue; }
+
+            if (node.count > 0) {
+                int o = node.offset;
+                for (int i = 0; i < N; ++i) {
+                    if ((mask & (1u << i)) == 0) { continue; }
+
+                    int ti;
+                    float d;
+                    int hits = RayTrianglesIntersectionSoA(pos[i], dir[i],
+                        m_v1x.data() + o, m_v1y.data() + o, m_v1z.data() + o,
+                        m_v2x.data() + o, m_v2y.data() + o, m_v2z.data() + o,
+                        m_v3x.data() + o, m_v3y.data() + o, m_v3z.data() + o,
+                        node.count, ti, d);
+                    if (hits > 0 && d < rp.tmax[i]) {
+                        rp.tmax[i] = d;
+                        tindices[i] = m_triangle_ids[o + ti];
+                    }
+                }
+            }
+            else {
+                int c0 = ni + 1, c1 = node.offset;
+                if (dir0[node.axis] < 0.0f) { std::swap(c0, c1); }
+                stack[sp++] = c1;
+                stack[sp++] = c0;
+            }
+        }
+    }
+
+    for (int i = 0; i < num_rays; ++i) {
+        dst_tindices[i] = tindices[i];
+        dst_distances[i] = tindices[i] >= 0 ? rp.tmax[i] : FLT_MAX;
+    }
+}
+
+void TriangleBVH::raycast(const float3 *pos, const float3 *dir, int num_rays,
+    int *dst_tindices, float *dst_distances, int packet_size) const
+{
+    const int psize = packet_size >= 16 ? 16 : 8;
+    int num_packets = ceildiv(num_rays, psize);
+    parallel_for_blocked(0, num_packets, 16, [&](int begin, int end) {
+        for (int pi = begin; pi < end; ++pi) {
+            int ri = pi * psize;
+            int n = std::min(psize, num_rays - ri);
+            if (psize == 16) {
+                raycastPacket<16>(pos + ri, dir + ri, n, dst_tindices + ri, dst_distances + ri);
+            }
+            else {
+                raycastPacket<8>(pos + ri, dir + ri, n, dst_tindices + ri, dst_distances + ri);
+            }
+        }
+    });
+}
+
+} // namespace mu
@@ -0,0 +1,55 @@
+#pragma once
+
+namespace mu {
+
+// bounding volume hierarchy of triangles to accelerate RayTrianglesIntersection* style queries.
+// built with binned SAH. large ranges are binned in parallel and subtrees are built in parallel.
+// nodes are flattened in depth first order (the first child follows its parent) and
+// triangles are stored in SoA in leaf order, so leaves are tested by RayTrianglesIntersectionSoA().
+class TriangleBVH
+{
+public:
+    static const int MaxLeafSize = 8;
+    static const int NumBins = 16;
+
+    struct Node
+    {
+        float3 bb_min;
+        int offset;         // leaf: first triangle. inner: index of the second child
+        float3 bb_max;
+        uint16_t count;     // leaf: number of triangles. inner: 0
+        uint16_t axis;      // inner: split axis
+    };
+
+    // vertices and indices are copied, so they don't have to be kept after build().
+    void build(const IArray<float3> vertices, const IArray<int> indices);
+    // flattened triangles (3 vertices per triangle)
+    void build(const IArray<float3> vertices);
+    void clear();
+
+    int getNumTriangles() const;
+    const RawVector<Node>& getNodes() const;
+
+    // same as RayTrianglesIntersection*: returns the number of hits, tindex and distance are of the nearest hit.
+    // tindex is the index of the triangle in the input.
+    int raycastAll(float3 pos, float3 dir, int& tindex, float& distance) const;
+
+    // nearest hit only. returns false if the ray hits nothing.
+    bool raycast(float3 pos, float3 dir, int& tindex, float& distance) const;
+
+    // packet traversal. rays are processed in packets of packet_size (8 or 16) in parallel.
+    // dst_tindices is -1 and dst_distances is FLT_MAX for rays that hit nothing.
+    void raycast(const float3 *pos, const float3 *dir, int num_rays,
+        int *dst_tindices, float *dst_distances, int packet_size = 8) const;
+
+private:
+    template<bool CountAll> int traverse(float3 pos, float3 dir, int& tindex, float& distance) const;
+    template<int N> void raycastPacket(const float3 *pos, const float3 *dir, int num_rays, int *dst_tindices, float *dst_distances) const;
+    void buildImpl(int num_triangles);
+
+    RawVector<Node> m_nodes;
+    RawVector<int> m_triangle_ids; // input triangle index of each triangle in leaf order
+    RawVector<float> m_v1x, m_v1y, m_v1z, m_v2x, m_v2y, m_v2z, m_v3x, m_v3y, m_v3z;
+};
+
+} // namespace mu
@@ -5,6 +5,8 @@
     #include <ppl.h>
 #elif defined(muEnableTBB)
     #include <tbb/tbb.h>
+#elif defined(muEnableThreadPool)
+    #include "muThreadPool.h"
 #endif
 
 namespace mu {
@@ -16,12 +18,24 @@ inline void parallel_for(Index begin, Index end, const Body& body)
     concurrency::parallel_for(begin, end, body);
 #elif defined(muEnableTBB)
     tbb::parallel_for(begin, end, body);
+#elif defined(muEnableThreadPool)
+    if (end <= begin) { return; }
+
+    // a few tasks per thread for load balancing
+    auto& pool = ThreadPool::getInstance();
+    Index num_elements = end - begin;
+    int num_tasks = (int)std::min<Index>(num_elements, (Index)(pool.getNumThreads() * 4));
+    pool.run(num_tasks, [&](int ti) {
+        Index b = begin + (Index)((uint64_t)num_elements * ti / num_tasks);
+        Index e = begin + (Index)((uint64_t)num_elements * (ti + 1) / num_tasks);
+        for (; b != e; ++b) { body(b); }
+    });
 #else
     for (; begin != end; ++begin) { body(begin); }
 #endif
 }
 
-#if defined(muEnablePPL) || defined(muEnableTBB)
+#if defined(muEnablePPL) || defined(muEnableTBB) || defined(muEnableThreadPool)
 template<class Body>
 inline void parallel_for(int begin, int end, int granularity, const Body& body)
 {
@@ -50,7 +64,7 @@ inline void parallel_for_blocked(int begin, int end, int granularity, const Body
 template<class Body>
 inline void parallel_for(int begin, int end, int /*granularity*/, const Body& body)
 {
-    body(begin, end);
+    for (; begin != end; ++begin) { body(begin); }
 }
 template<class Body>
 inline void parallel_for_blocked(int begin, int end, int /*granularity*/, const Body& body)
@@ -66,6 +80,20 @@ inline void parallel_for_each(Iter begin, Iter end, const Body& body)
     concurrency::parallel_for_each(begin, end, body);
 #elif defined(muEnableTBB)
     tbb::parallel_for_each(begin, end, body);
+#elif defined(muEnableThreadPool)
+    // split into ranges as parallel_for does. iterators are advanced once per range, not per element.
+    int num_elements = (int)std::distance(begin, end);
+    if (num_elements <= 0) { return; }
+
+    auto& pool = ThreadPool::getInstance();
+    int num_tasks = std::min<int>(num_elements, pool.getNumThreads() * 4);
+    pool.run(num_tasks, [&](int ti) {
+        int b = (int)((uint64_t)num_elements * ti / num_tasks);
+        int e = (int)((uint64_t)num_elements * (ti + 1) / num_tasks);
+        auto it = begin;
+        std::advance(it, b);
+        for (; b != e; ++b, ++it) { body(*it); }
+    });
 #else
     for (; begin != end; ++begin) { body(*begin); }
 #endif
@@ -82,6 +110,15 @@ inline void parallel_invoke(Bodies... bodies) { concurrency::parallel_invoke(bod
 template <class... Bodies>
 inline void parallel_invoke(Bodies... bodies) { tbb::parallel_invoke(bodies...); }
 
+#elif defined(muEnableThreadPool)
+
+template <class... Bodies>
+inline void parallel_invoke(Bodies... bodies)
+{
+    std::function<void()> tasks[] = { bodies... };
+    ThreadPool::getInstance().run((int)sizeof...(Bodies), [&](int i) { tasks[i](); });
+}
+
 #else
 
 template <class Body>
@@ -6,6 +6,8 @@
 //   muEnableISPC
 //   muEnableAMP
 //   muEnableSymbol
+//   muDisableThreadPool
+//   muDisableSSE
 
 #ifdef _WIN32
     #define muEnablePPL
@@ -15,3 +17,13 @@
     #define muEnableSymbol
 #endif
 
+// built-in thread pool is used if neither PPL nor TBB is available
+#if !defined(muEnablePPL) && !defined(muEnableTBB) && !defined(muDisableThreadPool)
+    #define muEnableThreadPool
+#endif
+
+// SSE2 versions of muSIMD kernels. used if ISPC is not available, and in ISPC builds for kernels
+// whose ISPC version is disabled (see muSIMDConfig.h) or on CPUs ISPC can't run on
+#if !defined(muDisableSSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define muEnableSSE
+#endif
@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "MeshUtils.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+    #define muHashSSE2
+    #include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && defined(_M_X64)
+    #include <intrin.h>
+#endif
+
+namespace mu {
+
+// the core processes 64 byte stripes with 8 64-bit lanes. each lane accumulates (data ^ key).lo32 * (data ^ key).hi32,
+// and the raw data goes to the neighbouring lane. accumulators are scrambled every 8 stripes (a block).
+static const int HashStripeSize = 64;
+static const int HashStripesPerBlock = 8;
+static const int HashBlockSize = HashStripeSize * HashStripesPerBlock;
+
+static const uint64_t HashPrime32 = 0x9E3779B1ULL;
+static const uint64_t HashPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t HashPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t HashPrime64_3 = 0x165667B19E3779F9ULL;
+
+struct HashKeys
+{
+    // [0, 16): stripes, [16, 24): scramble
+    uint64_t k[24];
+};
+
+static inline uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline HashKeys MakeHashKeys(uint64_t seed)
+{
+    HashKeys ret;
+    uint64_t state = seed ^ HashPrime64_3;
+    for (auto& k : ret.k) {
+        k = SplitMix64(state);
+    }
+    return ret;
+}
+
+static inline uint64_t Read64(const uint8_t *p)
+{
+    uint64_t r;
+    memcpy(&r, p, sizeof(r));
+    return r;
+}
+
+static inline uint64_t Mul128Fold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hi_hi = (a >> 32) * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    uint64_t hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lo = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t Avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= HashPrime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+#ifdef muHashSSE2
+static inline void AccumulateStripe(uint64_t *acc_, const uint8_t *src, const uint64_t *key)
+{
+    auto acc = (__m128i*)acc_;
+    for (int i = 0; i < 4; ++i) {
+        __m128i d = _mm_loadu_si128((const __m128i*)src + i);
+        __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)key + i));
+        __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+        __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+        __m128i a = _mm_loadu_si128(acc + i);
+        _mm_storeu_si128(acc + i, _mm_add_epi64(a, _mm_add_epi64(product, swapped)));
+    }
+}
+
+static inline void ScrambleAccumulators(uint64_t *acc_, const uint64_t *key)
+{
+    auto acc = (__m128i*)acc_;
+    const __m128i prime = _mm_set1_epi32((int)HashPrime32);
+    for (int i = 0; i < 4; ++i) {
+        __m128i a = _mm_loadu_si128(acc + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128((const __m128i*)key + i));
+        __m128i lo = _mm_mul_epu32(a, prime);
+        __m128i hi = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), prime), 32);
+        _mm_storeu_si128(acc + i, _mm_add_epi64(lo, hi));
+    }
+}
+#else
+static inline void AccumulateStripe(uint64_t *acc, const uint8_t *src, const uint64_t *key)
+{
+    for (int i = 0; i < 8; ++i) {
+        uint64_t d = Read64(src + i * 8);
+        uint64_t dk = d ^ key[i];
+        acc[i ^ 1] += d;
+        acc[i] += (dk & 0xFFFFFFFF) * (dk >> 32);
+    }
+}
+
+static inline void ScrambleAccumulators(uint64_t *acc, const uint64_t *key)
+{
+    for (int i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= key[i];
+        acc[i] = a * HashPrime32;
+    }
+}
+#endif
+
+static inline uint64_t MergeAccumulators(const uint64_t *acc, const uint64_t *key, uint64_t start)
+{
+    uint64_t r = start;
+    for (int i = 0; i < 4; ++i) {
+        r += Mul128Fold64(acc[i * 2] ^ key[i * 2], acc[i * 2 + 1] ^ key[i * 2 + 1]);
+    }
+    return Avalanche(r);
+}
+
+// len: length mixed into the result. it differs from size when combining chunk hashes.
+static Hash128 HashImpl(const void *data, size_t size, const HashKeys& keys, uint64_t len)
+{
+    uint64_t acc[8] = {
+        HashPrime32, HashPrime64_1, HashPrime64_2, HashPrime64_3,
+        HashPrime64_1 ^ HashPrime32, HashPrime64_2 ^ HashPrime32, HashPrime64_3 ^ HashPrime32, HashPrime64_1 + HashPrime64_2,
+    };
+
+    auto src = (const uint8_t*)data;
+    size_t num_blocks = size / HashBlockSize;
+    for (size_t bi = 0; bi < num_blocks; ++bi) {
+        for (int si = 0; si < HashStripesPerBlock; ++si) {
+            AccumulateStripe(acc, src, keys.k + si);
+            src += HashStripeSize;
+        }
+        ScrambleAccumulators(acc, keys.k + 16);
+    }
+
+    size_t rest = size - num_blocks * HashBlockSize;
+    int si = 0;
+    for (; rest >= (size_t)HashStripeSize; rest -= HashStripeSize, ++si) {
+        AccumulateStripe(acc, src, keys.k + si);
+        src += HashStripeSize;
+    }
+    if (rest > 0) {
+        // last partial stripe is zero padded
+        uint8_t stripe[HashStripeSize] = {};
+        memcpy(stripe, src, rest);
+        AccumulateStripe(acc, stripe, keys.k + si);
+    }
+
+    Hash128 ret;
+    ret.low = MergeAccumulators(acc, keys.k + 1, len * HashPrime64_1);
+    ret.high = MergeAccumulators(acc, keys.k + 9, ~(len * HashPrime64_2));
+    return ret;
+}
+
+// Body: [](size_t offset, size_t size) -> Hash128
+template<class Body>
+static Hash128 HashChunked(size_t size, const HashKeys& keys, const Body& body)
+{
+    if (size <= HashChunkSize) {
+        return body(0, size);
+    }
+
+    int num_chunks = (int)((size + HashChunkSize - 1) / HashChunkSize);
+    RawVector<Hash128> chunk_hashes;
+    chunk_hashes.resize_discard(num_chunks);
+    parallel_for(0, num_chunks, [&](int ci) {
+        size_t offset = HashChunkSize * ci;
+        chunk_hashes[ci] = body(offset, std::min(HashChunkSize, size - offset));
+    });
+    return HashImpl(chunk_hashes.data(), sizeof(Hash128) * num_chunks, keys, size);
+}
+
+static Hash128 HashBufferImpl(const void *data, size_t size, uint64_t seed)
+{
+    auto keys = MakeHashKeys(seed);
+    auto src = (const uint8_t*)data;
+    return HashChunked(size, keys, [&](size_t offset, size_t len) {
+        return HashImpl(src + offset, len, keys, len);
+    });
+}
+
+// round to nearest integer. written without branches so that the loop can be vectorized.
+// NaN and out of range values are clamped.
+static inline uint32_t QuantizeFloat(float v, float rcp)
+{
+    float y = v * rcp + 0.5f;
+    y = y > -2147483520.0f ? y : -2147483520.0f;
+    y = y < 2147483520.0f ? y : 2147483520.0f;
+    int32_t t = (int32_t)y;
+    t -= (float)t > y ? 1 : 0;
+    return (uint32_t)t;
+}
+
+// -0 to +0
+static inline uint32_t CanonicalizeFloat(float v)
+{
+    uint32_t r;
+    memcpy(&r, &v, sizeof(r));
+    return r == 0x80000000 ? 0 : r;
+}
+
+static Hash128 HashFloatBufferImpl(const float *data, size_t num, float quantize, uint64_t seed)
+{
+    auto keys = MakeHashKeys(seed);
+    float rcp = quantize > 0.0f ? 1.0f / quantize : 0.0f;
+    return HashChunked(sizeof(float) * num, keys, [&](size_t offset, size_t len) {
+        const float *src = data + offset / sizeof(float);
+        size_t n = len / sizeof(float);
+        RawVector<uint32_t> tmp;
+        tmp.resize_discard(n);
+        if (rcp > 0.0f) {
+            for (size_t i = 0; i < n; ++i) {
+                tmp[i] = QuantizeFloat(src[i], rcp);
+            }
+        }
+        else {
+            for (size_t i = 0; i < n; ++i) {
+                tmp[i] = CanonicalizeFloat(src[i]);
+            }
+        }
+        return HashImpl(tmp.data(), len, keys, len);
+    });
+}
+
+
+uint64_t HashBuffer64(const void *data, size_t size, uint64_t seed)
+{
+    return HashBufferImpl(data, size, seed).low;
+}
+
+Hash128 HashBuffer128(const void *data, size_t size, uint64_t seed)
+{
+    return HashBufferImpl(data, size, seed);
+}
+
+uint64_t HashFloatBuffer64(const float *data, size_t num, float quantize, uint64_t seed)
+{
+    return HashFloatBufferImpl(data, num, quantize, seed).low;
+}
+
+Hash128 HashFloatBuffer128(const float *data, size_t num, float quantize, uint64_t seed)
+{
+    return HashFloatBufferImpl(data, num, quantize, seed);
+}
+
+} // namespace mu
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace mu {
+
+struct Hash128
+{
+    uint64_t low, high;
+
+    bool operator==(const Hash128& v) const { return low == v.low && high == v.high; }
+    bool operator!=(const Hash128& v) const { return !(*this == v); }
+};
+
+// xxh3-style non-cryptographic hash (not compatible with xxHash).
+// buffers larger than HashChunkSize are split into chunks that are hashed in parallel and then combined.
+// the result doesn't depend on the number of threads or the instruction set.
+static const size_t HashChunkSize = 256 * 1024;
+
+uint64_t HashBuffer64(const void *data, size_t size, uint64_t seed = 0);
+Hash128 HashBuffer128(const void *data, size_t size, uint64_t seed = 0);
+
+// num: number of floats (not bytes)
+// quantize: values are rounded to the nearest multiple of it before hashing so that small noise doesn't change the result.
+//           0 disables rounding. -0 and +0 are always treated as the same value.
+uint64_t HashFloatBuffer64(const float *data, size_t num, float quantize, uint64_t seed = 0);
+Hash128 HashFloatBuffer128(const float *data, size_t num, float quantize, uint64_t seed = 0);
+
+} // namespace mu
@@ -9,51 +9,56 @@
     using iterator_category = std::random_access_iterator_tag;                  \
 
 
+// iterates over T placed every stride bytes. (e.g. an attribute of interleaved vertices)
+// Stride: stride in bytes if it is known at compile time. 0: given at runtime
 template<class T, int Stride = 0>
 struct stride_iterator
 {
-    Boilerplate(stride_iterator, T);
-    static const int stride = Stride;
-
-    uint8_t *data;
-
-    reference operator[](int v)  { return *(T*)(data + stride*v); }
-    reference operator*()        { return *(T*)data; }
-    pointer   operator->()       { return &(T*)data; }
-    this_t  operator+(size_t v)  { return data + stride*v; }
-    this_t  operator-(size_t v)  { return data + stride*v; }
+    Boilerplate(stride_iterator, T*)
+    using byte_t = typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type;
+    static const size_t stride = Stride;
+
+    byte_t *data;
+
+    reference operator[](size_t v) const { return *(T*)(data + stride*v); }
+    reference operator*() const          { return *(T*)data; }
+    pointer   operator->() const         { return (T*)data; }
+    this_t  operator+(size_t v) const    { return { data + stride*v }; }
+    this_t  operator-(size_t v) const    { return { data - stride*v }; }
+    difference_type operator-(const this_t& v) const { return (data - v.data) / (difference_type)stride; }
     this_t& operator+=(size_t v) { data += stride*v; return *this; }
     this_t& operator-=(size_t v) { data -= stride*v; return *this; }
     this_t& operator++()         { data += stride; return *this; }
-    this_t& operator++(int)      { data += stride; return *this; }
+    this_t  operator++(int)      { this_t r = *this; data += stride; return r; }
     this_t& operator--()         { data -= stride; return *this; }
-    this_t& operator--(int)      { data -= stride; return *this; }
-    bool operator==(const this_t& v) const { return data == data; }
-    bool operator!=(const this_t& v) const { return data != data; }
-
+    this_t  operator--(int)      { this_t r = *this; data -= stride; return r; }
+    bool operator==(const this_t& v) const { return data == v.data; }
+    bool operator!=(const this_t& v) const { return data != v.data; }
 };
 
 template<class T>
 struct stride_iterator<T, 0>
 {
-    Boilerplate(stride_iterator, T)
+    Boilerplate(stride_iterator, T*)
+    using byte_t = typename std::conditional<std::is_const<T>::value, const uint8_t, uint8_t>::type;
 
-    uint8_t *data;
+    byte_t *data;
     size_t stride;
 
-    reference operator[](int v)  { return *(T*)(data + stride*v); }
-    reference operator*()        { return *(T*)data; }
-    pointer   operator->()       { return &(T*)data; }
-    this_t  operator+(size_t v)  { return data + stride*v; }
-    this_t  operator-(size_t v)  { return data + stride*v; }
+    reference operator[](size_t v) const { return *(T*)(data + stride*v); }
+    reference operator*() const          { return *(T*)data; }
+    pointer   operator->() const         { return (T*)data; }
+    this_t  operator+(size_t v) const    { return { data + stride*v, stride }; }
+    this_t  operator-(size_t v) const    { return { data - stride*v, stride }; }
+    difference_type operator-(const this_t& v) const { return (data - v.data) / (difference_type)stride; }
     this_t& operator+=(size_t v) { data += stride*v; return *this; }
     this_t& operator-=(size_t v) { data -= stride*v; return *this; }
     this_t& operator++()         { data += stride; return *this; }
-    this_t& operator++(int)      { data += stride; return *this; }
+    this_t  operator++(int)      { this_t r = *this; data += stride; return r; }
     this_t& operator--()         { data -= stride; return *this; }
-    this_t& operator--(int)      { data -= stride; return *this; }
-    bool operator==(const this_t& v) const { return data == data; }
-    bool operator!=(const this_t& v) const { return data != data; }
+    this_t  operator--(int)      { this_t r = *this; data -= stride; return r; }
+    bool operator==(const this_t& v) const { return data == v.data; }
+    bool operator!=(const this_t& v) const { return data != v.data; }
 };
 
 
@@ -2,6 +2,7 @@
 #include "muMath.h"
 #include "muSIMD.h"
 #include "muRawVector.h"
+#include "muVertex.h"
 
 namespace mu {
 
@@ -439,6 +440,159 @@ void GenerateTangentsTriangleSoA_Generic(float4 *dst,
     }
 }
 
+void SmoothNormalsFan_Generic(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold)
+{
+    for (int i = 0; i < num; ++i) {
+        float3 n = { nx[i], ny[i], nz[i] };
+        float3 r = float3::zero();
+        for (int j = 0; j < num; ++j) {
+            float3 fn = { nx[j], ny[j], nz[j] };
+            if (dot(n, fn) > threshold) {
+                r += fn;
+            }
+        }
+        dst[dst_indices[i]] = r;
+    }
+}
+
+void GenerateHeightmapRow_Generic(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit)
+{
+    float pz = (float)z * unit.z;
+    float v = (float)z * uv_unit.y;
+    for (int i = 0; i < num; ++i) {
+        float fx = (float)(x + i);
+        dst_points[i] = { fx * unit.x, heights[i] * unit.y, pz };
+        dst_uv[i] = { fx * uv_unit.x, v };
+    }
+}
+
+void GenerateHeightmapNormalsRow_Generic(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz)
+{
+    float kx = height_scale / (dx * 2.0f);
+    float kz = height_scale / dz;
+    for (int x = 0; x < width; ++x) {
+        int x0 = x > 0 ? x - 1 : x;
+        int x1 = x < width - 1 ? x + 1 : x;
+        float gx = (heights[x1] - heights[x0]) * (x1 - x0 == 2 ? kx : kx * 2.0f);
+        float gz = (next[x] - prev[x]) * kz;
+        dst[x] = normalize(float3{ -gx, 1.0f, -gz });
+    }
+}
+
+void WidenIndices_Generic(int *dst, const uint16_t *src, int num)
+{
+    for (int i = 0; i < num; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+void Color32ToFloat4_Generic(float4 *dst, const uint32_t *src, int num)
+{
+    const float s = 1.0f / 255.0f;
+    for (int i = 0; i < num; ++i) {
+        uint32_t c = src[i];
+        dst[i] = { (float)(c & 0xff) * s, (float)((c >> 8) & 0xff) * s, (float)((c >> 16) & 0xff) * s, (float)(c >> 24) * s };
+    }
+}
+
+// sorting networks of K weights in descending order. sort() sorts any sequence and merge() sorts bitonic sequences.
+static inline void CompareExchange(float *w, int *idx, int a, int b)
+{
+    float wa = w[a], wb = w[b];
+    int ia = idx[a], ib = idx[b];
+    bool s = wa < wb;
+    w[a] = s ? wb : wa;
+    w[b] = s ? wa : wb;
+    idx[a] = s ? ib : ia;
+    idx[b] = s ? ia : ib;
+}
+
+template<int K> struct WeightsNetwork;
+template<> struct WeightsNetwork<4>
+{
+    static void sort(float *w, int *idx)
+    {
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3);
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3);
+        CompareExchange(w, idx, 1, 2);
+    }
+    static void merge(float *w, int *idx)
+    {
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3);
+    }
+};
+template<> struct WeightsNetwork<8>
+{
+    static void sort(float *w, int *idx)
+    {
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3); CompareExchange(w, idx, 4, 6); CompareExchange(w, idx, 5, 7);
+        CompareExchange(w, idx, 0, 4); CompareExchange(w, idx, 1, 5); CompareExchange(w, idx, 2, 6); CompareExchange(w, idx, 3, 7);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3); CompareExchange(w, idx, 4, 5); CompareExchange(w, idx, 6, 7);
+        CompareExchange(w, idx, 2, 4); CompareExchange(w, idx, 3, 5);
+        CompareExchange(w, idx, 1, 4); CompareExchange(w, idx, 3, 6);
+        CompareExchange(w, idx, 1, 2); CompareExchange(w, idx, 3, 4); CompareExchange(w, idx, 5, 6);
+    }
+    static void merge(float *w, int *idx)
+    {
+        CompareExchange(w, idx, 0, 4); CompareExchange(w, idx, 1, 5); CompareExchange(w, idx, 2, 6); CompareExchange(w, idx, 3, 7);
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3); CompareExchange(w, idx, 4, 6); CompareExchange(w, idx, 5, 7);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3); CompareExchange(w, idx, 4, 5); CompareExchange(w, idx, 6, 7);
+    }
+};
+
+// blocks of K are sorted, then pairs of blocks are merged by keeping the larger half (a bitonic sequence) and sorting it.
+template<int M, int K>
+static void SelectWeights(Weights<K> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    for (int vi = 0; vi < num; ++vi) {
+        float w[M];
+        int idx[M];
+        for (int i = 0; i < M; ++i) {
+            w[i] = src_weights[M * vi + i];
+            idx[i] = src_indices[M * vi + i];
+        }
+
+        for (int bi = 0; bi < M; bi += K) {
+            WeightsNetwork<K>::sort(w + bi, idx + bi);
+        }
+        for (int step = K; step < M; step *= 2) {
+            for (int bi = 0; bi < M; bi += step * 2) {
+                for (int i = 0; i < K; ++i) {
+                    int a = bi + i, b = bi + step + K - 1 - i;
+                    bool s = w[a] < w[b];
+                    w[a] = s ? w[b] : w[a];
+                    idx[a] = s ? idx[b] : idx[a];
+                }
+                WeightsNetwork<K>::merge(w + bi, idx + bi);
+            }
+        }
+
+        float total = 0.0f;
+        for (int i = 0; i < K; ++i) { total += w[i]; }
+        float rcp_total = total > 0.0f ? 1.0f / total : 0.0f;
+        for (int i = 0; i < K; ++i) {
+            dst[vi].weights[i] = w[i] * rcp_total;
+            dst[vi].indices[i] = idx[i];
+        }
+    }
+}
+
+void SelectWeights8To4_Generic(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    SelectWeights<8, 4>(dst, src_indices, src_weights, num);
+}
+void SelectWeights16To4_Generic(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    SelectWeights<16, 4>(dst, src_indices, src_weights, num);
+}
+void SelectWeights16To8_Generic(Weights<8> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    SelectWeights<16, 8>(dst, src_indices, src_weights, num);
+}
+
 
 bool GenerateNormalsPoly(
     float3 *dst, const float3 *points, const int *counts, const int *offsets, const int *indices,
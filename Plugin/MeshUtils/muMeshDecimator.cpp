@@ -0,0 +1,546 @@
+#include "pch.h"
+#include "MeshUtils.h"
+
+namespace mu {
+
+// error quadric. Q(x) = x^T A x + 2 b.x + c
+struct Quadric
+{
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+
+    void addPlane(float3 n, float d, float w)
+    {
+        a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+        a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+    }
+
+    Quadric& operator+=(const Quadric& v)
+    {
+        a00 += v.a00; a11 += v.a11; a22 += v.a22;
+        a01 += v.a01; a02 += v.a02; a12 += v.a12;
+        b0 += v.b0; b1 += v.b1; b2 += v.b2;
+        c += v.c;
+        return *this;
+    }
+
+    double eval(float3 p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double r =
+            a00 * x * x + a11 * y * y + a22 * z * z +
+            2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+            2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return std::abs(r);
+    }
+};
+
+enum class VertexKind : uint8_t
+{
+    Manifold,   // interior vertex without seams. can collapse onto any neighbor
+    Border,     // on an open border. can collapse onto border neighbors along the border
+    Seam,       // on a uv / normal seam (2 wedges). can collapse onto seam neighbors along the seam
+    Locked,
+};
+
+// weight of the constraint planes that keep borders and seams in place
+static const float DecimatorBorderWeight = 10.0f;
+// collapses that rotate face normals more than this (cos) are rejected
+static const float DecimatorFlipThreshold = 0.25f;
+// faces whose area / (longest edge)^2 becomes smaller than this are rejected
+static const float DecimatorMinAspect = 0.05f;
+static const int DecimatorMaxPasses = 100;
+
+class MeshDecimatorImpl
+{
+public:
+    MeshDecimatorImpl(const MeshDecimator& src);
+    void decimate(float target_ratio, float max_error, RawVector<int>& dst_indices, RawVector<int> *dst_groups);
+
+private:
+    struct Collapse
+    {
+        int v0, v1; // vertex v0 is collapsed onto v1
+        float error;
+    };
+
+    int group(int fi) const { return m_groups.empty() ? 0 : m_groups[fi]; }
+    int numFaces() const { return (int)m_indices.size() / 3; }
+
+    // Body: [](int wedge) -> void. wedges: vertices that share the position and are referenced by faces
+    template<class Body> void eachWedge(int pi, const Body& body) const;
+    // Body: [](int face, int corner) -> void
+    template<class Body> void eachFaceAround(int pi, const Body& body) const;
+    // a -> b in group g
+    bool hasHalfEdge(int a, int b, int g) const;
+    // number of half edges from position pa to position pb
+    int countPosHalfEdge(int pa, int pb) const;
+
+    void buildQuadrics();
+    void classify();
+    bool canCollapse(int v0, int v1, bool border_edge, bool seam_edge) const;
+    void gatherCollapses();
+    // returns number of removed faces. 0 if the collapse is rejected.
+    int tryCollapse(const Collapse& c);
+    void applyCollapses();
+
+    const MeshDecimator& m_src;
+    int m_num_vertices = 0;
+    int m_num_positions = 0;
+
+    RawVector<int> m_indices;
+    RawVector<int> m_groups;
+    ConnectionData m_connection;
+
+    RawVector<int> m_pos_ids;       // vertex -> position id
+    RawVector<int> m_pos_first;     // position id -> first vertex
+    RawVector<int> m_wedge_next;    // vertex -> next vertex with the same position (cyclic)
+
+    RawVector<Quadric> m_quadrics;  // per position
+    RawVector<VertexKind> m_kinds;  // per position
+    RawVector<int> m_border_next;   // per position
+    RawVector<int> m_border_prev;   // per position
+
+    RawVector<Collapse> m_collapses;
+    RawVector<int> m_collapse_remap; // per vertex
+    RawVector<uint8_t> m_locked;     // per position
+    RawVector<int> m_ring0, m_ring1;
+};
+
+MeshDecimatorImpl::MeshDecimatorImpl(const MeshDecimator& src)
+    : m_src(src)
+{
+    m_num_vertices = (int)src.points.size();
+    m_indices.assign(src.indices.begin(), src.indices.end());
+    if (!src.groups.empty()) {
+        m_groups.assign(src.groups.begin(), src.groups.end());
+    }
+
+    // build wedge lists
+    WeldPositions(m_pos_ids, src.points);
+    m_num_positions = 0;
+    for (int id : m_pos_ids) {
+        m_num_positions = std::max(m_num_positions, id + 1);
+    }
+    m_pos_first.resize(m_num_positions, -1);
+    m_wedge_next.resize_discard(m_num_vertices);
+    RawVector<int> last;
+    last.resize_discard(m_num_positions);
+    for (int vi = 0; vi < m_num_vertices; ++vi) {
+        int pi = m_pos_ids[vi];
+        if (m_pos_first[pi] == -1) {
+            m_pos_first[pi] = vi;
+            m_wedge_next[vi] = vi;
+        }
+        else {
+            m_wedge_next[last[pi]] = vi;
+            m_wedge_next[vi] = m_pos_first[pi];
+        }
+        last[pi] = vi;
+    }
+
+    m_kinds.resize_discard(m_num_positions);
+    m_border_next.resize_discard(m_num_positions);
+    m_border_prev.resize_discard(m_num_positions);
+    m_locked.resize_discard(m_num_positions);
+    m_collapse_remap.resize_discard(m_num_vertices);
+}
+
+template<class Body>
+inline void MeshDecimatorImpl::eachWedge(int pi, const Body& body) const
+{
+    int first = m_pos_first[pi];
+    int vi = first;
+    do {
+        if (m_connection.v2f_counts[vi] > 0) {
+            body(vi);
+        }
+        vi = m_wedge_next[vi];
+    } while (vi != first);
+}
+
+template<class Body>
+inline void MeshDecimatorImpl::eachFaceAround(int pi, const Body& body) const
+{
+    eachWedge(pi, [&](int vi) {
+        m_connection.eachConnectedFaces(vi, [&](int fi, int ii) {
+            body(fi, ii - fi * 3);
+        });
+    });
+}
+
+bool MeshDecimatorImpl::hasHalfEdge(int a, int b, int g) const
+{
+    int count = m_connection.v2f_counts[a];
+    int offset = m_connection.v2f_offsets[a];
+    for (int i = 0; i < count; ++i) {
+        int fi = m_connection.v2f_faces[offset + i];
+        int ci = m_connection.v2f_indices[offset + i] - fi * 3;
+        if (m_indices[fi * 3 + (ci + 1) % 3] == b && group(fi) == g) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int MeshDecimatorImpl::countPosHalfEdge(int pa, int pb) const
+{
+    int ret = 0;
+    eachFaceAround(pa, [&](int fi, int ci) {
+        if (m_pos_ids[m_indices[fi * 3 + (ci + 1) % 3]] == pb) {
+            ++ret;
+        }
+    });
+    return ret;
+}
+
+void MeshDecimatorImpl::classify()
+{
+    parallel_for_blocked(0, m_num_positions, 1024, [&](int begin, int end) {
+        for (int pi = begin; pi < end; ++pi) {
+            int num_wedges = 0, num_seam_wedges = 0;
+            int border_out = 0, border_in = 0;
+            int border_next = -1, border_prev = -1;
+            bool complex = false;
+
+            eachWedge(pi, [&](int vi) {
+                ++num_wedges;
+                int seam_out = 0, seam_in = 0;
+                m_connection.eachConnectedFaces(vi, [&](int fi, int ii) {
+                    int ci = ii - fi * 3;
+                    int g = group(fi);
+                    int vn = m_indices[fi * 3 + (ci + 1) % 3];
+                    int vp = m_indices[fi * 3 + (ci + 2) % 3];
+                    int pn = m_pos_ids[vn];
+                    int pp = m_pos_ids[vp];
+
+                    // outgoing edge
+                    int out_pos = countPosHalfEdge(pn, pi);
+                    if (out_pos == 0) { ++border_out; border_next = pn; }
+                    else if (!hasHalfEdge(vn, vi, g)) { ++seam_out; }
+                    if (out_pos > 1 || countPosHalfEdge(pi, pn) > 1) { complex = true; }
+
+                    // incoming edge
+                    if (countPosHalfEdge(pi, pp) == 0) { ++border_in; border_prev = pp; }
+                    else if (!hasHalfEdge(vi, vp, g)) { ++seam_in; }
+                });
+                if (seam_out || seam_in) {
+                    ++num_seam_wedges;
+                    if (seam_out != 1 || seam_in != 1) { complex = true; }
+                }
+            });
+
+            VertexKind kind = VertexKind::Locked;
+            if (num_wedges == 0 || complex) {
+                kind = VertexKind::Locked;
+            }
+            else if (border_out || border_in) {
+                if (border_out == 1 && border_in == 1 && num_wedges == 1 && num_seam_wedges == 0) {
+                    kind = VertexKind::Border;
+                }
+            }
+            else if (num_seam_wedges == 0) {
+                if (num_wedges == 1) {
+                    kind = VertexKind::Manifold;
+                }
+            }
+            else if (num_wedges == 2 && num_seam_wedges == 2) {
+                kind = VertexKind::Seam;
+            }
+            m_kinds[pi] = kind;
+            m_border_next[pi] = border_next;
+            m_border_prev[pi] = border_prev;
+        }
+    });
+}
+
+void MeshDecimatorImpl::buildQuadrics()
+{
+    m_quadrics.resize_zeroclear(m_num_positions);
+
+    const auto& points = m_src.points;
+    int num_faces = numFaces();
+    for (int fi = 0; fi < num_faces; ++fi) {
+        const int *face = &m_indices[fi * 3];
+        float3 p0 = points[face[0]];
+        float3 p1 = points[face[1]];
+        float3 p2 = points[face[2]];
+        float3 n = cross(p1 - p0, p2 - p0);
+        float area = length(n);
+        if (area == 0.0f) { continue; }
+        n /= area;
+
+        Quadric q;
+        memset(&q, 0, sizeof(q));
+        q.addPlane(n, -dot(n, p0), area);
+        for (int ci = 0; ci < 3; ++ci) {
+            m_quadrics[m_pos_ids[face[ci]]] += q;
+        }
+
+        // borders and seams get planes perpendicular to the face so that they don't shrink
+        for (int ci = 0; ci < 3; ++ci) {
+            int v0 = face[ci];
+            int v1 = face[(ci + 1) % 3];
+            int pi0 = m_pos_ids[v0];
+            int pi1 = m_pos_ids[v1];
+            if (countPosHalfEdge(pi1, pi0) > 0 && hasHalfEdge(v1, v0, group(fi))) { continue; }
+
+            float3 e = points[v1] - points[v0];
+            float3 en = cross(e, n);
+            float len = length(en);
+            if (len == 0.0f) { continue; }
+            en /= len;
+
+            Quadric qe;
+            memset(&qe, 0, sizeof(qe));
+            qe.addPlane(en, -dot(en, points[v0]), dot(e, e) * DecimatorBorderWeight);
+            m_quadrics[pi0] += qe;
+            m_quadrics[pi1] += qe;
+        }
+    }
+}
+
+bool MeshDecimatorImpl::canCollapse(int v0, int v1, bool border_edge, bool seam_edge) const
+{
+    int pi0 = m_pos_ids[v0];
+    int pi1 = m_pos_ids[v1];
+    VertexKind k1 = m_kinds[pi1];
+    switch (m_kinds[pi0]) {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        return border_edge && (k1 == VertexKind::Border || k1 == VertexKind::Locked) &&
+            (m_border_next[pi0] == pi1 || m_border_prev[pi0] == pi1);
+    case VertexKind::Seam:
+        return seam_edge && (k1 == VertexKind::Seam || k1 == VertexKind::Locked);
+    default:
+        return false;
+    }
+}
+
+void MeshDecimatorImpl::gatherCollapses()
+{
+    // each half edge gives 2 candidates (collapse toward each end)
+    int num_faces = numFaces();
+    m_collapses.resize_discard(num_faces * 6);
+    parallel_for_blocked(0, num_faces, 1024, [&](int begin, int end) {
+        const auto& points = m_src.points;
+        for (int fi = begin; fi < end; ++fi) {
+            int g = group(fi);
+            for (int ci = 0; ci < 3; ++ci) {
+                Collapse *dst = &m_collapses[fi * 6 + ci * 2];
+                dst[0].v0 = dst[1].v0 = -1;
+
+                int va = m_indices[fi * 3 + ci];
+                int vb = m_indices[fi * 3 + (ci + 1) % 3];
+                int pa = m_pos_ids[va];
+                int pb = m_pos_ids[vb];
+                if (pa == pb) { continue; }
+
+                // interior edges are visited from both sides. take one of them.
+                bool has_opposite = hasHalfEdge(vb, va, g);
+                if (has_opposite && va > vb) { continue; }
+                bool border_edge = countPosHalfEdge(pb, pa) == 0;
+                bool seam_edge = !border_edge && !has_opposite;
+
+                int v[2] = { va, vb };
+                for (int i = 0; i < 2; ++i) {
+                    int v0 = v[i], v1 = v[1 - i];
+                    if (!canCollapse(v0, v1, border_edge, seam_edge)) { continue; }
+
+                    float3 target = points[v1];
+                    double error = m_quadrics[m_pos_ids[v0]].eval(target) + m_quadrics[m_pos_ids[v1]].eval(target);
+                    dst[i] = { v0, v1, (float)error };
+                }
+            }
+        }
+    });
+
+    m_collapses.erase(
+        std::remove_if(m_collapses.begin(), m_collapses.end(), [](const Collapse& c) { return c.v0 == -1; }),
+        m_collapses.end());
+}
+
+int MeshDecimatorImpl::tryCollapse(const Collapse& c)
+{
+    const auto& points = m_src.points;
+    int pi0 = m_pos_ids[c.v0];
+    int pi1 = m_pos_ids[c.v1];
+    if (m_locked[pi0] || m_locked[pi1]) { return 0; }
+
+    // find the target wedge of each wedge of v0. it must be unique.
+    bool ok = true;
+    eachWedge(pi0, [&](int vi) {
+        int target = -1;
+        m_connection.eachConnectedFaces(vi, [&](int fi, int) {
+            for (int ci = 0; ci < 3; ++ci) {
+                int vx = m_indices[fi * 3 + ci];
+                if (m_pos_ids[vx] != pi1) { continue; }
+                if (target == -1) { target = vx; }
+                else if (target != vx) { ok = false; }
+            }
+        });
+        if (target == -1) { ok = false; }
+        m_collapse_remap[vi] = target;
+    });
+
+    // link condition: common neighbors of both ends must be the opposite vertices of the removed faces.
+    // and faces around v0 must not flip.
+    int num_removed = 0;
+    m_ring0.clear();
+    m_ring1.clear();
+    float3 p1 = points[c.v1];
+    if (ok) {
+        eachFaceAround(pi0, [&](int fi, int ci) {
+            const int *face = &m_indices[fi * 3];
+            int pn = m_pos_ids[face[(ci + 1) % 3]];
+            int pp = m_pos_ids[face[(ci + 2) % 3]];
+            m_ring0.push_back(pn);
+            m_ring0.push_back(pp);
+            if (pn == pi1 || pp == pi1) {
+                ++num_removed;
+                return;
+            }
+
+            float3 a = points[face[(ci + 1) % 3]];
+            float3 b = points[face[(ci + 2) % 3]];
+            float3 n0 = cross(a - points[face[ci]], b - points[face[ci]]);
+            float3 n1 = cross(a - p1, b - p1);
+            float l1 = length(n1);
+            if (dot(n0, n1) <= DecimatorFlipThreshold * length(n0) * l1) {
+                ok = false;
+            }
+            // reject needles. they easily flip by subsequent collapses.
+            float max_edge = std::max(std::max(length_sq(a - p1), length_sq(b - p1)), length_sq(b - a));
+            if (l1 < DecimatorMinAspect * max_edge) {
+                ok = false;
+            }
+        });
+    }
+    if (!ok || num_removed == 0) {
+        eachWedge(pi0, [&](int vi) { m_collapse_remap[vi] = vi; });
+        return 0;
+    }
+
+    eachFaceAround(pi1, [&](int fi, int ci) {
+        const int *face = &m_indices[fi * 3];
+        m_ring1.push_back(m_pos_ids[face[(ci + 1) % 3]]);
+        m_ring1.push_back(m_pos_ids[face[(ci + 2) % 3]]);
+    });
+    std::sort(m_ring0.begin(), m_ring0.end());
+    m_ring0.erase(std::unique(m_ring0.begin(), m_ring0.end()), m_ring0.end());
+    std::sort(m_ring1.begin(), m_ring1.end());
+    m_ring1.erase(std::unique(m_ring1.begin(), m_ring1.end()), m_ring1.end());
+
+    int num_common = 0;
+    for (size_t i = 0, j = 0; i < m_ring0.size() && j < m_ring1.size();) {
+        if (m_ring0[i] < m_ring1[j]) { ++i; }
+        else if (m_ring0[i] > m_ring1[j]) { ++j; }
+        else {
+            if (m_ring0[i] != pi0 && m_ring0[i] != pi1) { ++num_common; }
+            ++i; ++j;
+        }
+    }
+    if (num_common != num_removed) {
+        eachWedge(pi0, [&](int vi) { m_collapse_remap[vi] = vi; });
+        return 0;
+    }
+
+    m_quadrics[pi1] += m_quadrics[pi0];
+    // faces around both ends change. lock them until the next pass.
+    for (int pi : m_ring0) { m_locked[pi] = 1; }
+    for (int pi : m_ring1) { m_locked[pi] = 1; }
+    m_locked[pi0] = m_locked[pi1] = 1;
+    return num_removed;
+}
+
+void MeshDecimatorImpl::applyCollapses()
+{
+    int num_faces = numFaces();
+    int num_valid = 0;
+    for (int fi = 0; fi < num_faces; ++fi) {
+        int v[3];
+        for (int ci = 0; ci < 3; ++ci) {
+            v[ci] = m_collapse_remap[m_indices[fi * 3 + ci]];
+        }
+        int p0 = m_pos_ids[v[0]], p1 = m_pos_ids[v[1]], p2 = m_pos_ids[v[2]];
+        if (p0 == p1 || p1 == p2 || p2 == p0) { continue; }
+
+        for (int ci = 0; ci < 3; ++ci) {
+            m_indices[num_valid * 3 + ci] = v[ci];
+        }
+        if (!m_groups.empty()) {
+            m_groups[num_valid] = m_groups[fi];
+        }
+        ++num_valid;
+    }
+    m_indices.resize(num_valid * 3);
+    if (!m_groups.empty()) {
+        m_groups.resize(num_valid);
+    }
+}
+
+void MeshDecimatorImpl::decimate(float target_ratio, float max_error, RawVector<int>& dst_indices, RawVector<int> *dst_groups)
+{
+    int target_faces = (int)((float)numFaces() * clamp01(target_ratio));
+    IArray<float3> positions(nullptr, m_num_vertices);
+
+    for (int pass = 0; pass < DecimatorMaxPasses && numFaces() > target_faces; ++pass) {
+        m_connection.buildConnection(m_indices, 3, positions);
+        classify();
+        if (pass == 0) {
+            buildQuadrics();
+        }
+        gatherCollapses();
+        if (m_collapses.empty()) { break; }
+
+        // most collapses remove 2 faces. don't go far beyond the error of the collapses that are expected to be needed.
+        // only the collapses within the limit are sorted.
+        auto less_error = [](const Collapse& a, const Collapse& b) { return a.error < b.error; };
+        int num_to_remove = numFaces() - target_faces;
+        size_t goal = std::min<size_t>(num_to_remove / 2, m_collapses.size() - 1);
+        std::nth_element(m_collapses.begin(), m_collapses.begin() + goal, m_collapses.end(), less_error);
+        float error_limit = std::min(max_error, m_collapses[goal].error * 1.5f);
+        auto last = std::partition(m_collapses.begin(), m_collapses.end(),
+            [error_limit](const Collapse& c) { return c.error <= error_limit; });
+        std::sort(m_collapses.begin(), last, less_error);
+
+        for (int vi = 0; vi < m_num_vertices; ++vi) {
+            m_collapse_remap[vi] = vi;
+        }
+        m_locked.zeroclear();
+
+        int num_removed = 0;
+        for (auto it = m_collapses.begin(); it != last && num_removed < num_to_remove; ++it) {
+            num_removed += tryCollapse(*it);
+        }
+        if (num_removed * 16 < num_to_remove) {
+            // most of cheap collapses are rejected. go on with expensive ones to avoid stalling.
+            auto end = std::partition(last, m_collapses.end(),
+                [max_error](const Collapse& c) { return c.error <= max_error; });
+            std::sort(last, end, less_error);
+            for (auto it = last; it != end && num_removed < num_to_remove; ++it) {
+                num_removed += tryCollapse(*it);
+            }
+        }
+        if (num_removed == 0) { break; }
+        applyCollapses();
+    }
+
+    dst_indices = m_indices;
+    if (dst_groups) {
+        *dst_groups = m_groups;
+    }
+}
+
+
+void MeshDecimator::decimate(float target_ratio, float max_error, RawVector<int>& dst_indices, RawVector<int> *dst_groups) const
+{
+    MeshDecimatorImpl impl(*this);
+    impl.decimate(target_ratio, max_error, dst_indices, dst_groups);
+}
+
+} // namespace mu
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace mu {
+
+// quadric error metric simplification for triangle meshes.
+// edges are collapsed onto one of their end vertices, so remaining vertices keep their attributes
+// (normals, uv, skin weights, etc.) as they are and the result refers to the original vertices.
+// vertices on open borders and on uv / normal seams (vertices that share a position) only move along them.
+// vertices on boundaries between groups and on non-manifold parts are locked.
+struct MeshDecimator
+{
+    IArray<int> indices;    // triangles
+    IArray<float3> points;
+    IArray<int> groups;     // optional. group (submesh) of each triangle
+
+    // target_ratio: ratio of triangles to keep
+    // max_error: collapses with larger error than this are not done. the error is roughly squared distance * area.
+    // dst_indices: triangles that refer to the original vertices. dst_groups: group of each triangle (if groups is given)
+    void decimate(float target_ratio, float max_error, RawVector<int>& dst_indices, RawVector<int> *dst_groups = nullptr) const;
+};
+
+} // namespace mu
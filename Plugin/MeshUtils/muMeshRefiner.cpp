@@ -10,8 +10,11 @@ void MeshRefiner::prepare(
     indices = indices_;
     points = points_;
     normals.reset(nullptr, 0);
+    tangents.reset(nullptr, 0);
     uv.reset(nullptr, 0);
+    uv1.reset(nullptr, 0);
     colors.reset(nullptr, 0);
+    weights4.reset(nullptr, 0);
 
     submeshes.clear();
     splits.clear();
@@ -26,8 +29,11 @@ void MeshRefiner::prepare(
 
     new_points.clear();
     new_normals.clear();
+    new_tangents.clear();
     new_uv.clear();
+    new_uv1.clear();
     new_colors.clear();
+    new_weights4.clear();
     new_indices.clear();
     new_indices_triangulated.clear();
     new_indices_submeshes.clear();
@@ -56,25 +62,10 @@ void MeshRefiner::prepare(
 
 void MeshRefiner::genNormals(bool flip)
 {
-    auto& p = points;
-    normals_tmp.resize_zeroclear(p.size());
+    buildConnection();
 
-    size_t num_faces = counts.size();
-    int i1 = flip ? 2 : 1;
-    int i2 = flip ? 1 : 2;
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int count = counts[fi];
-        const int *face = &indices[offsets[fi]];
-        float3 p0 = p[face[0]];
-        float3 p1 = p[face[i1]];
-        float3 p2 = p[face[i2]];
-        float3 n = cross(p1 - p0, p2 - p0);
-        for (int ci = 0; ci < count; ++ci) {
-            normals_tmp[face[ci]] += n;
-        }
-    }
-    Normalize(normals_tmp.data(), normals_tmp.size());
+    normals_tmp.resize_discard(points.size());
+    GenerateNormalsPoly(normals_tmp, points, counts, offsets, indices, flip, &connection);
 
     normals = normals_tmp;
 }
@@ -83,50 +74,43 @@ void MeshRefiner::genNormalsWithSmoothAngle(float smooth_angle, bool flip)
 {
     buildConnection();
 
-    auto& p = points;
+    int num_points = (int)points.size();
     size_t num_indices = indices.size();
     size_t num_faces = counts.size();
-    normals_tmp.resize(num_indices);
+    normals_tmp.resize_discard(num_indices);
 
     // gen face normals
-    face_normals.resize_zeroclear(num_faces);
-    int i1 = flip ? 2 : 1;
-    int i2 = flip ? 1 : 2;
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int offset = offsets[fi];
-        const int *face = &indices[offset];
-        float3 p0 = p[face[0]];
-        float3 p1 = p[face[i1]];
-        float3 p2 = p[face[i2]];
-        float3 n = cross(p1 - p0, p2 - p0);
-        face_normals[fi] = n;
-    }
+    face_normals.resize_discard(num_faces);
+    GenerateFaceNormals(face_normals, points, offsets, indices, flip);
     Normalize(face_normals.data(), face_normals.size());
 
-    // gen vertex normals
+    // gen vertex normals. for each vertex, gather normals of connected faces into SoA and
+    // let SmoothNormalsFan() write normals of all corners of the vertex at once.
     const float angle = std::cos(smooth_angle * Deg2Rad) - 0.001f;
-    for (size_t fi = 0; fi < num_faces; ++fi)
-    {
-        int count = counts[fi];
-        int offset = offsets[fi];
-        const int *face = &indices[offset];
-        auto& face_normal = face_normals[fi];
-        for (int ci = 0; ci < count; ++ci) {
-            int vi = face[ci];
-            auto normal = float3::zero();
-            connection.eachConnectedFaces(vi, [&](int fi2, int) {
-                float3 n = face_normals[fi2];
-                if (dot(face_normal, n) > angle) {
-                    normal += n;
-                }
-            });
-            normals_tmp[offset + ci] = normal;
+    parallel_for_blocked(0, num_points, 1024, [&](int begin, int end) {
+        RawVector<float> soa;
+        for (int vi = begin; vi < end; ++vi) {
+            int count = connection.v2f_counts[vi];
+            int offset = connection.v2f_offsets[vi];
+            if (count == 0) { continue; }
+
+            soa.resize_discard(count * 3);
+            float *nx = soa.data();
+            float *ny = nx + count;
+            float *nz = ny + count;
+            const int *faces = &connection.v2f_faces[offset];
+            for (int i = 0; i < count; ++i) {
+                float3 n = face_normals[faces[i]];
+                nx[i] = n.x; ny[i] = n.y; nz[i] = n.z;
+            }
+            SmoothNormalsFan(normals_tmp.data(), &connection.v2f_indices[offset], nx, ny, nz, count, angle);
         }
-    }
+    });
 
     // normalize
-    Normalize(normals_tmp.data(), normals_tmp.size());
+    parallel_for_blocked(0, (int)num_indices, 4096, [&](int begin, int end) {
+        Normalize(&normals_tmp[begin], end - begin);
+    });
     normals = normals_tmp;
 }
 
@@ -134,6 +118,8 @@ void MeshRefiner::genTangents()
 {
     tangents_tmp.resize_discard(std::max<size_t>(normals.size(), uv.size()));
     mu::GenerateTangentsPoly(tangents_tmp, points, normals, uv, counts, offsets, indices);
+
+    tangents = tangents_tmp;
 }
 
 bool MeshRefiner::refine(bool optimize)
@@ -214,7 +200,11 @@ bool MeshRefiner::refineDumb()
     // flatten
     if ((int)points.size() > split_unit ||
         (int)normals.size() == num_indices ||
-        (int)uv.size() == num_indices)
+        (int)tangents.size() == num_indices ||
+        (int)uv.size() == num_indices ||
+        (int)uv1.size() == num_indices ||
+        (int)colors.size() == num_indices ||
+        (int)weights4.size() == num_indices)
     {
         {
             new_points.resize(num_indices);
@@ -226,15 +216,30 @@ bool MeshRefiner::refineDumb()
             mu::CopyWithIndices(new_normals.data(), normals.data(), indices);
             normals = new_normals;
         }
+        if (!tangents.empty() && (int)tangents.size() != num_indices) {
+            new_tangents.resize(num_indices);
+            mu::CopyWithIndices(new_tangents.data(), tangents.data(), indices);
+            tangents = new_tangents;
+        }
         if (!uv.empty() && (int)uv.size() != num_indices) {
             new_uv.resize(num_indices);
             mu::CopyWithIndices(new_uv.data(), uv.data(), indices);
             uv = new_uv;
         }
+        if (!uv1.empty() && (int)uv1.size() != num_indices) {
+            new_uv1.resize(num_indices);
+            mu::CopyWithIndices(new_uv1.data(), uv1.data(), indices);
+            uv1 = new_uv1;
+        }
         if (!colors.empty() && (int)colors.size() != num_indices) {
             new_colors.resize(num_indices);
             mu::CopyWithIndices(new_colors.data(), colors.data(), indices);
-            colors = colors;
+            colors = new_colors;
+        }
+        if (!weights4.empty() && (int)weights4.size() != num_indices) {
+            new_weights4.resize(num_indices);
+            mu::CopyWithIndices(new_weights4.data(), weights4.data(), indices);
+            weights4 = new_weights4;
         }
         flattened = true;
     }
@@ -284,216 +289,232 @@ bool MeshRefiner::refineDumb()
 }
 
 
-template<class Body>
-void MeshRefiner::doRefine(const Body& body)
+template<class T>
+bool MeshRefiner::setupAttribute(Attribute<T>& attr, const IArray<T>& src, RawVector<T>& dst, int flag, int& mask)
 {
-    buildConnection();
+    attr = Attribute<T>();
+    if (src.empty()) { return true; }
 
+    int num_points = (int)points.size();
     int num_indices = (int)indices.size();
-    new_points.reserve(num_indices);
-    new_normals.reserve(num_indices);
-    if (!uv.empty()) { new_uv.reserve(num_indices); }
-    new_indices.reserve(num_indices);
+    if ((int)src.size() == num_indices) { attr.domain = 1; }
+    else if ((int)src.size() == num_points) { attr.domain = 0; }
+    else { return false; }
+
+    attr.src = src.data();
+    attr.dst = &dst;
+    mask |= flag;
+    return true;
+}
+
+// terminates the recursion of refineWithMask()
+template<> void MeshRefiner::refineWithMask<-1>(int /*mask*/) {}
+
+// convert the runtime attribute mask to the template parameter
+template<int Mask>
+void MeshRefiner::refineWithMask(int mask)
+{
+    if (mask == Mask) {
+        doRefine<Mask>();
+    }
+    else {
+        refineWithMask<Mask - 1>(mask);
+    }
+}
+
+// i0 and i1 must be indices that refer the same vertex
+template<int Mask>
+bool MeshRefiner::matchCorners(int i0, int i1) const
+{
+    // tangent can be omitted if normal and uv exist as it is generated by point, normal and uv
+    const bool compare_tangents = (Mask & Attr_Tangents) && !((Mask & Attr_Normals) && (Mask & Attr_UV0));
+
+    return
+        (!(Mask & Attr_Normals)  || attr_normals.match(i0, i1)) &&
+        (!compare_tangents       || attr_tangents.match(i0, i1)) &&
+        (!(Mask & Attr_UV0)      || attr_uv0.match(i0, i1)) &&
+        (!(Mask & Attr_UV1)      || attr_uv1.match(i0, i1)) &&
+        (!(Mask & Attr_Colors)   || attr_colors.match(i0, i1)) &&
+        (!(Mask & Attr_Weights4) || attr_weights4.match(i0, i1));
+}
 
-    old2new_indices.resize(num_indices, -1);
+template<int Mask>
+void MeshRefiner::resizeAttributes(int num_vertices)
+{
+    if (Mask & Attr_Normals)  { attr_normals.dst->resize_discard(num_vertices); }
+    if (Mask & Attr_Tangents) { attr_tangents.dst->resize_discard(num_vertices); }
+    if (Mask & Attr_UV0)      { attr_uv0.dst->resize_discard(num_vertices); }
+    if (Mask & Attr_UV1)      { attr_uv1.dst->resize_discard(num_vertices); }
+    if (Mask & Attr_Colors)   { attr_colors.dst->resize_discard(num_vertices); }
+    if (Mask & Attr_Weights4) { attr_weights4.dst->resize_discard(num_vertices); }
+}
 
+template<int Mask>
+void MeshRefiner::copyAttributes(int ni, int vi, int i)
+{
+    if (Mask & Attr_Normals)  { attr_normals.copy(ni, vi, i); }
+    if (Mask & Attr_Tangents) { attr_tangents.copy(ni, vi, i); }
+    if (Mask & Attr_UV0)      { attr_uv0.copy(ni, vi, i); }
+    if (Mask & Attr_UV1)      { attr_uv1.copy(ni, vi, i); }
+    if (Mask & Attr_Colors)   { attr_colors.copy(ni, vi, i); }
+    if (Mask & Attr_Weights4) { attr_weights4.copy(ni, vi, i); }
+}
+
+template<int Mask>
+void MeshRefiner::doRefine()
+{
+    buildConnection();
+
+    int num_points = (int)points.size();
+    int num_indices = (int)indices.size();
     int num_faces_total = (int)counts.size();
-    int offset_faces = 0;
-    int offset_indices = 0;
-    int offset_vertices = 0;
-    int num_faces = 0;
-    int num_indices_triangulated = 0;
 
-    auto add_new_split = [&]() {
+    // phase 1: classify the indices of each vertex into groups that can share a new vertex.
+    // vertices are independent so this can be done in parallel.
+    // after this, corner_ids[i] is an unique id of the new vertex index i will refer.
+    corner_ids.resize_discard(num_indices);
+    corner_id_offsets.resize_discard(num_points);
+    corner_reps.resize_discard(num_indices);
+    parallel_for_blocked(0, num_points, 2048, [this](int begin, int end) {
+        for (int vi = begin; vi < end; ++vi) {
+            int offset = connection.v2f_offsets[vi];
+            int count = connection.v2f_counts[vi];
+            const int *vindices = &connection.v2f_indices[offset];
+            int *reps = &corner_reps[offset];
+
+            int num_groups = 0;
+            for (int ci = 0; ci < count; ++ci) {
+                int i = vindices[ci];
+                int gi = 0;
+                while (gi < num_groups && !matchCorners<Mask>(reps[gi], i)) { ++gi; }
+                if (gi == num_groups) { reps[num_groups++] = i; }
+                corner_ids[i] = gi;
+            }
+            corner_id_offsets[vi] = num_groups;
+        }
+    });
+
+    int num_ids = 0;
+    for (int vi = 0; vi < num_points; ++vi) {
+        int n = corner_id_offsets[vi];
+        corner_id_offsets[vi] = num_ids;
+        num_ids += n;
+    }
+    parallel_for_blocked(0, num_indices, 8192, [this](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            corner_ids[i] += corner_id_offsets[indices[i]];
+        }
+    });
+
+    // phase 2: find split boundaries and assign split-local vertex indices. this only visits each corner once so it is fast enough to be done serially.
+    // split_stamps[id] holds the last split that referred the id, so no need to clear it at each boundary.
+    // split_remap[id] is the local index of the id in that split, and split_corners holds the first corner of each new vertex.
+    splits.clear();
+    split_stamps.clear();
+    split_stamps.resize(num_ids, -1);
+    split_remap.resize_discard(num_ids);
+    split_corners.clear();
+    new_indices.resize_discard(num_indices);
+    {
         auto split = Split{};
-        split.offset_faces = offset_faces;
-        split.offset_indices = offset_indices;
-        split.offset_vertices = offset_vertices;
-        split.num_faces = num_faces;
-        split.num_indices_triangulated = num_indices_triangulated;
-        split.num_vertices = (int)new_points.size() - offset_vertices;
-        split.num_indices = (int)new_indices.size() - offset_indices;
-        splits.push_back(split);
+        auto add_new_split = [&]() {
+            splits.push_back(split);
 
-        offset_faces += split.num_faces;
-        offset_indices += split.num_indices;
-        offset_vertices += split.num_vertices;
-        num_faces = 0;
-        num_indices_triangulated = 0;
-    };
+            auto prev = split;
+            split = Split{};
+            split.offset_faces = prev.offset_faces + prev.num_faces;
+            split.offset_indices = prev.offset_indices + prev.num_indices;
+            split.offset_indices_triangulated = prev.offset_indices_triangulated + prev.num_indices_triangulated;
+            split.offset_vertices = prev.offset_vertices + prev.num_vertices;
+        };
 
-    for (int fi = 0; fi < num_faces_total; ++fi) {
-        int offset = offsets[fi];
-        int count = counts[fi];
+        for (int fi = 0; fi < num_faces_total; ++fi) {
+            int offset = offsets[fi];
+            int count = counts[fi];
 
-        if (split_unit > 0 && (int)new_points.size() - offset_vertices + count > split_unit) {
-            add_new_split();
+            if (split_unit > 0 && split.num_faces > 0 && split.num_vertices + count > split_unit) {
+                add_new_split();
+            }
 
-            // clear vertex cache
-            std::fill(old2new_indices.begin(), old2new_indices.end(), -1);
+            int sid = (int)splits.size();
+            for (int ci = 0; ci < count; ++ci) {
+                int i = offset + ci;
+                int id = corner_ids[i];
+                int& stamp = split_stamps[id];
+                if (stamp != sid) {
+                    stamp = sid;
+                    split_remap[id] = split.num_vertices++;
+                    split_corners.push_back(i);
+                }
+                new_indices[i] = split_remap[id];
+            }
+            ++split.num_faces;
+            split.num_indices += count;
+            split.num_indices_triangulated += (count - 2) * 3;
         }
+        add_new_split();
+    }
 
-        for (int ci = 0; ci < count; ++ci) {
-            int i = offset + ci;
+    // phase 3: build vertices and indices of each split in parallel.
+    // splits are placed by prefix sums calculated in phase 2, so no need to concatenate later.
+    const auto& last = splits.back();
+    int num_new_vertices = last.offset_vertices + last.num_vertices;
+    int num_new_indices_triangulated = last.offset_indices_triangulated + last.num_indices_triangulated;
+
+    new_points.resize_discard(num_new_vertices);
+    new2old_vertices.resize_discard(num_new_vertices);
+    resizeAttributes<Mask>(num_new_vertices);
+    old2new_indices.resize_discard(num_indices);
+    if (triangulate) {
+        new_indices_triangulated.resize_discard(num_new_indices_triangulated);
+    }
+
+    int num_splits = (int)splits.size();
+    parallel_for(0, num_splits, [this](int si) {
+        auto& split = splits[si];
+
+        int vertex_end = split.offset_vertices + split.num_vertices;
+        for (int ni = split.offset_vertices; ni < vertex_end; ++ni) {
+            int i = split_corners[ni];
             int vi = indices[i];
-            int ni = body(vi, i);
-            new_indices.push_back(ni - offset_vertices);
+            new2old_vertices[ni] = vi;
+            new_points[ni] = points[vi];
+            copyAttributes<Mask>(ni, vi, i);
         }
-        ++num_faces;
-        num_indices_triangulated += (count - 2) * 3;
-    }
-    add_new_split();
 
-    if (triangulate) {
-        int nindices = 0;
-        for (auto& split : splits) {
-            nindices += split.num_indices_triangulated;
+        int index_end = split.offset_indices + split.num_indices;
+        for (int i = split.offset_indices; i < index_end; ++i) {
+            old2new_indices[i] = split.offset_vertices + new_indices[i];
         }
 
-        new_indices_triangulated.resize(nindices);
-        int *sub_indices = new_indices_triangulated.data();
-        int *n_counts = counts.data();
-        int *n_indices = new_indices.data();
-        for (auto& split : splits) {
+        if (triangulate) {
+            int *sub_indices = &new_indices_triangulated[split.offset_indices_triangulated];
             mu::TriangulateWithIndices(sub_indices,
-                IntrusiveArray<int>(n_counts, split.num_faces),
-                IntrusiveArray<int>(n_indices, split.num_indices),
+                IArray<int>(&counts[split.offset_faces], split.num_faces),
+                IArray<int>(&new_indices[split.offset_indices], split.num_indices),
                 swap_faces);
-            sub_indices += split.num_indices_triangulated;
-            n_counts += split.num_faces;
-            n_indices += split.num_indices;
         }
-    }
-    else if (swap_faces) {
+    });
+
+    if (!triangulate && swap_faces) {
         // todo
     }
 }
 
 bool MeshRefiner::refineWithOptimization()
 {
-    int num_points = (int)points.size();
-    int num_indices = (int)indices.size();
-    int num_normals = (int)normals.size();
-    int num_uv = (int)uv.size();
-    int num_colors = (int)colors.size();
-
-    if (!uv.empty()) {
-        if (!normals.empty()) {
-            if (!tangents_tmp.empty()) {
-                if (!colors.empty()) {
-                    if (num_normals == num_indices && num_uv == num_indices && num_colors == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[i], tangents_tmp[i], uv[i], colors[i]);
-                        });
-                    }
-                    else if (num_normals == num_indices && num_uv == num_indices && num_colors == num_points) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[i], tangents_tmp[i], uv[i], colors[vi]);
-                        });
-                    }
-                    else if (num_normals == num_indices && num_uv == num_points && num_colors == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[i], tangents_tmp[i], uv[vi], colors[i]);
-                        });
-                    }
-                    else if (num_normals == num_indices && num_uv == num_points && num_colors == num_points) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[i], tangents_tmp[i], uv[vi], colors[vi]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_indices && num_colors == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[vi], tangents_tmp[i], uv[i], colors[i]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_indices && num_colors == num_points) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[vi], tangents_tmp[i], uv[i], colors[vi]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_points && num_colors == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[vi], tangents_tmp[vi], uv[vi], colors[i]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_points && num_colors == num_points) {
-                        doRefine([this](int vi, int) {
-                            return findOrAddVertexPNTUC(vi, points[vi], normals[vi], tangents_tmp[vi], uv[vi], colors[vi]);
-                        });
-                    }
-                }
-                else {
-                    if (num_normals == num_indices && num_uv == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTU(vi, points[vi], normals[i], tangents_tmp[i], uv[i]);
-                        });
-                    }
-                    else if (num_normals == num_indices && num_uv == num_points) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTU(vi, points[vi], normals[i], tangents_tmp[i], uv[vi]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_indices) {
-                        doRefine([this](int vi, int i) {
-                            return findOrAddVertexPNTU(vi, points[vi], normals[vi], tangents_tmp[i], uv[i]);
-                        });
-                    }
-                    else if (num_normals == num_points && num_uv == num_points) {
-                        doRefine([this](int vi, int) {
-                            return findOrAddVertexPNTU(vi, points[vi], normals[vi], tangents_tmp[vi], uv[vi]);
-                        });
-                    }
-                }
-            }
-            else {
-                if (num_normals == num_indices && num_uv == num_indices) {
-                    doRefine([this](int vi, int i) {
-                        return findOrAddVertexPNU(vi, points[vi], normals[i], uv[i]);
-                    });
-                }
-                else if (num_normals == num_indices && num_uv == num_points) {
-                    doRefine([this](int vi, int i) {
-                        return findOrAddVertexPNU(vi, points[vi], normals[i], uv[vi]);
-                    });
-                }
-                else if (num_normals == num_points && num_uv == num_indices) {
-                    doRefine([this](int vi, int i) {
-                        return findOrAddVertexPNU(vi, points[vi], normals[vi], uv[i]);
-                    });
-                }
-                else if (num_normals == num_points && num_uv == num_points) {
-                    doRefine([this](int vi, int) {
-                        return findOrAddVertexPNU(vi, points[vi], normals[vi], uv[vi]);
-                    });
-                }
-            }
-        }
-        else {
-            if (num_uv == num_indices) {
-                doRefine([this](int vi, int i) {
-                    return findOrAddVertexPU(vi, points[vi], uv[i]);
-                });
-            }
-            else if (num_uv == num_points) {
-                doRefine([this](int vi, int) {
-                    return findOrAddVertexPU(vi, points[vi], uv[vi]);
-                });
-            }
-        }
-    }
-    else {
-        if (num_normals == num_indices) {
-            doRefine([this](int vi, int i) {
-                return findOrAddVertexPN(vi, points[vi], normals[i]);
-            });
-        }
-        else if (num_normals == num_points) {
-            doRefine([this](int vi, int) {
-                return findOrAddVertexPN(vi, points[vi], normals[vi]);
-            });
-        }
+    int mask = 0;
+    if (!setupAttribute(attr_normals, normals, new_normals, Attr_Normals, mask) ||
+        !setupAttribute(attr_tangents, tangents, new_tangents, Attr_Tangents, mask) ||
+        !setupAttribute(attr_uv0, uv, new_uv, Attr_UV0, mask) ||
+        !setupAttribute(attr_uv1, uv1, new_uv1, Attr_UV1, mask) ||
+        !setupAttribute(attr_colors, colors, new_colors, Attr_Colors, mask) ||
+        !setupAttribute(attr_weights4, weights4, new_weights4, Attr_Weights4, mask))
+    {
+        return false;
     }
 
+    refineWithMask<Attr_All>(mask);
     return true;
 }
 
@@ -504,6 +525,21 @@ void MeshRefiner::swapNewData(
     RawVector<float2>& u,
     RawVector<float4>& c,
     RawVector<int>& idx)
+{
+    RawVector<float2> u1;
+    RawVector<Weights4> w;
+    swapNewData(p, n, t, u, u1, c, w, idx);
+}
+
+void MeshRefiner::swapNewData(
+    RawVector<float3>& p,
+    RawVector<float3>& n,
+    RawVector<float4>& t,
+    RawVector<float2>& u,
+    RawVector<float2>& u1,
+    RawVector<float4>& c,
+    RawVector<Weights4>& w,
+    RawVector<int>& idx)
 {
     if (!new_points.empty()) { p.swap(new_points); }
 
@@ -514,7 +550,9 @@ void MeshRefiner::swapNewData(
     else if (!tangents_tmp.empty()) { t.swap(tangents_tmp); }
 
     if (!new_uv.empty()) { u.swap(new_uv); }
+    if (!new_uv1.empty()) { u1.swap(new_uv1); }
     if (!new_colors.empty()) { c.swap(new_colors); }
+    if (!new_weights4.empty()) { w.swap(new_weights4); }
 
     if (!new_indices_submeshes.empty()) { idx.swap(new_indices_submeshes); }
     else if (!new_indices_triangulated.empty()) { idx.swap(new_indices_triangulated); }
@@ -528,111 +566,4 @@ void MeshRefiner::buildConnection()
     connection.buildConnection(indices, counts, offsets, points);
 }
 
-int MeshRefiner::findOrAddVertexPNTUC(int vi, const float3& p, const float3& n, const float4& t, const float2& u, const float4& c)
-{
-    int offset = connection.v2f_offsets[vi];
-    int count = connection.v2f_counts[vi];
-    for (int ci = 0; ci < count; ++ci) {
-        int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-        // tangent can be omitted as it is generated by point, normal and uv
-        if (ni != -1 && near_equal(new_points[ni], p) && near_equal(new_normals[ni], n) && near_equal(new_uv[ni], u) && near_equal(new_colors[ni], c)) {
-            return ni;
-        }
-        else if (ni == -1) {
-            new2old_vertices.push_back(vi);
-            ni = (int)new_points.size();
-            new_points.push_back(p);
-            new_normals.push_back(n);
-            new_tangents.push_back(t);
-            new_uv.push_back(u);
-            new_colors.push_back(c);
-            return ni;
-        }
-    }
-    return 0;
-}
-
-int MeshRefiner::findOrAddVertexPNTU(int vi, const float3& p, const float3& n, const float4& t, const float2& u)
-{
-    int offset = connection.v2f_offsets[vi];
-    int count = connection.v2f_counts[vi];
-    for (int ci = 0; ci < count; ++ci) {
-        int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-        if (ni != -1 && near_equal(new_points[ni], p) && near_equal(new_normals[ni], n) && near_equal(new_uv[ni], u)) {
-            return ni;
-        }
-        else if (ni == -1) {
-            new2old_vertices.push_back(vi);
-            ni = (int)new_points.size();
-            new_points.push_back(p);
-            new_normals.push_back(n);
-            new_tangents.push_back(t);
-            new_uv.push_back(u);
-            return ni;
-        }
-    }
-    return 0;
-}
-
-int MeshRefiner::findOrAddVertexPNU(int vi, const float3& p, const float3& n, const float2& u)
-{
-    int offset = connection.v2f_offsets[vi];
-    int count = connection.v2f_counts[vi];
-    for (int ci = 0; ci < count; ++ci) {
-        int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-        if (ni != -1 && near_equal(new_points[ni], p) && near_equal(new_normals[ni], n) && near_equal(new_uv[ni], u)) {
-            return ni;
-        }
-        else if (ni == -1) {
-            new2old_vertices.push_back(vi);
-            ni = (int)new_points.size();
-            new_points.push_back(p);
-            new_normals.push_back(n);
-            new_uv.push_back(u);
-            return ni;
-        }
-    }
-    return 0;
-}
-
-int MeshRefiner::findOrAddVertexPN(int vi, const float3& p, const float3& n)
-{
-    int offset = connection.v2f_offsets[vi];
-    int count = connection.v2f_counts[vi];
-    for (int ci = 0; ci < count; ++ci) {
-        int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-        if (ni != -1 && near_equal(new_points[ni], p) && near_equal(new_normals[ni], n)) {
-            return ni;
-        }
-        else if (ni == -1) {
-            new2old_vertices.push_back(vi);
-            ni = (int)new_points.size();
-            new_points.push_back(p);
-            new_normals.push_back(n);
-            return ni;
-        }
-    }
-    return 0;
-}
-
-int MeshRefiner::findOrAddVertexPU(int vi, const float3& p, const float2& u)
-{
-    int offset = connection.v2f_offsets[vi];
-    int count = connection.v2f_counts[vi];
-    for (int ci = 0; ci < count; ++ci) {
-        int& ni = old2new_indices[connection.v2f_indices[offset + ci]];
-        if (ni != -1 && near_equal(new_points[ni], p) && near_equal(new_uv[ni], u)) {
-            return ni;
-        }
-        else if (ni == -1) {
-            new2old_vertices.push_back(vi);
-            ni = (int)new_points.size();
-            new_points.push_back(p);
-            new_uv.push_back(u);
-            return ni;
-        }
-    }
-    return 0;
-}
-
 } // namespace mu
@@ -4,6 +4,18 @@ namespace mu {
 
 struct MeshRefiner
 {
+    // bits of the compile-time attribute mask used by refineWithOptimization()
+    enum AttributeFlags
+    {
+        Attr_Normals    = 1 << 0,
+        Attr_Tangents   = 1 << 1,
+        Attr_UV0        = 1 << 2,
+        Attr_UV1        = 1 << 3,
+        Attr_Colors     = 1 << 4,
+        Attr_Weights4   = 1 << 5,
+        Attr_All        = (1 << 6) - 1,
+    };
+
     struct Submesh
     {
         int num_indices_tri = 0;
@@ -16,6 +28,7 @@ struct MeshRefiner
         int offset_faces = 0;
         int offset_indices = 0;
         int offset_vertices = 0;
+        int offset_indices_triangulated = 0;
         int num_faces = 0;
         int num_vertices = 0;
         int num_indices = 0;
@@ -31,8 +44,11 @@ struct MeshRefiner
     IArray<int> indices;
     IArray<float3> points;
     IArray<float3> normals;
+    IArray<float4> tangents;
     IArray<float2> uv;
+    IArray<float2> uv1;
     IArray<float4> colors;
+    IArray<Weights4> weights4;
     RawVector<Submesh> submeshes;
     RawVector<Split> splits;
 
@@ -40,9 +56,33 @@ struct MeshRefiner
     RawVector<int> new2old_vertices; // indices to old vertices
 
 private:
+    // per-attribute descriptor. domain: 0 == per-vertex, 1 == per-index
+    template<class T>
+    struct Attribute
+    {
+        const T *src = nullptr;
+        RawVector<T> *dst = nullptr;
+        int domain = 0;
+
+        const T& get(int vi, int i) const
+        {
+            int idx[2] = { vi, i };
+            return src[idx[domain]];
+        }
+        // i0 and i1 refer the same vertex, so per-vertex attributes always match
+        bool match(int i0, int i1) const { return domain == 0 || near_equal(src[i0], src[i1]); }
+        void copy(int ni, int vi, int i) { (*dst)[ni] = get(vi, i); }
+    };
+
     RawVector<int> counts_tmp;
     RawVector<int> offsets;
     ConnectionData connection;
+    RawVector<int> corner_ids;
+    RawVector<int> corner_id_offsets;
+    RawVector<int> corner_reps;
+    RawVector<int> split_stamps;
+    RawVector<int> split_remap;
+    RawVector<int> split_corners;
     RawVector<float3> face_normals;
     RawVector<float3> normals_tmp;
     RawVector<float4> tangents_tmp;
@@ -51,13 +91,22 @@ private:
     RawVector<float3> new_normals;
     RawVector<float4> new_tangents;
     RawVector<float2> new_uv;
+    RawVector<float2> new_uv1;
     RawVector<float4> new_colors;
+    RawVector<Weights4> new_weights4;
     RawVector<int>    new_indices;
     RawVector<int>    new_indices_triangulated;
     RawVector<int>    new_indices_submeshes;
     RawVector<int>    dummy_materialIDs;
     int num_indices_tri = 0;
 
+    Attribute<float3>   attr_normals;
+    Attribute<float4>   attr_tangents;
+    Attribute<float2>   attr_uv0;
+    Attribute<float2>   attr_uv1;
+    Attribute<float4>   attr_colors;
+    Attribute<Weights4> attr_weights4;
+
 public:
     void prepare(const IArray<int>& counts, const IArray<int>& indices, const IArray<float3>& points);
     void genNormals(bool flip);
@@ -76,18 +125,27 @@ public:
         RawVector<float2>& u,
         RawVector<float4>& c,
         RawVector<int>& idx);
+    void swapNewData(
+        RawVector<float3>& p,
+        RawVector<float3>& n,
+        RawVector<float4>& t,
+        RawVector<float2>& u,
+        RawVector<float2>& u1,
+        RawVector<float4>& c,
+        RawVector<Weights4>& w,
+        RawVector<int>& idx);
 
 private:
     bool refineDumb();
     bool refineWithOptimization();
     void buildConnection();
 
-    template<class Body> void doRefine(const Body& body);
-    int findOrAddVertexPNTUC(int vi, const float3& p, const float3& n, const float4& t, const float2& u, const float4& c);
-    int findOrAddVertexPNTU(int vi, const float3& p, const float3& n, const float4& t, const float2& u);
-    int findOrAddVertexPNU(int vi, const float3& p, const float3& n, const float2& u);
-    int findOrAddVertexPN(int vi, const float3& p, const float3& n);
-    int findOrAddVertexPU(int vi, const float3& p, const float2& u);
+    template<class T> bool setupAttribute(Attribute<T>& attr, const IArray<T>& src, RawVector<T>& dst, int flag, int& mask);
+    template<int Mask> void refineWithMask(int mask);
+    template<int Mask> void doRefine();
+    template<int Mask> bool matchCorners(int i0, int i1) const;
+    template<int Mask> void resizeAttributes(int num_vertices);
+    template<int Mask> void copyAttributes(int ni, int vi, int i);
 };
 
 } // namespace mu
@@ -3,8 +3,84 @@
 #include "muSIMD.h"
 #include "muRawVector.h"
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+    #define muX86
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
 namespace mu {
 
+#ifdef muX86
+static void CPUID(uint32_t leaf, uint32_t subleaf, uint32_t (&dst)[4])
+{
+#ifdef _MSC_VER
+    __cpuidex((int*)dst, (int)leaf, (int)subleaf);
+#else
+    __cpuid_count(leaf, subleaf, dst[0], dst[1], dst[2], dst[3]);
+#endif
+}
+
+// XCR0. tells which register states the OS saves on context switch.
+static uint64_t XGETBV()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static SIMDTarget DetectSIMDTarget()
+{
+    uint32_t r[4]; // eax, ebx, ecx, edx
+    CPUID(0, 0, r);
+    uint32_t max_leaf = r[0];
+
+    CPUID(1, 0, r);
+    uint32_t ecx1 = r[2];
+    bool sse41 = (ecx1 & (1 << 19)) != 0;
+    if (!sse41) { return SIMDTarget::Generic; }
+
+    bool osxsave = (ecx1 & (1 << 27)) != 0;
+    bool avx = (ecx1 & (1 << 28)) != 0;
+    if (!osxsave || !avx || max_leaf < 7) { return SIMDTarget::SSE4; }
+
+    uint64_t xcr0 = XGETBV();
+    if ((xcr0 & 0x06) != 0x06) { return SIMDTarget::SSE4; } // xmm & ymm
+
+    CPUID(7, 0, r);
+    uint32_t ebx7 = r[1];
+    bool fma = (ecx1 & (1 << 12)) != 0;
+    bool f16c = (ecx1 & (1 << 29)) != 0;
+    bool avx2 = (ebx7 & (1 << 5)) != 0;
+    if (!fma || !f16c || !avx2) { return SIMDTarget::SSE4; }
+
+    // F, DQ, CD, BW and VL are the subsets Skylake-X has
+    const uint32_t avx512skx = (1u << 16) | (1u << 17) | (1u << 28) | (1u << 30) | (1u << 31);
+    if ((ebx7 & avx512skx) != avx512skx || (xcr0 & 0xe6) != 0xe6) { return SIMDTarget::AVX2; } // + opmask & zmm
+
+    return SIMDTarget::AVX512;
+}
+#else
+static SIMDTarget DetectSIMDTarget()
+{
+    return SIMDTarget::Generic;
+}
+#endif
+
+SIMDTarget GetSIMDTarget()
+{
+    static const SIMDTarget s_target = DetectSIMDTarget();
+    return s_target;
+}
+
+
 
 #ifdef muEnableISPC
 #include "MeshUtilsCore.h"
@@ -241,99 +317,139 @@ void GenerateTangentsTriangleSoA_ISPC(float4 *dst,
         num_triangles, num_vertices);
 }
 #endif
+
 #endif // muEnableISPC
 
 
+// ForwardSIMD() is for kernels that also have SSE versions (muSIMDSSE.cpp).
+// Fallback() / FallbackSIMD() are used when a kernel's ISPC version is disabled (see muSIMDConfig.h) or can't run,
+// and by kernels that have no ISPC version.
+#ifdef muEnableSSE
+#define Fallback(Name, ...) Name##_Generic(__VA_ARGS__)
+#define FallbackSIMD(Name, ...) Name##_SSE(__VA_ARGS__)
+#else
+#define Fallback(Name, ...) Name##_Generic(__VA_ARGS__)
+#define FallbackSIMD(Name, ...) Name##_Generic(__VA_ARGS__)
+#endif
+
 #ifdef muEnableISPC
-    #define Forward(Name, ...) Name##_ISPC(__VA_ARGS__)
+// ISPC kernels are built for sse4, avx2 and avx512skx. ISPC's dispatcher picks the best of them on the first call.
+// it can't run anything on CPUs older than SSE4, so fall back to the SSE2 or generic versions there.
+static inline bool ISPCAvailable()
+{
+    static const bool s_available = GetSIMDTarget() >= SIMDTarget::SSE4;
+    return s_available;
+}
+#define Forward(Name, ...) (ISPCAvailable() ? Name##_ISPC(__VA_ARGS__) : Fallback(Name, __VA_ARGS__))
+#define ForwardSIMD(Name, ...) (ISPCAvailable() ? Name##_ISPC(__VA_ARGS__) : FallbackSIMD(Name, __VA_ARGS__))
 #else
-    #define Forward(Name, ...) Name##_Generic(__VA_ARGS__)
+#define Forward(Name, ...) Fallback(Name, __VA_ARGS__)
+#define ForwardSIMD(Name, ...) FallbackSIMD(Name, __VA_ARGS__)
 #endif
 
 #ifdef muEnableHalf
-#if defined(muSIMD_FloatToHalf) || !defined(muEnableISPC)
 void FloatToHalf(half *dst, const float *src, size_t num)
 {
+#if defined(muSIMD_FloatToHalf) || !defined(muEnableISPC)
     Forward(FloatToHalf, dst, src, num);
-}
+#else
+    Fallback(FloatToHalf, dst, src, num);
 #endif
-#if defined(muSIMD_HalfToFloat) || !defined(muEnableISPC)
+}
 void HalfToFloat(float *dst, const half *src, size_t num)
 {
+#if defined(muSIMD_HalfToFloat) || !defined(muEnableISPC)
     Forward(HalfToFloat, dst, src, num);
-}
+#else
+    Fallback(HalfToFloat, dst, src, num);
 #endif
+}
 #endif // muEnableHalf
 
-#if defined(muSIMD_InvertX3) || !defined(muEnableISPC)
 void InvertX(float3 *dst, size_t num)
 {
-    Forward(InvertX, dst, num);
-}
+#if defined(muSIMD_InvertX3) || !defined(muEnableISPC)
+    ForwardSIMD(InvertX, dst, num);
+#else
+    FallbackSIMD(InvertX, dst, num);
 #endif
-#if defined(muSIMD_InvertX4) || !defined(muEnableISPC)
+}
 void InvertX(float4 *dst, size_t num)
 {
-    Forward(InvertX, dst, num);
-}
+#if defined(muSIMD_InvertX4) || !defined(muEnableISPC)
+    ForwardSIMD(InvertX, dst, num);
+#else
+    FallbackSIMD(InvertX, dst, num);
 #endif
+}
 
-#if defined(muSIMD_Scale) || !defined(muEnableISPC)
 void Scale(float *dst, float s, size_t num)
 {
+#if defined(muSIMD_Scale) || !defined(muEnableISPC)
     Forward(Scale, dst, s, num);
-}
+#else
+    Fallback(Scale, dst, s, num);
 #endif
-#if defined(muSIMD_Scale) || !defined(muEnableISPC)
+}
 void Scale(float3 *dst, float s, size_t num)
 {
+#if defined(muSIMD_Scale) || !defined(muEnableISPC)
     Forward(Scale, dst, s, num);
-}
+#else
+    Fallback(Scale, dst, s, num);
 #endif
+}
 
-#if defined(muSIMD_Normalize) || !defined(muEnableISPC)
 void Normalize(float3 *dst, size_t num)
 {
-    Forward(Normalize, dst, num);
-}
+#if defined(muSIMD_Normalize) || !defined(muEnableISPC)
+    ForwardSIMD(Normalize, dst, num);
+#else
+    FallbackSIMD(Normalize, dst, num);
 #endif
+}
 
-#if defined(muSIMD_Lerp) || !defined(muEnableISPC)
 void Lerp(float *dst, const float *src1, const float *src2, size_t num, float w)
 {
+#if defined(muSIMD_Lerp) || !defined(muEnableISPC)
     Forward(Lerp, dst, src1, src2, num, w);
-}
+#else
+    Fallback(Lerp, dst, src1, src2, num, w);
 #endif
-#if defined(muSIMD_Lerp) || !defined(muEnableISPC)
+}
 void Lerp(float2 *dst, const float2 *src1, const float2 *src2, size_t num, float w)
 {
     Lerp((float*)dst, (const float*)src1, (const float*)src2, num * 2, w);
 }
-#endif
-#if defined(muSIMD_Lerp) || !defined(muEnableISPC)
 void Lerp(float3 *dst, const float3 *src1, const float3 *src2, size_t num, float w)
 {
     Lerp((float*)dst, (const float*)src1, (const float*)src2, num * 3, w);
 }
-#endif
 
-#if defined(muSIMD_MinMax2) || !defined(muEnableISPC)
 void MinMax(const float2 *p, size_t num, float2& dst_min, float2& dst_max)
 {
-    Forward(MinMax, p, num, dst_min, dst_max);
-}
+#if defined(muSIMD_MinMax2) || !defined(muEnableISPC)
+    ForwardSIMD(MinMax, p, num, dst_min, dst_max);
+#else
+    FallbackSIMD(MinMax, p, num, dst_min, dst_max);
 #endif
-#if defined(muSIMD_MinMax3) || !defined(muEnableISPC)
+}
 void MinMax(const float3 *p, size_t num, float3& dst_min, float3& dst_max)
 {
-    Forward(MinMax, p, num, dst_min, dst_max);
-}
+#if defined(muSIMD_MinMax3) || !defined(muEnableISPC)
+    ForwardSIMD(MinMax, p, num, dst_min, dst_max);
+#else
+    FallbackSIMD(MinMax, p, num, dst_min, dst_max);
 #endif
+}
 
-#if defined(muSIMD_NearEqual) || !defined(muEnableISPC)
 bool NearEqual(const float *src1, const float *src2, size_t num, float eps)
 {
-    return Forward(NearEqual, src1, src2, num, eps);
+#if defined(muSIMD_NearEqual) || !defined(muEnableISPC)
+    return ForwardSIMD(NearEqual, src1, src2, num, eps);
+#else
+    return FallbackSIMD(NearEqual, src1, src2, num, eps);
+#endif
 }
 bool NearEqual(const float2 *src1, const float2 *src2, size_t num, float eps)
 {
@@ -347,109 +463,135 @@ bool NearEqual(const float4 *src1, const float4 *src2, size_t num, float eps)
 {
     return NearEqual((const float*)src1, (const float*)src2, num * 4, eps);
 }
-#endif
 
-#if defined(muSIMD_MulPoints3) || !defined(muEnableISPC)
 void MulPoints(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
 {
-    Forward(MulPoints, m, src, dst, num_data);
-}
+#if defined(muSIMD_MulPoints3) || !defined(muEnableISPC)
+    ForwardSIMD(MulPoints, m, src, dst, num_data);
+#else
+    FallbackSIMD(MulPoints, m, src, dst, num_data);
 #endif
-#if defined(muSIMD_MulVectors3) || !defined(muEnableISPC)
+}
 void MulVectors(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
 {
-    Forward(MulVectors, m, src, dst, num_data);
-}
+#if defined(muSIMD_MulVectors3) || !defined(muEnableISPC)
+    ForwardSIMD(MulVectors, m, src, dst, num_data);
+#else
+    FallbackSIMD(MulVectors, m, src, dst, num_data);
 #endif
+}
 
-#if defined(muSIMD_RayTrianglesIntersectionIndexed) || !defined(muEnableISPC)
 int RayTrianglesIntersectionIndexed(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& result)
 {
+#if defined(muSIMD_RayTrianglesIntersectionIndexed) || !defined(muEnableISPC)
     return Forward(RayTrianglesIntersectionIndexed, pos, dir, vertices, indices, num_triangles, tindex, result);
-}
+#else
+    return Fallback(RayTrianglesIntersectionIndexed, pos, dir, vertices, indices, num_triangles, tindex, result);
 #endif
-#if defined(muSIMD_RayTrianglesIntersectionFlattened) || !defined(muEnableISPC)
+}
 int RayTrianglesIntersectionFlattened(float3 pos, float3 dir, const float3 *vertices, int num_triangles, int& tindex, float& result)
 {
+#if defined(muSIMD_RayTrianglesIntersectionFlattened) || !defined(muEnableISPC)
     return Forward(RayTrianglesIntersectionFlattened, pos, dir, vertices, num_triangles, tindex, result);
-}
+#else
+    return Fallback(RayTrianglesIntersectionFlattened, pos, dir, vertices, num_triangles, tindex, result);
 #endif
-#if defined(muSIMD_RayTrianglesIntersectionSoA) || !defined(muEnableISPC)
+}
 int RayTrianglesIntersectionSoA(float3 pos, float3 dir,
     const float *v1x, const float *v1y, const float *v1z,
     const float *v2x, const float *v2y, const float *v2z,
     const float *v3x, const float *v3y, const float *v3z,
     int num_triangles, int& tindex, float& result)
 {
-    return Forward(RayTrianglesIntersectionSoA, pos, dir, v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z, num_triangles, tindex, result);
-}
+#if defined(muSIMD_RayTrianglesIntersectionSoA) || !defined(muEnableISPC)
+    return ForwardSIMD(RayTrianglesIntersectionSoA, pos, dir, v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z, num_triangles, tindex, result);
+#else
+    return FallbackSIMD(RayTrianglesIntersectionSoA, pos, dir, v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z, num_triangles, tindex, result);
 #endif
+}
 
-#if defined(muSIMD_PolyInside) || !defined(muEnableISPC)
 bool PolyInside(const float2 poly[], int ngon, const float2 minp, const float2 maxp, const float2 pos)
 {
+#if defined(muSIMD_PolyInside) || !defined(muEnableISPC)
     return Forward(PolyInside, poly, ngon, minp, maxp, pos);
-}
+#else
+    return Fallback(PolyInside, poly, ngon, minp, maxp, pos);
 #endif
-#if defined(muSIMD_PolyInside) || !defined(muEnableISPC)
+}
 bool PolyInside(const float2 poly[], int ngon, const float2 pos)
 {
+#if defined(muSIMD_PolyInside) || !defined(muEnableISPC)
     return Forward(PolyInside, poly, ngon, pos);
-}
+#else
+    return Fallback(PolyInside, poly, ngon, pos);
 #endif
-#if defined(muSIMD_PolyInsideSoA) || !defined(muEnableISPC)
+}
 bool PolyInside(const float px[], const float py[], int ngon, const float2 minp, const float2 maxp, const float2 pos)
 {
+#if defined(muSIMD_PolyInsideSoA) || !defined(muEnableISPC)
     return Forward(PolyInside, px, py, ngon, minp, maxp, pos);
-}
+#else
+    return Fallback(PolyInside, px, py, ngon, minp, maxp, pos);
 #endif
+}
 
-#if defined(muSIMD_GenerateNormalsTriangleIndexed) || !defined(muEnableISPC)
 void GenerateNormalsTriangleIndexed(float3 *dst,
     const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
 {
-    return Forward(GenerateNormalsTriangleIndexed, dst, vertices, indices, num_triangles, num_vertices);
-}
+#if defined(muSIMD_GenerateNormalsTriangleIndexed) || !defined(muEnableISPC)
+    return ForwardSIMD(GenerateNormalsTriangleIndexed, dst, vertices, indices, num_triangles, num_vertices);
+#else
+    return FallbackSIMD(GenerateNormalsTriangleIndexed, dst, vertices, indices, num_triangles, num_vertices);
 #endif
-#if defined(muSIMD_GenerateNormalsTriangleFlattened) || !defined(muEnableISPC)
+}
 void GenerateNormalsTriangleFlattened(float3 *dst,
     const float3 *vertices, const int *indices,
     int num_triangles, int num_vertices)
 {
+#if defined(muSIMD_GenerateNormalsTriangleFlattened) || !defined(muEnableISPC)
     return Forward(GenerateNormalsTriangleFlattened, dst, vertices, indices, num_triangles, num_vertices);
-}
+#else
+    return Fallback(GenerateNormalsTriangleFlattened, dst, vertices, indices, num_triangles, num_vertices);
 #endif
-#if defined(muSIMD_GenerateNormalsTriangleSoA) || !defined(muEnableISPC)
+}
 void GenerateNormalsTriangleSoA(float3 *dst,
     const float *v1x, const float *v1y, const float *v1z,
     const float *v2x, const float *v2y, const float *v2z,
     const float *v3x, const float *v3y, const float *v3z,
     const int *indices, int num_triangles, int num_vertices)
 {
+#if defined(muSIMD_GenerateNormalsTriangleSoA) || !defined(muEnableISPC)
     return Forward(GenerateNormalsTriangleSoA, dst,
         v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z,
         indices, num_triangles, num_vertices);
-}
+#else
+    return Fallback(GenerateNormalsTriangleSoA, dst,
+        v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z,
+        indices, num_triangles, num_vertices);
 #endif
+}
 
 
-#if defined(muSIMD_GenerateTangentsTriangleIndexed) || !defined(muEnableISPC)
 void GenerateTangentsTriangleIndexed(float4 *dst,
     const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
     int num_triangles, int num_vertices)
 {
-    return Forward(GenerateTangentsTriangleIndexed, dst, vertices, uv, normals, indices, num_triangles, num_vertices);
-}
+#if defined(muSIMD_GenerateTangentsTriangleIndexed) || !defined(muEnableISPC)
+    return ForwardSIMD(GenerateTangentsTriangleIndexed, dst, vertices, uv, normals, indices, num_triangles, num_vertices);
+#else
+    return FallbackSIMD(GenerateTangentsTriangleIndexed, dst, vertices, uv, normals, indices, num_triangles, num_vertices);
 #endif
-#if defined(muSIMD_GenerateTangentsTriangleFlattened) || !defined(muEnableISPC)
+}
 void GenerateTangentsTriangleFlattened(float4 *dst,
     const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
     int num_triangles, int num_vertices)
 {
+#if defined(muSIMD_GenerateTangentsTriangleFlattened) || !defined(muEnableISPC)
     return Forward(GenerateTangentsTriangleFlattened, dst, vertices, uv, normals, indices, num_triangles, num_vertices);
-}
+#else
+    return Fallback(GenerateTangentsTriangleFlattened, dst, vertices, uv, normals, indices, num_triangles, num_vertices);
 #endif
-#if defined(muSIMD_GenerateTangentsTriangleSoA) || !defined(muEnableISPC)
+}
 void GenerateTangentsTriangleSoA(float4 *dst,
     const float *v1x, const float *v1y, const float *v1z,
     const float *v2x, const float *v2y, const float *v2z,
@@ -460,12 +602,55 @@ void GenerateTangentsTriangleSoA(float4 *dst,
     const float3 *normals,
     const int *indices, int num_triangles, int num_vertices)
 {
+#if defined(muSIMD_GenerateTangentsTriangleSoA) || !defined(muEnableISPC)
     return Forward(GenerateTangentsTriangleSoA, dst,
         v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z,
         u1x, u1y, u2x, u2y, u3x, u3y,
         normals, indices, num_triangles, num_vertices);
-}
+#else
+    return Fallback(GenerateTangentsTriangleSoA, dst,
+        v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z,
+        u1x, u1y, u2x, u2y, u3x, u3y,
+        normals, indices, num_triangles, num_vertices);
 #endif
+}
+void SmoothNormalsFan(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold)
+{
+    FallbackSIMD(SmoothNormalsFan, dst, dst_indices, nx, ny, nz, num, threshold);
+}
+void GenerateHeightmapRow(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit)
+{
+    FallbackSIMD(GenerateHeightmapRow, dst_points, dst_uv, heights, num, x, z, unit, uv_unit);
+}
+void GenerateHeightmapNormalsRow(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz)
+{
+    FallbackSIMD(GenerateHeightmapNormalsRow, dst, prev, heights, next, width, height_scale, dx, dz);
+}
+void WidenIndices(int *dst, const uint16_t *src, int num)
+{
+    FallbackSIMD(WidenIndices, dst, src, num);
+}
+void Color32ToFloat4(float4 *dst, const uint32_t *src, int num)
+{
+    FallbackSIMD(Color32ToFloat4, dst, src, num);
+}
+void SelectWeights8To4(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    FallbackSIMD(SelectWeights8To4, dst, src_indices, src_weights, num);
+}
+void SelectWeights16To4(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    FallbackSIMD(SelectWeights16To4, dst, src_indices, src_weights, num);
+}
+void SelectWeights16To8(Weights<8> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    FallbackSIMD(SelectWeights16To8, dst, src_indices, src_weights, num);
+}
 
+#undef ForwardSIMD
 #undef Forward
+#undef FallbackSIMD
+#undef Fallback
 } // namespace mu
@@ -3,6 +3,18 @@
 
 namespace mu {
 
+template<int N> struct Weights;
+
+enum class SIMDTarget
+{
+    Generic,
+    SSE4,
+    AVX2,
+    AVX512,
+};
+// best instruction set the running CPU (and OS) supports. detected by CPUID on the first call.
+SIMDTarget GetSIMDTarget();
+
 #ifdef muEnableHalf
 void FloatToHalf(half *dst, const float *src, size_t num);
 void HalfToFloat(float *dst, const half *src, size_t num);
@@ -73,6 +85,30 @@ void GenerateTangentsTriangleSoA(float4 *dst,
     const float3 *normals, const int *indices,
     int num_triangles, int num_vertices);
 
+// n[xyz]: normalized normals of the faces around a vertex.
+// for each face i, sums normals of the faces j where dot(n[i], n[j]) > threshold and writes it to dst[dst_indices[i]].
+// the results are not normalized.
+void SmoothNormalsFan(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold);
+
+// num grid points of a row (z) of a heightmap grid, starting from x.
+// dst_points[i] = { (x + i) * unit.x, heights[i] * unit.y, z * unit.z }, dst_uv[i] = { (x + i) * uv_unit.x, z * uv_unit.y }
+void GenerateHeightmapRow(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit);
+// normals of one row of a heightmap grid by central differences (one-sided at the left and right ends).
+// prev / next: neighbor rows. (the row itself at the borders) dz: distance between prev and next.
+void GenerateHeightmapNormalsRow(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz);
+
+// dst[i] = src[i]. 16 bit indices to 32 bit.
+void WidenIndices(int *dst, const uint16_t *src, int num);
+// 8 bit RGBA colors (r in the lowest byte) to [0, 1] floats.
+void Color32ToFloat4(float4 *dst, const uint32_t *src, int num);
+// the N largest of M bone weights of each vertex by sorting networks, in descending order and normalized.
+// src_indices / src_weights: M influences per vertex.
+void SelectWeights8To4(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To4(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To8(Weights<8> *dst, const int *src_indices, const float *src_weights, int num);
+
 
 // ------------------------------------------------------------
 // internal (for test)
@@ -86,8 +122,10 @@ void HalfToFloat_ISPC(float *dst, const half *src, size_t num);
 
 void InvertX_Generic(float3 *dst, size_t num);
 void InvertX_ISPC(float3 *dst, size_t num);
+void InvertX_SSE(float3 *dst, size_t num);
 void InvertX_Generic(float4 *dst, size_t num);
 void InvertX_ISPC(float4 *dst, size_t num);
+void InvertX_SSE(float4 *dst, size_t num);
 
 void Scale_Generic(float *dst, float s, size_t num);
 void Scale_Generic(float3 *dst, float s, size_t num);
@@ -96,22 +134,28 @@ void Scale_ISPC(float3 *dst, float s, size_t num);
 
 void Normalize_Generic(float3 *dst, size_t num);
 void Normalize_ISPC(float3 *dst, size_t num);
+void Normalize_SSE(float3 *dst, size_t num);
 
 void Lerp_Generic(float *dst, const float *src1, const float *src2, size_t num, float w);
 void Lerp_ISPC(float *dst, const float *src1, const float *src2, size_t num, float w);
 
 void MinMax_Generic(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
 void MinMax_ISPC(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
+void MinMax_SSE(const float2 *src, size_t num, float2& dst_min, float2& dst_max);
 void MinMax_Generic(const float3 *src, size_t num, float3& dst_min, float3& dst_max);
 void MinMax_ISPC(const float3 *src, size_t num, float3& dst_min, float3& dst_max);
+void MinMax_SSE(const float3 *src, size_t num, float3& dst_min, float3& dst_max);
 
 bool NearEqual_Generic(const float *src1, const float *src2, size_t num, float eps);
 bool NearEqual_ISPC(const float *src1, const float *src2, size_t num, float eps);
+bool NearEqual_SSE(const float *src1, const float *src2, size_t num, float eps);
 
 void MulPoints_Generic(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulPoints_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+void MulPoints_SSE(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulVectors_Generic(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 void MulVectors_ISPC(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
+void MulVectors_SSE(const float4x4& m, const float3 src[], float3 dst[], size_t num_data);
 
 int RayTrianglesIntersectionIndexed_Generic(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance);
 int RayTrianglesIntersectionIndexed_ISPC(float3 pos, float3 dir, const float3 *vertices, const int *indices, int num_triangles, int& tindex, float& distance);
@@ -127,6 +171,11 @@ int RayTrianglesIntersectionSoA_ISPC(float3 pos, float3 dir,
     const float *v2x, const float *v2y, const float *v2z,
     const float *v3x, const float *v3y, const float *v3z,
     int num_triangles, int& tindex, float& distance);
+int RayTrianglesIntersectionSoA_SSE(float3 pos, float3 dir,
+    const float *v1x, const float *v1y, const float *v1z,
+    const float *v2x, const float *v2y, const float *v2z,
+    const float *v3x, const float *v3y, const float *v3z,
+    int num_triangles, int& tindex, float& distance);
 
 bool PolyInside_Generic(const float px[], const float py[], int ngon, const float2 minp, const float2 maxp, const float2 pos);
 bool PolyInside_ISPC(const float px[], const float py[], int ngon, const float2 minp, const float2 maxp, const float2 pos);
@@ -141,6 +190,9 @@ void GenerateNormalsTriangleIndexed_Generic(float3 *dst,
 void GenerateNormalsTriangleIndexed_ISPC(float3 *dst,
     const float3 *vertices, const int *indices,
     int num_triangles, int num_vertices);
+void GenerateNormalsTriangleIndexed_SSE(float3 *dst,
+    const float3 *vertices, const int *indices,
+    int num_triangles, int num_vertices);
 void GenerateNormalsTriangleFlattened_Generic(float3 *dst,
     const float3 *vertices, const int *indices,
     int num_triangles, int num_vertices);
@@ -166,6 +218,9 @@ void GenerateTangentsTriangleIndexed_Generic(float4 *dst,
 void GenerateTangentsTriangleIndexed_ISPC(float4 *dst,
     const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
     int num_triangles, int num_vertices);
+void GenerateTangentsTriangleIndexed_SSE(float4 *dst,
+    const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
+    int num_triangles, int num_vertices);
 void GenerateTangentsTriangleFlattened_Generic(float4 *dst,
     const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
     int num_triangles, int num_vertices);
@@ -191,4 +246,26 @@ void GenerateTangentsTriangleSoA_ISPC(float4 *dst,
     const float3 *normals, const int *indices,
     int num_triangles, int num_vertices);
 
+void SmoothNormalsFan_Generic(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold);
+void SmoothNormalsFan_SSE(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold);
+
+void GenerateHeightmapRow_Generic(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit);
+void GenerateHeightmapRow_SSE(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit);
+void GenerateHeightmapNormalsRow_Generic(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz);
+void GenerateHeightmapNormalsRow_SSE(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz);
+void WidenIndices_Generic(int *dst, const uint16_t *src, int num);
+void WidenIndices_SSE(int *dst, const uint16_t *src, int num);
+void Color32ToFloat4_Generic(float4 *dst, const uint32_t *src, int num);
+void Color32ToFloat4_SSE(float4 *dst, const uint32_t *src, int num);
+void SelectWeights8To4_Generic(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights8To4_SSE(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To4_Generic(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To4_SSE(Weights<4> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To8_Generic(Weights<8> *dst, const int *src_indices, const float *src_weights, int num);
+void SelectWeights16To8_SSE(Weights<8> *dst, const int *src_indices, const float *src_weights, int num);
+
 } // namespace mu
@@ -1,5 +1,9 @@
 #pragma once
 
+// kernels listed here use their ISPC version in ISPC builds. commented out ones use
+// their SSE version if they have one and the _Generic version otherwise, as non-ISPC builds do.
+// enable a kernel only after TestSIMDKernels passes on an ISPC build.
+
 //#define muSIMD_FloatToHalf
 //#define muSIMD_HalfToFloat
 //
@@ -0,0 +1,781 @@
+#include "pch.h"
+#include "muMath.h"
+#include "muSIMD.h"
+#include "muRawVector.h"
+#include "muVertex.h"
+
+#ifdef muEnableSSE
+#include <emmintrin.h>
+
+namespace mu {
+
+// SSE2 versions of hot kernels. used when ISPC is not available, and in ISPC builds for kernels whose ISPC version is disabled.
+// SSE2 is the baseline of x86-64, so no runtime check is needed.
+// kernels process 4 elements at once and leave remainders to the generic versions.
+
+// 4 float3 <-> SoA. memory layout of 4 float3 is [x0 y0 z0 x1] [y1 z1 x2 y2] [z2 x3 y3 z3]
+static inline void LoadSoA(const float3 *src, __m128& x, __m128& y, __m128& z)
+{
+    __m128 a = _mm_loadu_ps((const float*)src + 0);
+    __m128 b = _mm_loadu_ps((const float*)src + 4);
+    __m128 c = _mm_loadu_ps((const float*)src + 8);
+    __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2)); // b2 b3 c1 c2
+    x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 3, 0)), bc, _MM_SHUFFLE(2, 0, 1, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), bc, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static inline void StoreSoA(float3 *dst, __m128 x, __m128 y, __m128 z)
+{
+    __m128 a = _mm_shuffle_ps(_mm_unpacklo_ps(x, y), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+    __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+    _mm_storeu_ps((float*)dst + 0, a);
+    _mm_storeu_ps((float*)dst + 4, b);
+    _mm_storeu_ps((float*)dst + 8, c);
+}
+
+// gather 4 elements by index
+static inline void GatherSoA(const float3 *src, const int *i, __m128& x, __m128& y, __m128& z)
+{
+    const float3& p0 = src[i[0]];
+    const float3& p1 = src[i[1]];
+    const float3& p2 = src[i[2]];
+    const float3& p3 = src[i[3]];
+    x = _mm_setr_ps(p0.x, p1.x, p2.x, p3.x);
+    y = _mm_setr_ps(p0.y, p1.y, p2.y, p3.y);
+    z = _mm_setr_ps(p0.z, p1.z, p2.z, p3.z);
+}
+
+static inline __m128 Dot(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+static inline __m128 Length(__m128 x, __m128 y, __m128 z)
+{
+    return _mm_sqrt_ps(Dot(x, y, z, x, y, z));
+}
+
+static inline void Normalize(__m128& x, __m128& y, __m128& z)
+{
+    __m128 len = Length(x, y, z);
+    x = _mm_div_ps(x, len);
+    y = _mm_div_ps(y, len);
+    z = _mm_div_ps(z, len);
+}
+
+// 12 floats = 4 float3. flip sign bits of x
+static const uint32_t g_invert_x3_masks[12] = {
+    0x80000000, 0, 0, 0x80000000,
+    0, 0, 0x80000000, 0,
+    0, 0x80000000, 0, 0,
+};
+
+void InvertX_SSE(float3 *dst, size_t num)
+{
+    const __m128 m0 = _mm_loadu_ps((const float*)g_invert_x3_masks + 0);
+    const __m128 m1 = _mm_loadu_ps((const float*)g_invert_x3_masks + 4);
+    const __m128 m2 = _mm_loadu_ps((const float*)g_invert_x3_masks + 8);
+
+    size_t num4 = num & ~(size_t)3;
+    for (size_t i = 0; i < num4; i += 4) {
+        float *d = (float*)(dst + i);
+        _mm_storeu_ps(d + 0, _mm_xor_ps(_mm_loadu_ps(d + 0), m0));
+        _mm_storeu_ps(d + 4, _mm_xor_ps(_mm_loadu_ps(d + 4), m1));
+        _mm_storeu_ps(d + 8, _mm_xor_ps(_mm_loadu_ps(d + 8), m2));
+    }
+    InvertX_Generic(dst + num4, num - num4);
+}
+
+void InvertX_SSE(float4 *dst, size_t num)
+{
+    const __m128 m = _mm_castsi128_ps(_mm_setr_epi32((int)0x80000000, 0, 0, 0));
+    for (size_t i = 0; i < num; ++i) {
+        float *d = (float*)(dst + i);
+        _mm_storeu_ps(d, _mm_xor_ps(_mm_loadu_ps(d), m));
+    }
+}
+
+void Normalize_SSE(float3 *dst, size_t num)
+{
+    size_t num4 = num & ~(size_t)3;
+    for (size_t i = 0; i < num4; i += 4) {
+        __m128 x, y, z;
+        LoadSoA(dst + i, x, y, z);
+        Normalize(x, y, z);
+        StoreSoA(dst + i, x, y, z);
+    }
+    Normalize_Generic(dst + num4, num - num4);
+}
+
+void MinMax_SSE(const float2 *src, size_t num, float2& dst_min, float2& dst_max)
+{
+    if (num < 4) {
+        MinMax_Generic(src, num, dst_min, dst_max);
+        return;
+    }
+
+    // 2 float2 per register
+    size_t num2 = num & ~(size_t)1;
+    __m128 rmin = _mm_loadu_ps((const float*)src);
+    __m128 rmax = rmin;
+    for (size_t i = 2; i < num2; i += 2) {
+        __m128 v = _mm_loadu_ps((const float*)(src + i));
+        rmin = _mm_min_ps(rmin, v);
+        rmax = _mm_max_ps(rmax, v);
+    }
+    rmin = _mm_min_ps(rmin, _mm_movehl_ps(rmin, rmin));
+    rmax = _mm_max_ps(rmax, _mm_movehl_ps(rmax, rmax));
+
+    float2 tmin, tmax;
+    _mm_storel_pi((__m64*)&tmin, rmin);
+    _mm_storel_pi((__m64*)&tmax, rmax);
+    for (size_t i = num2; i < num; ++i) {
+        tmin = min(tmin, src[i]);
+        tmax = max(tmax, src[i]);
+    }
+    dst_min = tmin;
+    dst_max = tmax;
+}
+
+void MinMax_SSE(const float3 *src, size_t num, float3& dst_min, float3& dst_max)
+{
+    if (num < 8) {
+        MinMax_Generic(src, num, dst_min, dst_max);
+        return;
+    }
+
+    // 4 float3 per 3 registers. components in lanes are xyzx yzxy zxyz
+    size_t num4 = num & ~(size_t)3;
+    const float *s = (const float*)src;
+    __m128 min0 = _mm_loadu_ps(s + 0), max0 = min0;
+    __m128 min1 = _mm_loadu_ps(s + 4), max1 = min1;
+    __m128 min2 = _mm_loadu_ps(s + 8), max2 = min2;
+    for (size_t i = 4; i < num4; i += 4) {
+        const float *p = (const float*)(src + i);
+        __m128 v0 = _mm_loadu_ps(p + 0);
+        __m128 v1 = _mm_loadu_ps(p + 4);
+        __m128 v2 = _mm_loadu_ps(p + 8);
+        min0 = _mm_min_ps(min0, v0); max0 = _mm_max_ps(max0, v0);
+        min1 = _mm_min_ps(min1, v1); max1 = _mm_max_ps(max1, v1);
+        min2 = _mm_min_ps(min2, v2); max2 = _mm_max_ps(max2, v2);
+    }
+
+    float3 tmin[4], tmax[4];
+    _mm_storeu_ps((float*)tmin + 0, min0); _mm_storeu_ps((float*)tmax + 0, max0);
+    _mm_storeu_ps((float*)tmin + 4, min1); _mm_storeu_ps((float*)tmax + 4, max1);
+    _mm_storeu_ps((float*)tmin + 8, min2); _mm_storeu_ps((float*)tmax + 8, max2);
+    float3 rmin = tmin[0], rmax = tmax[0];
+    for (int i = 1; i < 4; ++i) {
+        rmin = min(rmin, tmin[i]);
+        rmax = max(rmax, tmax[i]);
+    }
+    for (size_t i = num4; i < num; ++i) {
+        rmin = min(rmin, src[i]);
+        rmax = max(rmax, src[i]);
+    }
+    dst_min = rmin;
+    dst_max = rmax;
+}
+
+bool NearEqual_SSE(const float *src1, const float *src2, size_t num, float eps)
+{
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 veps = _mm_set1_ps(eps);
+
+    size_t num4 = num & ~(size_t)3;
+    for (size_t i = 0; i < num4; i += 4) {
+        __m128 d = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(src1 + i), _mm_loadu_ps(src2 + i)), abs_mask);
+        if (_mm_movemask_ps(_mm_cmplt_ps(d, veps)) != 0xf) {
+            return false;
+        }
+    }
+    return NearEqual_Generic(src1 + num4, src2 + num4, num - num4, eps);
+}
+
+template<bool Point>
+static inline void MulImpl(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    const __m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+    const __m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+    const __m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+    const __m128 m30 = _mm_set1_ps(m[3][0]), m31 = _mm_set1_ps(m[3][1]), m32 = _mm_set1_ps(m[3][2]);
+
+    size_t num4 = num_data & ~(size_t)3;
+    for (size_t i = 0; i < num4; i += 4) {
+        __m128 x, y, z;
+        LoadSoA(src + i, x, y, z);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_mul_ps(m20, z));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_mul_ps(m21, z));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_mul_ps(m22, z));
+        if (Point) {
+            rx = _mm_add_ps(rx, m30);
+            ry = _mm_add_ps(ry, m31);
+            rz = _mm_add_ps(rz, m32);
+        }
+        StoreSoA(dst + i, rx, ry, rz);
+    }
+    for (size_t i = num4; i < num_data; ++i) {
+        dst[i] = Point ? mul_p(m, src[i]) : mul_v(m, src[i]);
+    }
+}
+
+void MulPoints_SSE(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    MulImpl<true>(m, src, dst, num_data);
+}
+
+void MulVectors_SSE(const float4x4& m, const float3 src[], float3 dst[], size_t num_data)
+{
+    MulImpl<false>(m, src, dst, num_data);
+}
+
+// 4 triangles at once. same operations as ray_triangle_intersection(), and the nearest hit is
+// the first one of the minimum distance as in the generic version.
+int RayTrianglesIntersectionSoA_SSE(float3 pos, float3 dir,
+    const float *v1x, const float *v1y, const float *v1z,
+    const float *v2x, const float *v2y, const float *v2z,
+    const float *v3x, const float *v3y, const float *v3z,
+    int num_triangles, int& tindex, float& distance)
+{
+    const __m128 epsdet = _mm_set1_ps(1e-10f);
+    const __m128 umin = _mm_set1_ps(-1e-4f);
+    const __m128 umax = _mm_set1_ps(1.0f + 1e-4f);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 px = _mm_set1_ps(pos.x), py = _mm_set1_ps(pos.y), pz = _mm_set1_ps(pos.z);
+    const __m128 dx = _mm_set1_ps(dir.x), dy = _mm_set1_ps(dir.y), dz = _mm_set1_ps(dir.z);
+
+    __m128 best_d = _mm_set1_ps(FLT_MAX);
+    __m128i best_i = _mm_set1_epi32(-1);
+    __m128i hits = _mm_setzero_si128();
+    __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+    int num_triangles4 = num_triangles & ~3;
+    for (int ti = 0; ti < num_triangles4; ti += 4) {
+        __m128 ax = _mm_loadu_ps(v1x + ti), ay = _mm_loadu_ps(v1y + ti), az = _mm_loadu_ps(v1z + ti);
+        __m128 e1x = _mm_sub_ps(_mm_loadu_ps(v2x + ti), ax);
+        __m128 e1y = _mm_sub_ps(_mm_loadu_ps(v2y + ti), ay);
+        __m128 e1z = _mm_sub_ps(_mm_loadu_ps(v2z + ti), az);
+        __m128 e2x = _mm_sub_ps(_mm_loadu_ps(v3x + ti), ax);
+        __m128 e2y = _mm_sub_ps(_mm_loadu_ps(v3y + ti), ay);
+        __m128 e2z = _mm_sub_ps(_mm_loadu_ps(v3z + ti), az);
+
+        // p = cross(dir, e2), q = cross(t, e1)
+        __m128 qpx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 qpy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 qpz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = Dot(e1x, e1y, e1z, qpx, qpy, qpz);
+        __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        __m128 tx = _mm_sub_ps(px, ax), ty = _mm_sub_ps(py, ay), tz = _mm_sub_ps(pz, az);
+        __m128 u = _mm_mul_ps(Dot(tx, ty, tz, qpx, qpy, qpz), inv_det);
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+        __m128 v = _mm_mul_ps(Dot(dx, dy, dz, qx, qy, qz), inv_det);
+        __m128 d = _mm_mul_ps(Dot(e2x, e2y, e2z, qx, qy, qz), inv_det);
+
+        __m128 hit = _mm_cmpge_ps(_mm_and_ps(det, abs_mask), epsdet);
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, umin), _mm_cmple_ps(u, umax)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, umin), _mm_cmple_ps(_mm_add_ps(u, v), umax)));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(d, _mm_setzero_ps()));
+        hits = _mm_sub_epi32(hits, _mm_castps_si128(hit));
+
+        __m128 closer = _mm_and_ps(hit, _mm_cmplt_ps(d, best_d));
+        __m128i closer_i = _mm_castps_si128(closer);
+        best_d = _mm_or_ps(_mm_and_ps(closer, d), _mm_andnot_ps(closer, best_d));
+        __m128i idx = _mm_add_epi32(lanes, _mm_set1_epi32(ti));
+        best_i = _mm_or_si128(_mm_and_si128(closer_i, idx), _mm_andnot_si128(closer_i, best_i));
+    }
+
+    float bd[4];
+    int bi[4], nh[4];
+    _mm_storeu_ps(bd, best_d);
+    _mm_storeu_si128((__m128i*)bi, best_i);
+    _mm_storeu_si128((__m128i*)nh, hits);
+
+    int num_hits = nh[0] + nh[1] + nh[2] + nh[3];
+    distance = FLT_MAX;
+    int best = -1;
+    for (int k = 0; k < 4; ++k) {
+        if (bi[k] >= 0 && (best < 0 || bd[k] < bd[best] || (bd[k] == bd[best] && bi[k] < bi[best]))) {
+            best = k;
+        }
+    }
+    if (best >= 0) {
+        distance = bd[best];
+        tindex = bi[best];
+    }
+
+    for (int ti = num_triangles4; ti < num_triangles; ++ti) {
+        float d;
+        if (ray_triangle_intersection(pos, dir,
+            { v1x[ti], v1y[ti], v1z[ti] },
+            { v2x[ti], v2y[ti], v2z[ti] },
+            { v3x[ti], v3y[ti], v3z[ti] }, d))
+        {
+            ++num_hits;
+            if (d < distance) {
+                distance = d;
+                tindex = ti;
+            }
+        }
+    }
+    return num_hits;
+}
+
+void GenerateNormalsTriangleIndexed_SSE(float3 *dst,
+    const float3 *vertices, const int *indices, int num_triangles, int num_vertices)
+{
+    memset(dst, 0, sizeof(float3)*num_vertices);
+
+    // compute face normals of 4 triangles at once. accumulation is done in triangle order
+    // to give the same result as the generic version.
+    int num_triangles4 = num_triangles & ~3;
+    int i0[4], i1[4], i2[4];
+    float3 n[4];
+    for (int ti = 0; ti < num_triangles4; ti += 4) {
+        for (int i = 0; i < 4; ++i) {
+            const int *idx = indices + (ti + i) * 3;
+            i0[i] = idx[0]; i1[i] = idx[1]; i2[i] = idx[2];
+        }
+        __m128 p0x, p0y, p0z, p1x, p1y, p1z, p2x, p2y, p2z;
+        GatherSoA(vertices, i0, p0x, p0y, p0z);
+        GatherSoA(vertices, i1, p1x, p1y, p1z);
+        GatherSoA(vertices, i2, p2x, p2y, p2z);
+
+        __m128 ax = _mm_sub_ps(p1x, p0x), ay = _mm_sub_ps(p1y, p0y), az = _mm_sub_ps(p1z, p0z);
+        __m128 bx = _mm_sub_ps(p2x, p0x), by = _mm_sub_ps(p2y, p0y), bz = _mm_sub_ps(p2z, p0z);
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+        StoreSoA(n, nx, ny, nz);
+
+        for (int i = 0; i < 4; ++i) {
+            dst[i0[i]] += n[i];
+            dst[i1[i]] += n[i];
+            dst[i2[i]] += n[i];
+        }
+    }
+    for (int ti = num_triangles4; ti < num_triangles; ++ti) {
+        int ti3 = ti * 3;
+        float3 p0 = vertices[indices[ti3 + 0]];
+        float3 p1 = vertices[indices[ti3 + 1]];
+        float3 p2 = vertices[indices[ti3 + 2]];
+        float3 fn = cross(p1 - p0, p2 - p0);
+        for (int i = 0; i < 3; ++i) {
+            dst[indices[ti3 + i]] += fn;
+        }
+    }
+    Normalize_SSE(dst, num_vertices);
+}
+
+// angle between (p1 - center) and (p2 - center). acos is done in scalar
+static inline void AngleBetween(float(&dst)[4],
+    __m128 p1x, __m128 p1y, __m128 p1z,
+    __m128 p2x, __m128 p2y, __m128 p2z,
+    __m128 cx, __m128 cy, __m128 cz)
+{
+    __m128 ax = _mm_sub_ps(p1x, cx), ay = _mm_sub_ps(p1y, cy), az = _mm_sub_ps(p1z, cz);
+    __m128 bx = _mm_sub_ps(p2x, cx), by = _mm_sub_ps(p2y, cy), bz = _mm_sub_ps(p2z, cz);
+    Normalize(ax, ay, az);
+    Normalize(bx, by, bz);
+    __m128 d = Dot(ax, ay, az, bx, by, bz);
+    d = _mm_min_ps(_mm_max_ps(d, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    _mm_storeu_ps(dst, d);
+    for (auto& v : dst) { v = std::acos(v); }
+}
+
+void GenerateTangentsTriangleIndexed_SSE(float4 *dst,
+    const float3 *vertices, const float2 *uv, const float3 *normals, const int *indices,
+    int num_triangles, int num_vertices)
+{
+    RawVector<float3> tangents, binormals;
+    tangents.resize_zeroclear(num_vertices);
+    binormals.resize_zeroclear(num_vertices);
+
+    int num_triangles4 = num_triangles & ~3;
+    int idx[3][4];
+    for (int ti = 0; ti < num_triangles4; ti += 4) {
+        for (int i = 0; i < 4; ++i) {
+            const int *src = indices + (ti + i) * 3;
+            idx[0][i] = src[0]; idx[1][i] = src[1]; idx[2][i] = src[2];
+        }
+        __m128 vx[3], vy[3], vz[3], ux[3], uy[3];
+        for (int c = 0; c < 3; ++c) {
+            GatherSoA(vertices, idx[c], vx[c], vy[c], vz[c]);
+            const int *i = idx[c];
+            ux[c] = _mm_setr_ps(uv[i[0]].x, uv[i[1]].x, uv[i[2]].x, uv[i[3]].x);
+            uy[c] = _mm_setr_ps(uv[i[0]].y, uv[i[1]].y, uv[i[2]].y, uv[i[3]].y);
+        }
+
+        // same math as compute_triangle_tangent()
+        __m128 px = _mm_sub_ps(vx[1], vx[0]), py = _mm_sub_ps(vy[1], vy[0]), pz = _mm_sub_ps(vz[1], vz[0]);
+        __m128 qx = _mm_sub_ps(vx[2], vx[0]), qy = _mm_sub_ps(vy[2], vy[0]), qz = _mm_sub_ps(vz[2], vz[0]);
+        __m128 sx = _mm_sub_ps(ux[1], ux[0]), sy = _mm_sub_ps(ux[2], ux[0]);
+        __m128 tx = _mm_sub_ps(uy[1], uy[0]), ty = _mm_sub_ps(uy[2], uy[0]);
+
+        __m128 div = _mm_sub_ps(_mm_mul_ps(sx, ty), _mm_mul_ps(sy, tx));
+        __m128 area = _mm_and_ps(div, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+        __m128 rdiv = _mm_div_ps(_mm_set1_ps(1.0f), div);
+        sx = _mm_mul_ps(sx, rdiv); sy = _mm_mul_ps(sy, rdiv);
+        tx = _mm_mul_ps(tx, rdiv); ty = _mm_mul_ps(ty, rdiv);
+
+        __m128 tanx = _mm_sub_ps(_mm_mul_ps(ty, px), _mm_mul_ps(tx, qx));
+        __m128 tany = _mm_sub_ps(_mm_mul_ps(ty, py), _mm_mul_ps(tx, qy));
+        __m128 tanz = _mm_sub_ps(_mm_mul_ps(ty, pz), _mm_mul_ps(tx, qz));
+        Normalize(tanx, tany, tanz);
+        tanx = _mm_mul_ps(tanx, area); tany = _mm_mul_ps(tany, area); tanz = _mm_mul_ps(tanz, area);
+
+        __m128 binx = _mm_sub_ps(_mm_mul_ps(sx, qx), _mm_mul_ps(sy, px));
+        __m128 biny = _mm_sub_ps(_mm_mul_ps(sx, qy), _mm_mul_ps(sy, py));
+        __m128 binz = _mm_sub_ps(_mm_mul_ps(sx, qz), _mm_mul_ps(sy, pz));
+        Normalize(binx, biny, binz);
+        binx = _mm_mul_ps(binx, area); biny = _mm_mul_ps(biny, area); binz = _mm_mul_ps(binz, area);
+
+        float angles[3][4];
+        AngleBetween(angles[0], vx[2], vy[2], vz[2], vx[1], vy[1], vz[1], vx[0], vy[0], vz[0]);
+        AngleBetween(angles[1], vx[0], vy[0], vz[0], vx[2], vy[2], vz[2], vx[1], vy[1], vz[1]);
+        AngleBetween(angles[2], vx[1], vy[1], vz[1], vx[0], vy[0], vz[0], vx[2], vy[2], vz[2]);
+
+        float3 t[4], b[4];
+        StoreSoA(t, tanx, tany, tanz);
+        StoreSoA(b, binx, biny, binz);
+        for (int i = 0; i < 4; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                int vi = idx[c][i];
+                tangents[vi] += t[i] * angles[c][i];
+                binormals[vi] += b[i] * angles[c][i];
+            }
+        }
+    }
+    for (int ti = num_triangles4; ti < num_triangles; ++ti) {
+        int ti3 = ti * 3;
+        int tidx[] = { indices[ti3 + 0], indices[ti3 + 1], indices[ti3 + 2] };
+        float3 v[3] = { vertices[tidx[0]], vertices[tidx[1]], vertices[tidx[2]] };
+        float2 u[3] = { uv[tidx[0]], uv[tidx[1]], uv[tidx[2]] };
+        float3 t[3];
+        float3 b[3];
+        compute_triangle_tangent(v, u, t, b);
+
+        for (int i = 0; i < 3; ++i) {
+            tangents[tidx[i]] += t[i];
+            binormals[tidx[i]] += b[i];
+        }
+    }
+
+    // same math as orthogonalize_tangent()
+    int num_vertices4 = num_vertices & ~3;
+    for (int vi = 0; vi < num_vertices4; vi += 4) {
+        __m128 tx, ty, tz, bx, by, bz, nx, ny, nz;
+        LoadSoA(&tangents[vi], tx, ty, tz);
+        LoadSoA(&binormals[vi], bx, by, bz);
+        LoadSoA(normals + vi, nx, ny, nz);
+
+        __m128 NdotT = Dot(nx, ny, nz, tx, ty, tz);
+        tx = _mm_sub_ps(tx, _mm_mul_ps(nx, NdotT));
+        ty = _mm_sub_ps(ty, _mm_mul_ps(ny, NdotT));
+        tz = _mm_sub_ps(tz, _mm_mul_ps(nz, NdotT));
+        __m128 magT = Length(tx, ty, tz);
+        tx = _mm_div_ps(tx, magT); ty = _mm_div_ps(ty, magT); tz = _mm_div_ps(tz, magT);
+
+        __m128 NdotB = Dot(nx, ny, nz, bx, by, bz);
+        __m128 TdotB = _mm_mul_ps(Dot(tx, ty, tz, bx, by, bz), magT);
+        bx = _mm_sub_ps(bx, _mm_sub_ps(_mm_mul_ps(nx, NdotB), _mm_mul_ps(tx, TdotB)));
+        by = _mm_sub_ps(by, _mm_sub_ps(_mm_mul_ps(ny, NdotB), _mm_mul_ps(ty, TdotB)));
+        bz = _mm_sub_ps(bz, _mm_sub_ps(_mm_mul_ps(nz, NdotB), _mm_mul_ps(tz, TdotB)));
+        Normalize(bx, by, bz);
+
+        // handedness: dot(cross(normal, tangent), binormal) > 0 ? 1 : -1
+        __m128 cx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+        __m128 cy = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+        __m128 cz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+        __m128 positive = _mm_cmpgt_ps(Dot(cx, cy, cz, bx, by, bz), _mm_setzero_ps());
+        __m128 w = _mm_or_ps(_mm_and_ps(positive, _mm_set1_ps(1.0f)), _mm_andnot_ps(positive, _mm_set1_ps(-1.0f)));
+
+        _MM_TRANSPOSE4_PS(tx, ty, tz, w);
+        float *d = (float*)(dst + vi);
+        _mm_storeu_ps(d + 0, tx);
+        _mm_storeu_ps(d + 4, ty);
+        _mm_storeu_ps(d + 8, tz);
+        _mm_storeu_ps(d + 12, w);
+    }
+    for (int vi = num_vertices4; vi < num_vertices; ++vi) {
+        dst[vi] = orthogonalize_tangent(tangents[vi], binormals[vi], normals[vi]);
+    }
+}
+
+// 4 faces (i) at once. the sum of each lane is accumulated in the same order as the generic version.
+void SmoothNormalsFan_SSE(float3 *dst, const int *dst_indices,
+    const float *nx, const float *ny, const float *nz, int num, float threshold)
+{
+    const __m128 th = _mm_set1_ps(threshold);
+    int num_simd = num & ~3;
+    for (int i = 0; i < num_simd; i += 4) {
+        __m128 x = _mm_loadu_ps(nx + i);
+        __m128 y = _mm_loadu_ps(ny + i);
+        __m128 z = _mm_loadu_ps(nz + i);
+        __m128 rx = _mm_setzero_ps();
+        __m128 ry = _mm_setzero_ps();
+        __m128 rz = _mm_setzero_ps();
+        for (int j = 0; j < num; ++j) {
+            __m128 fx = _mm_set1_ps(nx[j]);
+            __m128 fy = _mm_set1_ps(ny[j]);
+            __m128 fz = _mm_set1_ps(nz[j]);
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, fx), _mm_mul_ps(y, fy)), _mm_mul_ps(z, fz));
+            __m128 mask = _mm_cmpgt_ps(d, th);
+            rx = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(rx, fx)), _mm_andnot_ps(mask, rx));
+            ry = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(ry, fy)), _mm_andnot_ps(mask, ry));
+            rz = _mm_or_ps(_mm_and_ps(mask, _mm_add_ps(rz, fz)), _mm_andnot_ps(mask, rz));
+        }
+
+        float3 r[4];
+        StoreSoA(r, rx, ry, rz);
+        for (int k = 0; k < 4; ++k) {
+            dst[dst_indices[i + k]] = r[k];
+        }
+    }
+    for (int i = num_simd; i < num; ++i) {
+        float3 n = { nx[i], ny[i], nz[i] };
+        float3 r = float3::zero();
+        for (int j = 0; j < num; ++j) {
+            float3 fn = { nx[j], ny[j], nz[j] };
+            if (dot(n, fn) > threshold) {
+                r += fn;
+            }
+        }
+        dst[dst_indices[i]] = r;
+    }
+}
+
+void GenerateHeightmapRow_SSE(float3 *dst_points, float2 *dst_uv, const float *heights, int num, int x, int z, float3 unit, float2 uv_unit)
+{
+    const __m128 ux = _mm_set1_ps(unit.x);
+    const __m128 uy = _mm_set1_ps(unit.y);
+    const __m128 pz = _mm_set1_ps((float)z * unit.z);
+    const __m128 uvx = _mm_set1_ps(uv_unit.x);
+    const __m128 v = _mm_set1_ps((float)z * uv_unit.y);
+    const __m128 step = _mm_set1_ps(4.0f);
+    __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+
+    int num_simd = num & ~3;
+    for (int i = 0; i < num_simd; i += 4) {
+        __m128 h = _mm_loadu_ps(heights + i);
+        StoreSoA(dst_points + i, _mm_mul_ps(xs, ux), _mm_mul_ps(h, uy), pz);
+
+        __m128 u = _mm_mul_ps(xs, uvx);
+        _mm_storeu_ps((float*)(dst_uv + i) + 0, _mm_unpacklo_ps(u, v));
+        _mm_storeu_ps((float*)(dst_uv + i) + 4, _mm_unpackhi_ps(u, v));
+        xs = _mm_add_ps(xs, step);
+    }
+    for (int i = num_simd; i < num; ++i) {
+        float fx = (float)(x + i);
+        dst_points[i] = { fx * unit.x, heights[i] * unit.y, (float)z * unit.z };
+        dst_uv[i] = { fx * uv_unit.x, (float)z * uv_unit.y };
+    }
+}
+
+// interior of the row in SIMD. both ends (one-sided differences) and remainders in scalar.
+void GenerateHeightmapNormalsRow_SSE(float3 *dst, const float *prev, const float *heights, const float *next,
+    int width, float height_scale, float dx, float dz)
+{
+    if (width < 6) {
+        GenerateHeightmapNormalsRow_Generic(dst, prev, heights, next, width, height_scale, dx, dz);
+        return;
+    }
+
+    // same factors as the _Generic version so that all tiers agree bit for bit
+    const float skx = height_scale / (dx * 2.0f);
+    const float skz = height_scale / dz;
+    const __m128 kx = _mm_set1_ps(skx);
+    const __m128 kz = _mm_set1_ps(skz);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    int end = 1 + ((width - 2) & ~3);
+    for (int x = 1; x < end; x += 4) {
+        __m128 gx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(heights + x + 1), _mm_loadu_ps(heights + x - 1)), kx);
+        __m128 gz = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(next + x), _mm_loadu_ps(prev + x)), kz);
+        __m128 nx = _mm_xor_ps(gx, sign);
+        __m128 ny = one;
+        __m128 nz = _mm_xor_ps(gz, sign);
+        Normalize(nx, ny, nz);
+        StoreSoA(dst + x, nx, ny, nz);
+    }
+
+    {
+        float gx = (heights[1] - heights[0]) * (skx * 2.0f);
+        float gz = (next[0] - prev[0]) * skz;
+        dst[0] = normalize(float3{ -gx, 1.0f, -gz });
+    }
+    for (int x = end; x < width; ++x) {
+        int x0 = x - 1;
+        int x1 = x < width - 1 ? x + 1 : x;
+        float gx = (heights[x1] - heights[x0]) * (x1 - x0 == 2 ? skx : skx * 2.0f);
+        float gz = (next[x] - prev[x]) * skz;
+        dst[x] = normalize(float3{ -gx, 1.0f, -gz });
+    }
+}
+
+void WidenIndices_SSE(int *dst, const uint16_t *src, int num)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int num_simd = num & ~7;
+    for (int i = 0; i < num_simd; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i) + 0, _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128((__m128i*)(dst + i) + 1, _mm_unpackhi_epi16(v, zero));
+    }
+    for (int i = num_simd; i < num; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+// each color becomes one register: bytes are zero extended to 16 then 32 bit.
+void Color32ToFloat4_SSE(float4 *dst, const uint32_t *src, int num)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 s = _mm_set1_ps(1.0f / 255.0f);
+    int num_simd = num & ~3;
+    for (int i = 0; i < num_simd; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        float *d = (float*)(dst + i);
+        _mm_storeu_ps(d + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), s));
+        _mm_storeu_ps(d + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), s));
+        _mm_storeu_ps(d + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), s));
+        _mm_storeu_ps(d + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), s));
+    }
+    if (num_simd < num) {
+        Color32ToFloat4_Generic(dst + num_simd, src + num_simd, num - num_simd);
+    }
+}
+
+// 4 vertices at a time, one per lane. indices are moved along with weights as raw bits.
+static inline void CompareExchange(__m128 *w, __m128 *idx, int a, int b)
+{
+    __m128 wa = w[a], wb = w[b];
+    __m128 x = _mm_and_ps(_mm_xor_ps(idx[a], idx[b]), _mm_cmplt_ps(wa, wb));
+    w[a] = _mm_max_ps(wa, wb);
+    w[b] = _mm_min_ps(wa, wb);
+    idx[a] = _mm_xor_ps(idx[a], x);
+    idx[b] = _mm_xor_ps(idx[b], x);
+}
+
+template<int K> struct WeightsNetworkSSE;
+template<> struct WeightsNetworkSSE<4>
+{
+    static inline void sort(__m128 *w, __m128 *idx)
+    {
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3);
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3);
+        CompareExchange(w, idx, 1, 2);
+    }
+    static inline void merge(__m128 *w, __m128 *idx)
+    {
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3);
+    }
+};
+template<> struct WeightsNetworkSSE<8>
+{
+    static inline void sort(__m128 *w, __m128 *idx)
+    {
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3); CompareExchange(w, idx, 4, 6); CompareExchange(w, idx, 5, 7);
+        CompareExchange(w, idx, 0, 4); CompareExchange(w, idx, 1, 5); CompareExchange(w, idx, 2, 6); CompareExchange(w, idx, 3, 7);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3); CompareExchange(w, idx, 4, 5); CompareExchange(w, idx, 6, 7);
+        CompareExchange(w, idx, 2, 4); CompareExchange(w, idx, 3, 5);
+        CompareExchange(w, idx, 1, 4); CompareExchange(w, idx, 3, 6);
+        CompareExchange(w, idx, 1, 2); CompareExchange(w, idx, 3, 4); CompareExchange(w, idx, 5, 6);
+    }
+    static inline void merge(__m128 *w, __m128 *idx)
+    {
+        CompareExchange(w, idx, 0, 4); CompareExchange(w, idx, 1, 5); CompareExchange(w, idx, 2, 6); CompareExchange(w, idx, 3, 7);
+        CompareExchange(w, idx, 0, 2); CompareExchange(w, idx, 1, 3); CompareExchange(w, idx, 4, 6); CompareExchange(w, idx, 5, 7);
+        CompareExchange(w, idx, 0, 1); CompareExchange(w, idx, 2, 3); CompareExchange(w, idx, 4, 5); CompareExchange(w, idx, 6, 7);
+    }
+};
+
+// returns the number of processed vertices (a multiple of 4)
+template<int M, int K>
+static int SelectWeightsSSE(Weights<K> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    int num_simd = num & ~3;
+    for (int vi = 0; vi < num_simd; vi += 4) {
+        // transpose 4x4 blocks so that w[i] has the i-th weight of 4 vertices
+        __m128 w[M], idx[M];
+        for (int c = 0; c < M; c += 4) {
+            const float *sw = src_weights + M * vi + c;
+            const float *si = (const float*)src_indices + M * vi + c;
+            __m128 w0 = _mm_loadu_ps(sw), w1 = _mm_loadu_ps(sw + M), w2 = _mm_loadu_ps(sw + M * 2), w3 = _mm_loadu_ps(sw + M * 3);
+            __m128 i0 = _mm_loadu_ps(si), i1 = _mm_loadu_ps(si + M), i2 = _mm_loadu_ps(si + M * 2), i3 = _mm_loadu_ps(si + M * 3);
+            _MM_TRANSPOSE4_PS(w0, w1, w2, w3);
+            _MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+            w[c + 0] = w0; w[c + 1] = w1; w[c + 2] = w2; w[c + 3] = w3;
+            idx[c + 0] = i0; idx[c + 1] = i1; idx[c + 2] = i2; idx[c + 3] = i3;
+        }
+
+        for (int bi = 0; bi < M; bi += K) {
+            WeightsNetworkSSE<K>::sort(w + bi, idx + bi);
+        }
+        for (int step = K; step < M; step *= 2) {
+            for (int bi = 0; bi < M; bi += step * 2) {
+                for (int i = 0; i < K; ++i) {
+                    int a = bi + i, b = bi + step + K - 1 - i;
+                    __m128 m = _mm_cmplt_ps(w[a], w[b]);
+                    w[a] = _mm_max_ps(w[a], w[b]);
+                    idx[a] = _mm_or_ps(_mm_and_ps(m, idx[b]), _mm_andnot_ps(m, idx[a]));
+                }
+                WeightsNetworkSSE<K>::merge(w + bi, idx + bi);
+            }
+        }
+
+        __m128 total = w[0];
+        for (int i = 1; i < K; ++i) { total = _mm_add_ps(total, w[i]); }
+        __m128 rcp_total = _mm_and_ps(_mm_div_ps(one, total), _mm_cmpgt_ps(total, zero));
+        for (int c = 0; c < K; c += 4) {
+            __m128 w0 = _mm_mul_ps(w[c + 0], rcp_total), w1 = _mm_mul_ps(w[c + 1], rcp_total);
+            __m128 w2 = _mm_mul_ps(w[c + 2], rcp_total), w3 = _mm_mul_ps(w[c + 3], rcp_total);
+            __m128 i0 = idx[c + 0], i1 = idx[c + 1], i2 = idx[c + 2], i3 = idx[c + 3];
+            _MM_TRANSPOSE4_PS(w0, w1, w2, w3);
+            _MM_TRANSPOSE4_PS(i0, i1, i2, i3);
+            _mm_storeu_ps(dst[vi + 0].weights + c, w0);
+            _mm_storeu_ps(dst[vi + 1].weights + c, w1);
+            _mm_storeu_ps(dst[vi + 2].weights + c, w2);
+            _mm_storeu_ps(dst[vi + 3].weights + c, w3);
+            _mm_storeu_ps((float*)dst[vi + 0].indices + c, i0);
+            _mm_storeu_ps((float*)dst[vi + 1].indices + c, i1);
+            _mm_storeu_ps((float*)dst[vi + 2].indices + c, i2);
+            _mm_storeu_ps((float*)dst[vi + 3].indices + c, i3);
+        }
+    }
+    return num_simd;
+}
+
+void SelectWeights8To4_SSE(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    int num_simd = SelectWeightsSSE<8, 4>(dst, src_indices, src_weights, num);
+    if (num_simd < num) {
+        SelectWeights8To4_Generic(dst + num_simd, src_indices + 8 * num_simd, src_weights + 8 * num_simd, num - num_simd);
+    }
+}
+void SelectWeights16To4_SSE(Weights<4> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    int num_simd = SelectWeightsSSE<16, 4>(dst, src_indices, src_weights, num);
+    if (num_simd < num) {
+        SelectWeights16To4_Generic(dst + num_simd, src_indices + 16 * num_simd, src_weights + 16 * num_simd, num - num_simd);
+    }
+}
+void SelectWeights16To8_SSE(Weights<8> *dst, const int *src_indices, const float *src_weights, int num)
+{
+    int num_simd = SelectWeightsSSE<16, 8>(dst, src_indices, src_weights, num);
+    if (num_simd < num) {
+        SelectWeights16To8_Generic(dst + num_simd, src_indices + 16 * num_simd, src_weights + 16 * num_simd, num - num_simd);
+    }
+}
+
+} // namespace mu
+#endif // muEnableSSE
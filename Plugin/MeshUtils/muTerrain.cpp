@@ -0,0 +1,408 @@
+#include "pch.h"
+#include "MeshUtils.h"
+
+namespace mu {
+
+static inline float3 TerrainUnit(int width, int height, float3 size)
+{
+    return float3{ 1.0f / (width - 1), 1.0f, 1.0f / (height - 1) } * size;
+}
+
+static inline float2 TerrainUVUnit(int width, int height)
+{
+    return float2{ 1.0f / (width - 1), 1.0f / (height - 1) };
+}
+
+static inline int TerrainRowGrain(int width)
+{
+    return std::max(1, 16384 / width);
+}
+
+// grid points [x0, x1] of row y. normals need the neighbors of the ends, so they go through tmp.
+// tmp must have x1 - x0 + 3 elements.
+void TerrainMesher::generateRow(int x0, int x1, int y, float3 *dst_points, float3 *dst_normals, float2 *dst_uv, float3 *tmp) const
+{
+    auto unit = TerrainUnit(width, height, size);
+    auto uv_unit = TerrainUVUnit(width, height);
+    auto *src = heights.data();
+
+    int ri = y * width;
+    int num = x1 - x0 + 1;
+    GenerateHeightmapRow(dst_points, dst_uv, src + ri + x0, num, x0, y, unit, uv_unit);
+
+    int prev = std::max(y - 1, 0);
+    int next = std::min(y + 1, height - 1);
+    int nx0 = std::max(x0 - 1, 0);
+    int nx1 = std::min(x1 + 1, width - 1);
+    GenerateHeightmapNormalsRow(tmp,
+        src + prev * width + nx0, src + ri + nx0, src + next * width + nx0,
+        nx1 - nx0 + 1, unit.y, unit.x, unit.z * (next - prev));
+    memcpy(dst_normals, tmp + (x0 - nx0), sizeof(float3) * num);
+}
+
+void TerrainMesher::generateGrid(int x0, int y0, int x1, int y1,
+    float3 *dst_points, float3 *dst_normals, float2 *dst_uv, int *dst_indices, bool quads) const
+{
+    if (width < 2 || height < 2 || x1 <= x0 || y1 <= y0) { return; }
+
+    int rw = x1 - x0 + 1;
+    int rh = y1 - y0 + 1;
+
+    // rows are independent of each other. normals are central differences on the grid,
+    // so no scatter over triangles is needed.
+    parallel_for_blocked(0, rh, TerrainRowGrain(rw), [&](int begin, int end) {
+        RawVector<float3> tmp;
+        tmp.resize(rw + 2);
+        for (int iy = begin; iy < end; ++iy) {
+            int ri = iy * rw;
+            generateRow(x0, x1, y0 + iy, dst_points + ri, dst_normals + ri, dst_uv + ri, tmp.data());
+
+            if (iy < rh - 1 && quads) {
+                int *dst = dst_indices + iy * (rw - 1) * 4;
+                for (int ix = 0; ix < rw - 1; ++ix) {
+                    int i = ri + ix;
+                    dst[0] = i;
+                    dst[1] = i + rw;
+                    dst[2] = i + rw + 1;
+                    dst[3] = i + 1;
+                    dst += 4;
+                }
+            }
+            else if (iy < rh - 1) {
+                int *dst = dst_indices + iy * (rw - 1) * 6;
+                for (int ix = 0; ix < rw - 1; ++ix) {
+                    int i = ri + ix;
+                    dst[0] = i;
+                    dst[1] = i + rw;
+                    dst[2] = i + rw + 1;
+
+                    dst[3] = i;
+                    dst[4] = i + rw + 1;
+                    dst[5] = i + 1;
+                    dst += 6;
+                }
+            }
+        }
+    });
+}
+
+void TerrainMesher::generateGrid(float3 *dst_points, float3 *dst_normals, float2 *dst_uv, int *dst_indices) const
+{
+    generateGrid(0, 0, width - 1, height - 1, dst_points, dst_normals, dst_uv, dst_indices);
+}
+
+int TerrainMesher::getTileSize(int align) const
+{
+    int ts = 1;
+    while (ts * 2 <= MaxTileSize && (width - 1) % (ts * 2) == 0 && (height - 1) % (ts * 2) == 0 && align % (ts * 2) == 0) {
+        ts *= 2;
+    }
+    return ts;
+}
+
+
+// right-triangulated irregular network.
+// every vertex except grid corners of tiles is the midpoint of the hypotenuse of one or two right triangles.
+// vertices are either edge midpoints (axis aligned hypotenuse) or square centers (diagonal hypotenuse) at a scale s:
+//  edge midpoint: hypotenuse length 2s. children are square centers of scale s/2.
+//  square center: square size 2s. children are the 4 edge midpoints of scale s on the edges of the square.
+// the error of a vertex is the max of the exact errors of its triangles and the errors of its children.
+// so the error of a triangle that is not split is below the threshold, and a split on one side of
+// an edge always implies the split on the other side. the result has no cracks.
+struct TerrainRTIN
+{
+    const float *heights;
+    float *errors;
+    int width, height;
+
+    float h(int x, int y) const { return heights[width * y + x]; }
+    float e(int x, int y) const { return errors[width * y + x]; }
+
+    // the diagonal of a square of scale s centered at (x, y) connects the corners whose coordinates / 2s have the same parity.
+    // that matches the splits of the parents, and at the top level (tiles) gives a checkerboard.
+    static bool isMainDiagonal(int x, int y, int s)
+    {
+        return (((x - s) / (s * 2)) & 1) == (((y - s) / (s * 2)) & 1);
+    }
+
+    void build(int tile_size)
+    {
+        for (int s = 1; s < tile_size; s *= 2) {
+            // edge midpoints of scale s, then square centers of scale s that depend on them.
+            // each pass only reads errors of finer scales, so rows are processed in parallel.
+            int num_rows = (height - 1) / s + 1;
+            int grain = std::max(1, 4096 / (width / s + 1));
+            parallel_for_blocked(0, num_rows, grain, [&](int begin, int end) {
+                for (int r = begin; r < end; ++r) { buildEdgeMidpoints(r * s, s); }
+            });
+            parallel_for_blocked(0, num_rows, grain, [&](int begin, int end) {
+                for (int r = begin; r < end; ++r) { buildSquareCenters(r * s, s); }
+            });
+        }
+    }
+
+    static int FloorDiv(int a, int b) { return a / b - ((a % b != 0) && ((a < 0) != (b < 0))); }
+    static int CeilDiv(int a, int b) { return -FloorDiv(-a, b); }
+
+    // max vertical distance between the triangle and the grid points in it.
+    // points are visited row by row within the span that is inside all 3 edges.
+    float triangleError(int ax, int ay, int bx, int by, int cx, int cy) const
+    {
+        int area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+        int sign = area > 0 ? 1 : -1;
+        // edge functions w(x, y) = ex * x + ey * y + ec, >= 0 inside. weight of the opposite vertex.
+        int px[3] = { bx, cx, ax }, py[3] = { by, cy, ay };
+        int qx[3] = { cx, ax, bx }, qy[3] = { cy, ay, by };
+        int ex[3], ey[3], ec[3];
+        for (int i = 0; i < 3; ++i) {
+            ex[i] = -(qy[i] - py[i]) * sign;
+            ey[i] = (qx[i] - px[i]) * sign;
+            ec[i] = -(ex[i] * px[i] + ey[i] * py[i]);
+        }
+        float rcp_area = 1.0f / (float)(area * sign);
+        float ha = h(ax, ay), hb = h(bx, by), hc = h(cx, cy);
+        // the plane as a function of x in each row: d(x) = d_y + dx * x
+        float dx = (ha * ex[0] + hb * ex[1] + hc * ex[2]) * rcp_area;
+
+        int x_min = std::min(ax, std::min(bx, cx)), x_max = std::max(ax, std::max(bx, cx));
+        int y_min = std::min(ay, std::min(by, cy)), y_max = std::max(ay, std::max(by, cy));
+        float r = 0.0f;
+        for (int y = y_min; y <= y_max; ++y) {
+            int x0 = x_min, x1 = x_max;
+            for (int i = 0; i < 3; ++i) {
+                int c = ey[i] * y + ec[i];
+                if (ex[i] > 0)      { x0 = std::max(x0, CeilDiv(-c, ex[i])); }
+                else if (ex[i] < 0) { x1 = std::min(x1, FloorDiv(c, -ex[i])); }
+                else if (c < 0)     { x1 = x0 - 1; }
+            }
+
+            float d = (ha * (ey[0] * y + ec[0]) + hb * (ey[1] * y + ec[1]) + hc * (ey[2] * y + ec[2])) * rcp_area + dx * x0;
+            const float *row = heights + width * y;
+            for (int x = x0; x <= x1; ++x) {
+                r = std::max(r, std::abs(d - row[x]));
+                d += dx;
+            }
+        }
+        return r;
+    }
+
+    // triangles of scale 1 have no grid points inside other than the midpoints of their edges,
+    // so their exact errors are the interpolation errors of the midpoints.
+    void buildEdgeMidpoints(int y, int s)
+    {
+        int hs = s / 2;
+        if (y % (s * 2) == 0) {
+            // horizontal hypotenuses. right angles are above and below
+            for (int x = s; x < width; x += s * 2) {
+                if (s == 1) {
+                    errors[width * y + x] = std::abs((h(x - 1, y) + h(x + 1, y)) * 0.5f - h(x, y));
+                    continue;
+                }
+                float r = 0.0f;
+                if (y - s >= 0) {
+                    r = std::max(r, triangleError(x - s, y, x + s, y, x, y - s));
+                    if (hs > 0) { r = std::max(r, std::max(e(x - hs, y - hs), e(x + hs, y - hs))); }
+                }
+                if (y + s < height) {
+                    r = std::max(r, triangleError(x - s, y, x + s, y, x, y + s));
+                    if (hs > 0) { r = std::max(r, std::max(e(x - hs, y + hs), e(x + hs, y + hs))); }
+                }
+                errors[width * y + x] = r;
+            }
+        }
+        else {
+            // vertical hypotenuses. right angles are on the left and right
+            for (int x = 0; x < width; x += s * 2) {
+                if (s == 1) {
+                    errors[width * y + x] = std::abs((h(x, y - 1) + h(x, y + 1)) * 0.5f - h(x, y));
+                    continue;
+                }
+                float r = 0.0f;
+                if (x - s >= 0) {
+                    r = std::max(r, triangleError(x, y - s, x, y + s, x - s, y));
+                    if (hs > 0) { r = std::max(r, std::max(e(x - hs, y - hs), e(x - hs, y + hs))); }
+                }
+                if (x + s < width) {
+                    r = std::max(r, triangleError(x, y - s, x, y + s, x + s, y));
+                    if (hs > 0) { r = std::max(r, std::max(e(x + hs, y - hs), e(x + hs, y + hs))); }
+                }
+                errors[width * y + x] = r;
+            }
+        }
+    }
+
+    void buildSquareCenters(int y, int s)
+    {
+        if (y % (s * 2) != s) { return; }
+        for (int x = s; x < width; x += s * 2) {
+            float r;
+            if (s == 1) {
+                r = isMainDiagonal(x, y, s) ?
+                    (h(x - 1, y - 1) + h(x + 1, y + 1)) * 0.5f :
+                    (h(x - 1, y + 1) + h(x + 1, y - 1)) * 0.5f;
+                r = std::abs(r - h(x, y));
+            }
+            else if (isMainDiagonal(x, y, s)) {
+                r = std::max(
+                    triangleError(x - s, y - s, x + s, y + s, x - s, y + s),
+                    triangleError(x - s, y - s, x + s, y + s, x + s, y - s));
+            }
+            else {
+                r = std::max(
+                    triangleError(x - s, y + s, x + s, y - s, x - s, y - s),
+                    triangleError(x - s, y + s, x + s, y - s, x + s, y + s));
+            }
+            r = std::max(r, std::max(e(x - s, y), e(x + s, y)));
+            r = std::max(r, std::max(e(x, y - s), e(x, y + s)));
+            errors[width * y + x] = r;
+        }
+    }
+
+    // a - b: hypotenuse, c: right angle. triangles are emitted with the same winding as generateGrid().
+    void emit(float threshold, int ax, int ay, int bx, int by, int cx, int cy, RawVector<int>& dst) const
+    {
+        int mx = (ax + bx) / 2;
+        int my = (ay + by) / 2;
+        if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && e(mx, my) > threshold) {
+            emit(threshold, cx, cy, ax, ay, mx, my, dst);
+            emit(threshold, bx, by, cx, cy, mx, my, dst);
+        }
+        else {
+            if ((bx - ax) * (cy - ay) - (by - ay) * (cx - ax) > 0) {
+                std::swap(bx, cx);
+                std::swap(by, cy);
+            }
+            dst.push_back(width * ay + ax);
+            dst.push_back(width * by + bx);
+            dst.push_back(width * cy + cx);
+        }
+    }
+
+    void emitTile(float threshold, int x0, int y0, int tile_size, RawVector<int>& dst) const
+    {
+        int x1 = x0 + tile_size;
+        int y1 = y0 + tile_size;
+        int s = tile_size / 2;
+        if (tile_size == 1 || isMainDiagonal(x0 + s, y0 + s, s)) {
+            emit(threshold, x0, y0, x1, y1, x0, y1, dst);
+            emit(threshold, x1, y1, x0, y0, x1, y0, dst);
+        }
+        else {
+            emit(threshold, x0, y1, x1, y0, x0, y0, dst);
+            emit(threshold, x1, y0, x0, y1, x1, y1, dst);
+        }
+    }
+};
+
+void TerrainMesher::buildErrors(int tile_size)
+{
+    m_tile_size = tile_size;
+    m_errors.resize_zeroclear(width * height);
+    if (width < 2 || height < 2) { return; }
+
+    TerrainRTIN rtin;
+    rtin.heights = heights.data();
+    rtin.errors = m_errors.data();
+    rtin.width = width;
+    rtin.height = height;
+    rtin.build(tile_size);
+}
+
+void TerrainMesher::generateAdaptive(float max_error, int x0, int y0, int x1, int y1,
+    RawVector<float3>& dst_points, RawVector<float3>& dst_normals, RawVector<float2>& dst_uv, RawVector<int>& dst_indices) const
+{
+    dst_points.clear();
+    dst_normals.clear();
+    dst_uv.clear();
+    dst_indices.clear();
+    if (width < 2 || height < 2 || x1 <= x0 || y1 <= y0 || m_tile_size == 0) { return; }
+
+    int tile_size = m_tile_size;
+    int rw = x1 - x0 + 1;
+    int rh = y1 - y0 + 1;
+    int tiles_x = (rw - 1) / tile_size;
+    int tiles_y = (rh - 1) / tile_size;
+    int num_tiles = tiles_x * tiles_y;
+
+    TerrainRTIN rtin;
+    rtin.heights = heights.data();
+    rtin.errors = const_cast<float*>(m_errors.data());
+    rtin.width = width;
+    rtin.height = height;
+
+    // triangulate tiles in parallel. indices refer to the whole grid at this point.
+    float unit_y = std::abs(size.y);
+    float threshold = unit_y > 0.0f ? max_error / unit_y : FLT_MAX;
+    std::vector<RawVector<int>> tile_indices(num_tiles);
+    parallel_for(0, num_tiles, [&](int ti) {
+        rtin.emitTile(threshold, x0 + (ti % tiles_x) * tile_size, y0 + (ti / tiles_x) * tile_size, tile_size, tile_indices[ti]);
+    });
+
+    // grid index -> vertex index. vertices keep the order of the grid.
+    RawVector<int> grid2vertex;
+    grid2vertex.resize(rw * rh, -1);
+    for (auto& indices : tile_indices) {
+        for (int& i : indices) {
+            i = rw * (i / width - y0) + (i % width - x0);
+            grid2vertex[i] = 0;
+        }
+    }
+    RawVector<int> row_offsets;
+    row_offsets.resize(rh + 1);
+    int num_vertices = 0;
+    for (int iy = 0; iy < rh; ++iy) {
+        row_offsets[iy] = num_vertices;
+        int *row = grid2vertex.data() + iy * rw;
+        for (int ix = 0; ix < rw; ++ix) {
+            if (row[ix] == 0) { row[ix] = num_vertices++; }
+        }
+    }
+    row_offsets[rh] = num_vertices;
+
+    dst_points.resize(num_vertices);
+    dst_normals.resize(num_vertices);
+    dst_uv.resize(num_vertices);
+    parallel_for_blocked(0, rh, TerrainRowGrain(rw), [&](int begin, int end) {
+        RawVector<float3> points, normals, tmp;
+        RawVector<float2> uv;
+        points.resize(rw);
+        normals.resize(rw);
+        uv.resize(rw);
+        tmp.resize(rw + 2);
+        for (int iy = begin; iy < end; ++iy) {
+            if (row_offsets[iy] == row_offsets[iy + 1]) { continue; }
+
+            generateRow(x0, x1, y0 + iy, points.data(), normals.data(), uv.data(), tmp.data());
+            const int *row = grid2vertex.data() + iy * rw;
+            for (int ix = 0; ix < rw; ++ix) {
+                int vi = row[ix];
+                if (vi >= 0) {
+                    dst_points[vi] = points[ix];
+                    dst_normals[vi] = normals[ix];
+                    dst_uv[vi] = uv[ix];
+                }
+            }
+        }
+    });
+
+    RawVector<int> tile_offsets;
+    tile_offsets.resize(num_tiles + 1);
+    tile_offsets[0] = 0;
+    for (int ti = 0; ti < num_tiles; ++ti) {
+        tile_offsets[ti + 1] = tile_offsets[ti] + (int)tile_indices[ti].size();
+    }
+    dst_indices.resize(tile_offsets[num_tiles]);
+    parallel_for(0, num_tiles, [&](int ti) {
+        int *dst = dst_indices.data() + tile_offsets[ti];
+        for (int i : tile_indices[ti]) { *dst++ = grid2vertex[i]; }
+    });
+}
+
+void TerrainMesher::generateAdaptive(float max_error,
+    RawVector<float3>& dst_points, RawVector<float3>& dst_normals, RawVector<float2>& dst_uv, RawVector<int>& dst_indices)
+{
+    buildErrors(getTileSize());
+    generateAdaptive(max_error, 0, 0, width - 1, height - 1, dst_points, dst_normals, dst_uv, dst_indices);
+}
+
+} // namespace mu
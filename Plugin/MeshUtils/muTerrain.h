@@ -0,0 +1,50 @@
+#pragma once
+
+namespace mu {
+
+// triangle meshes from heightmaps.
+// heights are row major (width x height) and scaled by size.y. x of the grid maps to x and y of the grid maps to z.
+// normals are central differences on the full resolution grid regardless of the triangulation.
+// regions are given by grid coordinates of their corners [x0, x1] x [y0, y1]. neighbor regions share border vertices,
+// and positions and uv of all regions are in the space of the whole terrain.
+class TerrainMesher
+{
+public:
+    static const int MaxTileSize = 128;
+
+    IArray<float> heights;
+    int width = 0;
+    int height = 0;
+    float3 size = float3::one();
+
+    // full resolution grid. dst_points, dst_normals and dst_uv must have (x1 - x0 + 1) * (y1 - y0 + 1) elements
+    // and dst_indices (x1 - x0) * (y1 - y0) * 6, or * 4 if quads is true.
+    // quads have the same winding as the triangle pairs, so no quadification is needed for the grid.
+    void generateGrid(int x0, int y0, int x1, int y1,
+        float3 *dst_points, float3 *dst_normals, float2 *dst_uv, int *dst_indices, bool quads = false) const;
+    void generateGrid(float3 *dst_points, float3 *dst_normals, float2 *dst_uv, int *dst_indices) const;
+
+    // adaptive triangulation (right-triangulated irregular network).
+    // buildErrors() must be called before generateAdaptive() of regions. tile_size must be a result of getTileSize()
+    // and corners of regions must be on multiples of it. regions built with the same errors fit without cracks.
+    // triangles are split until the vertical error is below max_error (in the same unit as size).
+    // each region is processed in tiles in parallel.
+    void buildErrors(int tile_size);
+    void generateAdaptive(float max_error, int x0, int y0, int x1, int y1,
+        RawVector<float3>& dst_points, RawVector<float3>& dst_normals, RawVector<float2>& dst_uv, RawVector<int>& dst_indices) const;
+    // whole grid. errors are built.
+    void generateAdaptive(float max_error,
+        RawVector<float3>& dst_points, RawVector<float3>& dst_normals, RawVector<float2>& dst_uv, RawVector<int>& dst_indices);
+
+    // largest power of two (up to MaxTileSize) that divides width - 1, height - 1 and align (if not 0).
+    // each tile has at least 2 triangles, so heightmaps of 2^n + 1 simplify best.
+    int getTileSize(int align = 0) const;
+
+private:
+    void generateRow(int x0, int x1, int y, float3 *dst_points, float3 *dst_normals, float2 *dst_uv, float3 *tmp) const;
+
+    RawVector<float> m_errors;
+    int m_tile_size = 0;
+};
+
+} // namespace mu
@@ -0,0 +1,215 @@
+#include "pch.h"
+#include "muThreadPool.h"
+
+namespace mu {
+
+// queue of this thread. index of the worker if this is a worker,
+// or of the queue taken by run() if this is another thread in run(). -1 otherwise.
+static thread_local int g_queue_index = -1;
+
+ThreadPool& ThreadPool::getInstance()
+{
+    static ThreadPool s_instance;
+    return s_instance;
+}
+
+ThreadPool::ThreadPool()
+{
+    setNumThreads(0);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (auto& t : m_workers) {
+        t.join();
+    }
+}
+
+static int ToWorkerCount(int n)
+{
+    if (n <= 0) {
+        n = (int)std::thread::hardware_concurrency();
+    }
+    return std::min(std::max(n, 1), ThreadPool::MaxThreads) - 1;
+}
+
+void ThreadPool::setNumThreads(int n)
+{
+    setNumWorkers(ToWorkerCount(n), false);
+}
+
+void ThreadPool::growNumThreads(int n)
+{
+    setNumWorkers(ToWorkerCount(n), true);
+}
+
+void ThreadPool::setNumWorkers(int num_workers, bool grow_only)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (grow_only) {
+            num_workers = std::max<int>(num_workers, m_num_active);
+        }
+        // workers are never destroyed until the pool is. they just sleep if not active.
+        while ((int)m_workers.size() < num_workers) {
+            int wi = (int)m_workers.size();
+            m_workers.emplace_back([this, wi]() { workerProc(wi); });
+        }
+        m_num_workers = std::max<int>(m_num_workers, num_workers);
+        m_num_active = num_workers;
+    }
+    m_cond.notify_all();
+}
+
+int ThreadPool::getNumThreads() const
+{
+    return m_num_active + 1;
+}
+
+void ThreadPool::run(int num_tasks, const std::function<void(int)>& body)
+{
+    if (num_tasks <= 0) { return; }
+
+    // threads other than workers take a queue of their own for the outermost run()
+    int qi = g_queue_index;
+    bool own_queue = false;
+    if (num_tasks > 1 && m_num_active > 0 && qi < 0) {
+        qi = acquireCallerQueue();
+        own_queue = qi >= 0;
+    }
+    if (num_tasks == 1 || m_num_active == 0 || qi < 0) {
+        for (int i = 0; i < num_tasks; ++i) { body(i); }
+        return;
+    }
+    if (own_queue) {
+        g_queue_index = qi;
+    }
+
+    TaskGroup group;
+    group.pending = num_tasks;
+    group.body = &body;
+
+    // push tasks in reverse order so that the owner pops them in order
+    m_num_queued += num_tasks - 1;
+    {
+        auto& queue = m_queues[qi];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        for (int i = num_tasks - 1; i > 0; --i) {
+            queue.tasks.push_back({ &group, i });
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+    }
+    m_cond.notify_all();
+
+    // process the first task on this thread, then help others until all tasks of the group are done.
+    // if there is nothing to help with, sleep until the group is done or new tasks are queued.
+    execute({ &group, 0 });
+    while (group.pending > 0) {
+        Task task;
+        if (pop(qi, task) || steal(qi, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++m_num_waiting;
+        m_cond.wait(lock, [this, &group]() {
+            return group.pending == 0 || m_num_queued > 0;
+        });
+        --m_num_waiting;
+    }
+
+    if (own_queue) {
+        g_queue_index = -1;
+        m_queues[qi].in_use = false;
+    }
+}
+
+void ThreadPool::workerProc(int wi)
+{
+    g_queue_index = wi;
+    for (;;) {
+        Task task;
+        if (wi < m_num_active && (pop(wi, task) || steal(wi, task))) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this, wi]() {
+            return m_stop || (wi < m_num_active && m_num_queued > 0);
+        });
+        if (m_stop) { break; }
+    }
+}
+
+int ThreadPool::acquireCallerQueue()
+{
+    for (int i = 0; i < MaxCallers; ++i) {
+        bool expected = false;
+        if (m_queues[MaxThreads + i].in_use.compare_exchange_strong(expected, true)) {
+            return MaxThreads + i;
+        }
+    }
+    return -1;
+}
+
+bool ThreadPool::pop(int qi, Task& dst)
+{
+    auto& queue = m_queues[qi];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) { return false; }
+
+    dst = queue.tasks.back();
+    queue.tasks.pop_back();
+    --m_num_queued;
+    return true;
+}
+
+bool ThreadPool::steal(int qi, Task& dst)
+{
+    // visit other queues starting from the next one, so that thieves spread out.
+    // positions [0, num_workers) are queues of workers and the rest are queues of other threads.
+    int num_workers = m_num_workers;
+    int num_queues = num_workers + MaxCallers;
+    int self = qi < MaxThreads ? qi : num_workers + (qi - MaxThreads);
+    for (int i = 1; i < num_queues; ++i) {
+        int pos = (self + i) % num_queues;
+        bool caller = pos >= num_workers;
+        auto& queue = m_queues[caller ? MaxThreads + (pos - num_workers) : pos];
+        if (caller && !queue.in_use) { continue; }
+
+        std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || queue.tasks.empty()) { continue; }
+
+        dst = queue.tasks.front();
+        queue.tasks.pop_front();
+        --m_num_queued;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::execute(const Task& task)
+{
+    auto& group = *task.group;
+    (*group.body)(task.index);
+
+    // wake up the thread waiting for the group if this was the last task.
+    // group may be destroyed by that thread as soon as pending reaches 0.
+    if (--group.pending == 0 && m_num_waiting > 0) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+        }
+        m_cond.notify_all();
+    }
+}
+
+} // namespace mu
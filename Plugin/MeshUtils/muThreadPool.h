@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace mu {
+
+// work-stealing thread pool. muConcurrency uses this if neither PPL nor TBB is available.
+// each worker has its own deque. owner pops from the back and others steal from the front.
+class ThreadPool
+{
+public:
+    static const int MaxThreads = 64;
+    static const int MaxCallers = 16; // non-worker threads that can be in run() at the same time
+
+    static ThreadPool& getInstance();
+
+    // n: number of threads including the caller of run(). 0: std::thread::hardware_concurrency()
+    // can be called at any time. excess workers go to sleep after finishing their current task.
+    void setNumThreads(int n);
+    // same as setNumThreads() but never reduces the number of threads.
+    // for users of the shared pool that should not undo each other's settings.
+    void growNumThreads(int n);
+    int getNumThreads() const;
+
+    // calls body(i) for i in [0, num_tasks) and waits for all of them.
+    // the caller processes tasks while waiting, so body can call run() recursively.
+    // if more than MaxCallers non-worker threads are in run(), tasks of the excess ones run serially.
+    void run(int num_tasks, const std::function<void(int)>& body);
+
+private:
+    struct TaskGroup
+    {
+        std::atomic_int pending;
+        const std::function<void(int)> *body;
+    };
+    struct Task
+    {
+        TaskGroup *group;
+        int index;
+    };
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic_bool in_use{ false }; // for queues of non-worker threads
+    };
+
+    ThreadPool();
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void setNumWorkers(int num_workers, bool grow_only);
+    void workerProc(int wi);
+    int acquireCallerQueue();
+    bool pop(int qi, Task& dst);
+    bool steal(int qi, Task& dst);
+    void execute(const Task& task);
+
+    // m_queues[MaxThreads + i] are for threads that are not workers
+    WorkQueue m_queues[MaxThreads + MaxCallers];
+    std::vector<std::thread> m_workers;
+    std::atomic_int m_num_workers{ 0 };
+    std::atomic_int m_num_active{ 0 }; // active workers. does not include the caller of run()
+    std::atomic_int m_num_queued{ 0 };
+    std::atomic_int m_num_waiting{ 0 }; // threads in run() waiting for their task group
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+} // namespace mu
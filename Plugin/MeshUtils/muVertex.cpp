@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "muMath.h"
 #include "muVertex.h"
+#include "muIterator.h"
+#include "muConcurrency.h"
+#include <cstddef>
 
 namespace mu {
 
@@ -105,4 +108,87 @@ void Interleave(void *dst, VertexFormat format, size_t num,
     }
 }
 
+VertexLayout GetVertexLayout(VertexFormat format)
+{
+#define Offset(V, M) (int)offsetof(V, M)
+    VertexLayout ret;
+    switch (format) {
+    case VertexFormat::V3N3:
+        ret.points = Offset(vertex_v3n3, p);
+        ret.normals = Offset(vertex_v3n3, n);
+        break;
+    case VertexFormat::V3N3C4:
+        ret.points = Offset(vertex_v3n3c4, p);
+        ret.normals = Offset(vertex_v3n3c4, n);
+        ret.colors = Offset(vertex_v3n3c4, c);
+        break;
+    case VertexFormat::V3N3U2:
+        ret.points = Offset(vertex_v3n3u2, p);
+        ret.normals = Offset(vertex_v3n3u2, n);
+        ret.uvs = Offset(vertex_v3n3u2, u);
+        break;
+    case VertexFormat::V3N3C4U2:
+        ret.points = Offset(vertex_v3n3c4u2, p);
+        ret.normals = Offset(vertex_v3n3c4u2, n);
+        ret.colors = Offset(vertex_v3n3c4u2, c);
+        ret.uvs = Offset(vertex_v3n3c4u2, u);
+        break;
+    case VertexFormat::V3N3U2T4:
+        ret.points = Offset(vertex_v3n3u2t4, p);
+        ret.normals = Offset(vertex_v3n3u2t4, n);
+        ret.uvs = Offset(vertex_v3n3u2t4, u);
+        ret.tangents = Offset(vertex_v3n3u2t4, t);
+        break;
+    case VertexFormat::V3N3C4U2T4:
+        ret.points = Offset(vertex_v3n3c4u2t4, p);
+        ret.normals = Offset(vertex_v3n3c4u2t4, n);
+        ret.colors = Offset(vertex_v3n3c4u2t4, c);
+        ret.uvs = Offset(vertex_v3n3c4u2t4, u);
+        ret.tangents = Offset(vertex_v3n3c4u2t4, t);
+        break;
+    default: break;
+    }
+#undef Offset
+    return ret;
+}
+
+// 16KB of vertices of the largest format. a block stays in L1 while its attributes are copied one by one.
+static const int DeinterleaveBlockSize = 256;
+
+template<class T>
+static inline void CopyStrided(T *dst, stride_iterator<const T> src, int num)
+{
+    for (int i = 0; i < num; ++i) {
+        dst[i] = src[i];
+    }
+}
+
+void Deinterleave(const void *src, VertexFormat format, size_t stride, size_t num,
+    float3 *points,
+    float3 *normals,
+    float4 *colors,
+    float2 *uvs,
+    float4 *tangents
+)
+{
+    auto layout = GetVertexLayout(format);
+    if (!src || layout.points < 0) { return; }
+    if (stride == 0) { stride = GetVertexSize(format); }
+
+    if (layout.colors < 0) { colors = nullptr; }
+    if (layout.uvs < 0) { uvs = nullptr; }
+    if (layout.tangents < 0) { tangents = nullptr; }
+
+    auto base = (const uint8_t*)src;
+    parallel_for_blocked(0, (int)num, DeinterleaveBlockSize, [&](int begin, int end) {
+        auto block = base + stride * begin;
+        int n = end - begin;
+        if (points) { CopyStrided(points + begin, stride_iterator<const float3>{ block + layout.points, stride }, n); }
+        if (normals) { CopyStrided(normals + begin, stride_iterator<const float3>{ block + layout.normals, stride }, n); }
+        if (colors) { CopyStrided(colors + begin, stride_iterator<const float4>{ block + layout.colors, stride }, n); }
+        if (uvs) { CopyStrided(uvs + begin, stride_iterator<const float2>{ block + layout.uvs, stride }, n); }
+        if (tangents) { CopyStrided(tangents + begin, stride_iterator<const float4>{ block + layout.tangents, stride }, n); }
+    });
+}
+
 } // namespace mu
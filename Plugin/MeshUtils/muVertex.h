@@ -19,6 +19,15 @@ struct Weights
 using Weights4 = Weights<4>;
 using Weights8 = Weights<8>;
 
+template<int N>
+inline bool near_equal(const Weights<N>& a, const Weights<N>& b, float e = muEpsilon)
+{
+    for (int i = 0; i < N; ++i) {
+        if (a.indices[i] != b.indices[i] || std::abs(a.weights[i] - b.weights[i]) > e) { return false; }
+    }
+    return true;
+}
+
 
 // vertex interleave
 
@@ -168,6 +177,28 @@ void Interleave(void *dst, VertexFormat format, size_t num,
     const float4 *tangents
 );
 
+// byte offsets of attributes in a vertex of the format. -1 if the format doesn't have the attribute.
+struct VertexLayout
+{
+    int points = -1;
+    int normals = -1;
+    int colors = -1;
+    int uvs = -1;
+    int tangents = -1;
+};
+VertexLayout GetVertexLayout(VertexFormat format);
+
+// inverse of Interleave(). src is num vertices of format placed every stride bytes (0: GetVertexSize(format)).
+// attributes the format doesn't have or whose destination is null are skipped.
+// vertices are processed in blocks in parallel, and each block is read from memory once.
+void Deinterleave(const void *src, VertexFormat format, size_t stride, size_t num,
+    float3 *points,
+    float3 *normals,
+    float4 *colors,
+    float2 *uvs,
+    float4 *tangents
+);
+
 template<class VertexT> void Interleave_Generic(VertexT *dst, const typename VertexT::source_t& src, size_t num);
 
 } // namespace mu
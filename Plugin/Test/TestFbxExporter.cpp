@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Test.h"
+#include <fstream>
 
 #define fbxeImpl
 #include "FbxExporter/FbxExporter.h"
@@ -247,6 +248,289 @@ void TestFbxExportSkinnedMesh()
 }
 RegisterTestEntry(TestFbxExportSkinnedMesh)
 
+void TestFbxExportSkinnedMeshCSR()
+{
+    fbxe::ExportOptions opt;
+    opt.scale_factor = 2.0f;
+    opt.max_bone_influences = 2;
+
+    auto ctx = fbxeCreateContext(&opt);
+    fbxeCreateScene(ctx, "SkinnedMeshCSRExportTest");
+
+    const int num_bones = 6;
+    fbxe::Node *bones[num_bones];
+    float4x4 bindposes[num_bones];
+
+    for (int i = 0; i < num_bones; ++i) {
+        char name[128];
+        sprintf(name, "Bone%d", i);
+        bones[i] = fbxeCreateNode(ctx, i == 0 ? nullptr : bones[i - 1], name);
+        fbxeSetTRS(ctx, bones[i], { 0.0f, i == 0 ? 0.0f : 1.0f, 0.0f }, quatf::identity(), float3::one());
+
+        bindposes[i] = float4x4::identity();
+        bindposes[i][3].y = -1.0f * i;
+    }
+
+    std::vector<int> counts;
+    std::vector<int> indices;
+    std::vector<float3> points;
+    std::vector<float2> uv;
+    std::vector<Weights4> weights;
+    GenerateCylinderMeshWithSkinning(counts, indices, points, uv, weights, 0.2f, 5.0f, 32, 128, false);
+
+    // non-zero influences only. the number of influences varies per vertex.
+    // the first influence is split into two entries of the same bone, which are merged into one control point.
+    std::vector<int> weight_counts;
+    std::vector<int> bone_indices;
+    std::vector<float> bone_weights;
+    for (auto& w : weights) {
+        int n = 0;
+        for (int i = 0; i < 4; ++i) {
+            if (w.weights[i] > 0.0f) {
+                int pieces = i == 0 ? 2 : 1;
+                for (int pi = 0; pi < pieces; ++pi) {
+                    bone_indices.push_back(w.indices[i]);
+                    bone_weights.push_back(w.weights[i] / pieces);
+                    ++n;
+                }
+            }
+        }
+        weight_counts.push_back(n);
+    }
+
+    auto mesh = fbxeCreateNode(ctx, nullptr, "SkinnedMeshCSR");
+    fbxeAddMesh(ctx, mesh, points.size(), points.data(), nullptr, nullptr, uv.data(), nullptr);
+    fbxeAddMeshSubmesh(ctx, mesh, fbxe::Topology::Quads, indices.size(), indices.data(), -1);
+    fbxeAddMeshSkinCSR(ctx, mesh, weight_counts.data(), bone_indices.data(), bone_weights.data(), num_bones, bones, bindposes);
+
+    fbxeWriteAsync(ctx, "SkinnedMeshCSR_binary.fbx", fbxe::Format::FbxBinary);
+    fbxeReleaseContext(ctx);
+}
+RegisterTestEntry(TestFbxExportSkinnedMeshCSR)
+
+void TestFbxExportLOD()
+{
+    fbxe::ExportOptions opt;
+    opt.lod_levels = 3;
+
+    auto ctx = fbxeCreateContext(&opt);
+    fbxeCreateScene(ctx, "LODExportTest");
+
+    const int num_bones = 6;
+    fbxe::Node *bones[num_bones];
+    float4x4 bindposes[num_bones];
+
+    for (int i = 0; i < num_bones; ++i) {
+        char name[128];
+        sprintf(name, "Bone%d", i);
+        bones[i] = fbxeCreateNode(ctx, i == 0 ? nullptr : bones[i - 1], name);
+        fbxeSetTRS(ctx, bones[i], { 0.0f, i == 0 ? 0.0f : 1.0f, 0.0f }, quatf::identity(), float3::one());
+
+        bindposes[i] = float4x4::identity();
+        bindposes[i][3].y = -1.0f * i;
+    }
+
+    std::vector<int> counts;
+    std::vector<int> indices;
+    std::vector<float3> points;
+    std::vector<float2> uv;
+    std::vector<Weights4> weights;
+    GenerateCylinderMeshWithSkinning(counts, indices, points, uv, weights, 0.2f, 5.0f, 32, 128, false);
+
+    auto mesh = fbxeCreateNode(ctx, nullptr, "LODMesh");
+    fbxeAddMesh(ctx, mesh, points.size(), points.data(), nullptr, nullptr, uv.data(), nullptr);
+    fbxeAddMeshSubmesh(ctx, mesh, fbxe::Topology::Quads, indices.size(), indices.data(), -1);
+    fbxeAddMeshSkin(ctx, mesh, weights.data(), num_bones, bones, bindposes);
+
+    fbxeWriteAsync(ctx, "LODMesh_binary.fbx", fbxe::Format::FbxBinary);
+    fbxeWriteAsync(ctx, "LODMesh_ascii.fbx", fbxe::Format::FbxAscii);
+    fbxeReleaseContext(ctx);
+}
+RegisterTestEntry(TestFbxExportLOD)
+
+void TestFbxExportHiddenTriangles()
+{
+    fbxe::ExportOptions opt;
+    opt.remove_hidden_triangles = 1;
+
+    auto ctx = fbxeCreateContext(&opt);
+    fbxeCreateScene(ctx, "HiddenTrianglesTest");
+
+    // a box inside another box. all faces of the inner one are hidden.
+    const float3 corners[8] = {
+        { -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { -1.0f, 1.0f, -1.0f }, { 1.0f, 1.0f, -1.0f },
+        { -1.0f, -1.0f,  1.0f }, { 1.0f, -1.0f,  1.0f }, { -1.0f, 1.0f,  1.0f }, { 1.0f, 1.0f,  1.0f },
+    };
+    const int quads[24] = { 0,2,3,1, 4,5,7,6, 0,1,5,4, 2,6,7,3, 0,4,6,2, 1,3,7,5 };
+
+    auto outer = fbxeCreateNode(ctx, nullptr, "Outer");
+    fbxeSetTRS(ctx, outer, float3::zero(), quatf::identity(), { 10.0f, 10.0f, 10.0f });
+    fbxeAddMesh(ctx, outer, 8, corners, nullptr, nullptr, nullptr, nullptr);
+    fbxeAddMeshSubmesh(ctx, outer, fbxe::Topology::Quads, 24, quads, -1);
+
+    auto inner = fbxeCreateNode(ctx, nullptr, "Inner");
+    fbxeSetTRS(ctx, inner, { 1.0f, 2.0f, 3.0f }, quatf::identity(), float3::one());
+    fbxeAddMesh(ctx, inner, 8, corners, nullptr, nullptr, nullptr, nullptr);
+    fbxeAddMeshSubmesh(ctx, inner, fbxe::Topology::Quads, 24, quads, -1);
+
+    fbxeWriteAsync(ctx, "HiddenTriangles.fbx", fbxe::Format::FbxAscii);
+    while (!fbxeIsFinished(ctx)) {
+        std::this_thread::yield();
+    }
+    fbxe::ExportStats stats;
+    fbxeGetStats(ctx, &stats);
+    printf("    removed %d / %d triangles\n", stats.num_removed_triangles, stats.num_tested_triangles);
+    fbxeReleaseContext(ctx);
+}
+RegisterTestEntry(TestFbxExportHiddenTriangles)
+
+// counts NaN in an ascii fbx. MSVC and others print them differently ("-nan(ind)", "1.#QNAN", "nan").
+static int CountNaN(const char *path)
+{
+    std::ifstream fin(path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    int ret = 0;
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        if (text.compare(i, 4, "#IND") == 0 || text.compare(i, 5, "#QNAN") == 0) {
+            ++ret;
+        }
+        else if ((text[i] == 'n' || text[i] == 'N') && (text[i + 1] == 'a' || text[i + 1] == 'A') && (text[i + 2] == 'n' || text[i + 2] == 'N')) {
+            char prev = i > 0 ? text[i - 1] : ' ';
+            char next = i + 3 < text.size() ? text[i + 3] : '\n';
+            if (strchr(",:- ", prev) && strchr(",(\r\n", next)) { ++ret; }
+        }
+    }
+    return ret;
+}
+
+void TestFbxExportLineOnlyVertices()
+{
+    fbxe::ExportOptions opt;
+    opt.generate_normals = 1;
+    opt.generate_tangents = 1;
+
+    auto ctx = fbxeCreateContext(&opt);
+    fbxeCreateScene(ctx, "LineOnlyVerticesTest");
+
+    // 0-3: quad, 4-5: used only by a line, 6: unreferenced, 7-9: used only by a degenerate triangle
+    const float3 points[10] = {
+        { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f },
+        { 2.0f, 0.0f, 0.0f }, { 2.0f, 1.0f, 0.0f },
+        { 3.0f, 0.0f, 0.0f },
+        { 4.0f, 0.0f, 0.0f }, { 5.0f, 0.0f, 0.0f }, { 6.0f, 0.0f, 0.0f },
+    };
+    const float2 uv[10] = {
+        { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f },
+        { 0.0f, 0.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.5f, 0.0f }, { 1.0f, 0.0f },
+    };
+    const int quad[4] = { 0, 3, 2, 1 };
+    const int triangles[9] = { 0, 3, 2, 0, 2, 1, 7, 8, 9 };
+    const int degenerate[3] = { 7, 8, 9 };
+    const int line[2] = { 4, 5 };
+
+    // quads and triangles go through GenerateNormalsPoly, triangles only through GenerateNormalsTriangleIndexed
+    auto poly = fbxeCreateNode(ctx, nullptr, "Poly");
+    fbxeAddMesh(ctx, poly, 10, points, nullptr, nullptr, uv, nullptr);
+    fbxeAddMeshSubmesh(ctx, poly, fbxe::Topology::Quads, 4, quad, -1);
+    fbxeAddMeshSubmesh(ctx, poly, fbxe::Topology::Triangles, 3, degenerate, -1);
+    fbxeAddMeshSubmesh(ctx, poly, fbxe::Topology::Lines, 2, line, -1);
+
+    auto tris = fbxeCreateNode(ctx, nullptr, "Triangles");
+    fbxeAddMesh(ctx, tris, 10, points, nullptr, nullptr, uv, nullptr);
+    fbxeAddMeshSubmesh(ctx, tris, fbxe::Topology::Triangles, 9, triangles, -1);
+    fbxeAddMeshSubmesh(ctx, tris, fbxe::Topology::Lines, 2, line, -1);
+
+    fbxeWriteAsync(ctx, "LineOnlyVertices.fbx", fbxe::Format::FbxAscii);
+    while (!fbxeIsFinished(ctx)) {
+        std::this_thread::yield();
+    }
+    fbxeReleaseContext(ctx);
+    printf("    generated normals and tangents: %d NaN\n", CountNaN("LineOnlyVertices.fbx"));
+}
+RegisterTestEntry(TestFbxExportLineOnlyVertices)
+
+void TestFbxExportTerrain()
+{
+    const int resolution = 257;
+    std::vector<float> heightmap(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            float x = float(ix) / float(resolution - 1);
+            float y = float(iy) / float(resolution - 1);
+            // flat in the lower half, waves in the upper half
+            heightmap[resolution * iy + ix] = y < 0.5f ? 0.0f : std::sin(x * 20.0f) * std::cos(y * 15.0f) * 0.5f + 0.5f;
+        }
+    }
+
+    // { max error, tile size }
+    const float2 settings[] = { { 0.0f, 0.0f }, { 0.5f, 0.0f }, { 0.5f, 64.0f }, { 0.5f, 100.0f } };
+    for (auto setting : settings) {
+        fbxe::ExportOptions opt;
+        opt.terrain_max_error = setting.x;
+        opt.terrain_tile_size = (int)setting.y;
+
+        auto ctx = fbxeCreateContext(&opt);
+        fbxeCreateScene(ctx, "TerrainExportTest");
+        auto node = fbxeCreateNode(ctx, nullptr, "Terrain");
+        fbxeAddTerrain(ctx, node, heightmap.data(), resolution, resolution, { 100.0f, 20.0f, 100.0f });
+
+        char path[128];
+        sprintf(path, "Terrain_%g_%d.fbx", opt.terrain_max_error, opt.terrain_tile_size);
+        fbxeWriteAsync(ctx, path, fbxe::Format::FbxBinary);
+        fbxeReleaseContext(ctx);
+    }
+}
+RegisterTestEntry(TestFbxExportTerrain)
+
+void TestFbxExportBatch()
+{
+    fbxe::ExportOptions opt;
+
+    auto ctx = fbxeCreateContext(&opt);
+    fbxeCreateScene(ctx, "BatchExportTest");
+
+    std::vector<int> counts;
+    std::vector<int> indices;
+    std::vector<float3> points;
+    std::vector<float2> uv;
+    GenerateWaveMesh(counts, indices, points, uv, 1.0f, 0.25f, 32, 0.0f, false);
+
+    fbxe::SubmeshDesc submesh;
+    submesh.topology = fbxe::Topology::Quads;
+    submesh.num_indices = (int)indices.size();
+    submesh.indices = indices.data();
+
+    // a grid of meshes under a node without mesh
+    const int num_meshes = 256;
+    std::vector<fbxe::MeshDesc> descs(num_meshes + 1);
+    std::vector<std::string> names(num_meshes + 1);
+    names[0] = "Batch";
+    descs[0].name = names[0].c_str();
+    for (int i = 1; i <= num_meshes; ++i) {
+        char name[128];
+        sprintf(name, "Mesh%d", i);
+        names[i] = name;
+
+        auto& desc = descs[i];
+        desc.name = names[i].c_str();
+        desc.parent = 0;
+        desc.t = { float(i % 16) * 1.5f, 0.0f, float(i / 16) * 1.5f };
+        desc.num_vertices = (int)points.size();
+        desc.points = points.data();
+        desc.uv = uv.data();
+        desc.num_submeshes = 1;
+        desc.submeshes = &submesh;
+    }
+
+    std::vector<fbxe::Node*> nodes(descs.size());
+    int num_nodes = fbxeAddMeshes(ctx, descs.data(), (int)descs.size(), nodes.data());
+    printf("    added %d / %d nodes\n", num_nodes, (int)descs.size());
+
+    fbxeWriteAsync(ctx, "Batch.fbx", fbxe::Format::FbxBinary);
+    fbxeReleaseContext(ctx);
+}
+RegisterTestEntry(TestFbxExportBatch)
+
 
 void TestFbxExportSkinnedMeshSegmented()
 {
@@ -321,4 +605,4 @@ void TestFbxNameConflict()
     fbxeWriteAsync(ctx, "namesanitize_ascii.fbx", fbxe::Format::FbxAscii);
     fbxeReleaseContext(ctx);
 }
-RegisterTestEntry(TestFbxNameConflict)
\ No newline at end of file
+RegisterTestEntry(TestFbxNameConflict)
\ No newline at end of file
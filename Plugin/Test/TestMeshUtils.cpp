@@ -0,0 +1,1181 @@
+#include "pch.h"
+#include "Test.h"
+using namespace mu;
+
+
+void TestHashBuffer()
+{
+    const size_t num = 64 * 1024 * 1024;
+    RawVector<float> data;
+    data.resize_discard(num);
+    for (size_t i = 0; i < num; ++i) {
+        data[i] = std::sin((float)i * 0.001f);
+    }
+
+    auto bench = [&](const char *name, const std::function<uint64_t()>& body) {
+        const int num_try = 8;
+        uint64_t h = 0;
+        auto begin = Now();
+        for (int i = 0; i < num_try; ++i) {
+            h = body();
+        }
+        auto end = Now();
+        float elapsed = NS2MS(end - begin) / num_try;
+        printf("    %s: %.2fms (%.2f GB/s) %016llx\n", name, elapsed,
+            (double)(num * sizeof(float)) / (elapsed * 1000000.0), (unsigned long long)h);
+    };
+    bench("HashBuffer64", [&]() { return HashBuffer64(data.data(), num * sizeof(float)); });
+    bench("HashBuffer128", [&]() { return HashBuffer128(data.data(), num * sizeof(float)).low; });
+    bench("HashFloatBuffer64", [&]() { return HashFloatBuffer64(data.data(), num, 0.0001f); });
+
+    // quantization must absorb -0 and small noise
+    uint64_t h1 = HashFloatBuffer64(data.data(), 1024, 0.01f);
+    data[0] = -0.0f;
+    data[1] += 0.0000001f;
+    uint64_t h2 = HashFloatBuffer64(data.data(), 1024, 0.01f);
+    printf("    quantized: %s\n", h1 == h2 ? "match" : "mismatch");
+}
+RegisterTestEntry(TestHashBuffer)
+
+void TestTriangleBVH()
+{
+    // wavy grid
+    const int res = 256;
+    RawVector<float3> points;
+    RawVector<int> indices;
+    for (int y = 0; y <= res; ++y) {
+        for (int x = 0; x <= res; ++x) {
+            float fx = (float)x / res, fy = (float)y / res;
+            points.push_back({ fx, 0.1f * std::sin(fx * 20.0f) * std::cos(fy * 13.0f), fy });
+        }
+    }
+    for (int y = 0; y < res; ++y) {
+        for (int x = 0; x < res; ++x) {
+            int i = y * (res + 1) + x;
+            int quad[6] = { i, i + res + 1, i + 1, i + 1, i + res + 1, i + res + 2 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    int num_triangles = (int)indices.size() / 3;
+
+    const int num_rays = 1024;
+    RawVector<float3> pos, dir;
+    for (int i = 0; i < num_rays; ++i) {
+        float fx = (float)(i % 32) / 32.0f, fy = (float)(i / 32) / 32.0f;
+        pos.push_back({ fx, 1.0f, fy });
+        dir.push_back({ (fy - 0.5f) * 0.2f, -1.0f, (fx - 0.5f) * 0.2f });
+    }
+
+    auto begin = Now();
+    TriangleBVH bvh;
+    bvh.build(points, indices);
+    auto end = Now();
+    printf("    build: %.2fms (%d triangles, %d nodes)\n", NS2MS(end - begin), num_triangles, (int)bvh.getNodes().size());
+
+    RawVector<int> ref_tindices, tindices;
+    RawVector<float> ref_distances, distances;
+    ref_tindices.resize_discard(num_rays);
+    ref_distances.resize_discard(num_rays);
+    tindices.resize_discard(num_rays);
+    distances.resize_discard(num_rays);
+
+    begin = Now();
+    for (int i = 0; i < num_rays; ++i) {
+        ref_tindices[i] = -1;
+        RayTrianglesIntersectionIndexed(pos[i], dir[i], points.data(), indices.data(), num_triangles, ref_tindices[i], ref_distances[i]);
+    }
+    end = Now();
+    printf("    RayTrianglesIntersectionIndexed: %.2fms\n", NS2MS(end - begin));
+
+    auto check = [&](const char *name, nanosec elapsed) {
+        int num_mismatch = 0;
+        for (int i = 0; i < num_rays; ++i) {
+            if (tindices[i] != ref_tindices[i] && std::abs(distances[i] - ref_distances[i]) > 1e-4f) { ++num_mismatch; }
+        }
+        printf("    %s: %.2fms (%d mismatches)\n", name, NS2MS(elapsed), num_mismatch);
+    };
+
+    begin = Now();
+    for (int i = 0; i < num_rays; ++i) {
+        tindices[i] = -1;
+        bvh.raycast(pos[i], dir[i], tindices[i], distances[i]);
+    }
+    check("TriangleBVH::raycast", Now() - begin);
+
+    begin = Now();
+    bvh.raycast(pos.data(), dir.data(), num_rays, tindices.data(), distances.data(), 8);
+    check("TriangleBVH::raycast (packet 8)", Now() - begin);
+
+    begin = Now();
+    bvh.raycast(pos.data(), dir.data(), num_rays, tindices.data(), distances.data(), 16);
+    check("TriangleBVH::raycast (packet 16)", Now() - begin);
+}
+RegisterTestEntry(TestTriangleBVH)
+
+void TestVertexDeinterleave()
+{
+    const int num = 100000;
+    RawVector<float3> points, normals;
+    RawVector<float2> uv;
+    RawVector<float4> tangents;
+    points.resize_discard(num);
+    normals.resize_discard(num);
+    uv.resize_discard(num);
+    tangents.resize_discard(num);
+    for (int i = 0; i < num; ++i) {
+        float f = (float)i;
+        points[i] = { f, f + 0.1f, f + 0.2f };
+        normals[i] = { -f, -f - 0.1f, -f - 0.2f };
+        uv[i] = { f * 0.5f, f * 0.25f };
+        tangents[i] = { f * 2.0f, f * 3.0f, f * 4.0f, 1.0f };
+    }
+
+    // interleave with padding between vertices
+    auto format = VertexFormat::V3N3U2T4;
+    size_t stride = GetVertexSize(format) + 8;
+    RawVector<uint8_t> vertices, packed;
+    vertices.resize_zeroclear(stride * num);
+    packed.resize_discard(GetVertexSize(format) * num);
+    Interleave(packed.data(), format, num, points.data(), normals.data(), nullptr, uv.data(), tangents.data());
+    for (int i = 0; i < num; ++i) {
+        memcpy(&vertices[stride * i], &packed[GetVertexSize(format) * i], GetVertexSize(format));
+    }
+
+    RawVector<float3> dst_points, dst_normals;
+    RawVector<float2> dst_uv;
+    RawVector<float4> dst_tangents;
+    dst_points.resize_discard(num);
+    dst_normals.resize_discard(num);
+    dst_uv.resize_discard(num);
+    dst_tangents.resize_discard(num);
+
+    auto begin = Now();
+    Deinterleave(vertices.data(), format, stride, num,
+        dst_points.data(), dst_normals.data(), nullptr, dst_uv.data(), dst_tangents.data());
+    auto end = Now();
+
+    int num_mismatch = 0;
+    for (int i = 0; i < num; ++i) {
+        if (dst_points[i] != points[i] || dst_normals[i] != normals[i] || dst_uv[i] != uv[i] || dst_tangents[i] != tangents[i]) {
+            ++num_mismatch;
+        }
+    }
+    printf("    Deinterleave: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+}
+RegisterTestEntry(TestVertexDeinterleave)
+
+void TestQuadify16()
+{
+    // triangulated grid
+    const int resolution = 200;
+    RawVector<float3> points;
+    RawVector<int> indices;
+    points.resize_discard(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            points[resolution * iy + ix] = { (float)ix, std::sin((float)(ix + iy) * 0.1f), (float)iy };
+        }
+    }
+    for (int iy = 0; iy < resolution - 1; ++iy) {
+        for (int ix = 0; ix < resolution - 1; ++ix) {
+            int i = resolution * iy + ix;
+            int tris[6] = { i, i + resolution, i + resolution + 1, i, i + resolution + 1, i + 1 };
+            indices.insert(indices.end(), tris, tris + 6);
+        }
+    }
+
+    RawVector<uint16_t> indices16;
+    indices16.resize_discard(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) { indices16[i] = (uint16_t)indices[i]; }
+
+    RawVector<int> widened;
+    widened.resize_discard(indices16.size());
+    auto begin = Now();
+    WidenIndices(widened.data(), indices16.data(), (int)indices16.size());
+    printf("    WidenIndices: %.2fms (%s)\n", NS2MS(Now() - begin),
+        memcmp(widened.data(), indices.data(), sizeof(int) * indices.size()) == 0 ? "match" : "mismatch");
+
+    RawVector<int> qindices, qcounts, qcounts16;
+    RawVector<uint16_t> qindices16;
+    QuadifyTriangles(points, indices, false, 20.0f, qindices, qcounts);
+    QuadifyTriangles(points, indices16, false, 20.0f, qindices16, qcounts16);
+
+    bool match = qcounts.size() == qcounts16.size() && qindices.size() == qindices16.size() &&
+        memcmp(qcounts.data(), qcounts16.data(), sizeof(int) * qcounts.size()) == 0;
+    for (size_t i = 0; match && i < qindices.size(); ++i) {
+        match = qindices[i] == (int)qindices16[i];
+    }
+    printf("    QuadifyTriangles 16 bit: %d faces (%s)\n", (int)qcounts16.size(), match ? "match" : "mismatch");
+}
+RegisterTestEntry(TestQuadify16)
+
+void TestTerrainQuads()
+{
+    // gentle heightmap. QuadifyTriangles() merges every triangle pair of the grid at the default threshold.
+    const int resolution = 257;
+    RawVector<float> heightmap(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            heightmap[resolution * iy + ix] = (std::sin((float)ix * 0.05f) * std::cos((float)iy * 0.07f) + 1.0f) * 0.5f;
+        }
+    }
+    TerrainMesher mesher;
+    mesher.heights = heightmap;
+    mesher.width = mesher.height = resolution;
+    mesher.size = { 100.0f, 2.0f, 100.0f };
+
+    int num_points = resolution * resolution;
+    int num_cells = (resolution - 1) * (resolution - 1);
+    RawVector<float3> points(num_points), normals(num_points);
+    RawVector<float2> uv(num_points);
+    RawVector<int> indices(num_cells * 6), quads(num_cells * 4);
+    mesher.generateGrid(0, 0, resolution - 1, resolution - 1, points.data(), normals.data(), uv.data(), indices.data());
+    auto begin = Now();
+    mesher.generateGrid(0, 0, resolution - 1, resolution - 1, points.data(), normals.data(), uv.data(), quads.data(), true);
+    auto end = Now();
+
+    RawVector<int> qindices, qcounts;
+    auto qbegin = Now();
+    QuadifyTriangles(points, indices, false, 20.0f, qindices, qcounts);
+    auto qend = Now();
+
+    // native quads must be the same faces as quadified triangles. compare them as sorted lists of rotated-to-min faces.
+    auto normalize_faces = [](const RawVector<int>& src, int count) {
+        std::vector<std::vector<int>> faces;
+        for (size_t i = 0; i + count <= src.size(); i += count) {
+            std::vector<int> f(src.begin() + i, src.begin() + i + count);
+            std::rotate(f.begin(), std::min_element(f.begin(), f.end()), f.end());
+            faces.push_back(f);
+        }
+        std::sort(faces.begin(), faces.end());
+        return faces;
+    };
+    bool all_quads = std::all_of(qcounts.begin(), qcounts.end(), [](int c) { return c == 4; });
+    bool match = all_quads && (int)qcounts.size() == num_cells &&
+        normalize_faces(qindices, 4) == normalize_faces(quads, 4);
+    printf("    TerrainMesher quads: %.2fms, QuadifyTriangles: %.2fms (%d quads, %s)\n",
+        NS2MS(end - begin), NS2MS(qend - qbegin), num_cells, match ? "match" : "mismatch");
+}
+RegisterTestEntry(TestTerrainQuads)
+
+void TestThreadPool()
+{
+    // nested parallel_for. each element must be visited exactly once.
+    {
+        const int num_outer = 64, num_inner = 10000;
+        std::vector<std::atomic_int> visits(num_outer * num_inner);
+        for (auto& v : visits) { v = 0; }
+
+        auto begin = Now();
+        parallel_for(0, num_outer, [&](int oi) {
+            parallel_for(0, num_inner, [&](int ii) {
+                visits[oi * num_inner + ii]++;
+            });
+        });
+        auto end = Now();
+
+        int num_mismatch = 0;
+        for (auto& v : visits) { if (v != 1) { ++num_mismatch; } }
+        printf("    nested parallel_for: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+    }
+
+    // uneven tasks from several threads at once, more than ThreadPool::MaxCallers.
+    // idle threads have to steal the rest of the tasks of a thread busy with a long one.
+    {
+        const int num_callers = 20, num_tasks = 256;
+        std::vector<std::atomic_int> visits(num_callers * num_tasks);
+        for (auto& v : visits) { v = 0; }
+
+        auto begin = Now();
+        std::vector<std::thread> callers;
+        for (int ci = 0; ci < num_callers; ++ci) {
+            callers.emplace_back([&, ci]() {
+                parallel_for(0, num_tasks, 1, [&](int ti) {
+                    if (ti % 64 == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    }
+                    visits[ci * num_tasks + ti]++;
+                });
+            });
+        }
+        for (auto& t : callers) { t.join(); }
+        auto end = Now();
+
+        int num_mismatch = 0;
+        for (auto& v : visits) { if (v != 1) { ++num_mismatch; } }
+        printf("    concurrent parallel_for: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+    }
+
+    // parallel_for_each on non random access iterators
+    {
+        std::map<int, int> values;
+        for (int i = 0; i < 100000; ++i) { values[i] = 0; }
+
+        auto begin = Now();
+        parallel_for_each(values.begin(), values.end(), [](std::pair<const int, int>& kvp) {
+            kvp.second = kvp.first * 2;
+        });
+        auto end = Now();
+
+        int num_mismatch = 0;
+        for (auto& kvp : values) { if (kvp.second != kvp.first * 2) { ++num_mismatch; } }
+        printf("    parallel_for_each: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+    }
+}
+RegisterTestEntry(TestThreadPool)
+
+void TestBuildConnection()
+{
+    // fan of triangles around vertex 0. its list has an entry from every face block.
+    const int num_triangles = 1000000;
+    const int num_vertices = num_triangles + 2;
+    RawVector<float3> points(num_vertices);
+    RawVector<int> counts(num_triangles), offsets(num_triangles), indices(num_triangles * 3);
+    points.zeroclear();
+    for (int ti = 0; ti < num_triangles; ++ti) {
+        counts[ti] = 3;
+        offsets[ti] = ti * 3;
+        indices[ti * 3 + 0] = 0;
+        indices[ti * 3 + 1] = ti + 1;
+        indices[ti * 3 + 2] = ti + 2;
+    }
+
+    ConnectionData connection;
+    auto begin = Now();
+    connection.buildConnection(indices, counts, offsets, points);
+    auto end = Now();
+
+    // serial build. lists are in index order
+    RawVector<int> v2f_counts(num_vertices), v2f_offsets(num_vertices), v2f_faces(indices.size()), v2f_indices(indices.size());
+    v2f_counts.zeroclear();
+    for (int vi : indices) { v2f_counts[vi]++; }
+    for (int vi = 0, sum = 0; vi < num_vertices; ++vi) {
+        v2f_offsets[vi] = sum;
+        sum += v2f_counts[vi];
+    }
+    v2f_counts.zeroclear();
+    for (int ii = 0; ii < (int)indices.size(); ++ii) {
+        int vi = indices[ii];
+        int ti = v2f_offsets[vi] + v2f_counts[vi]++;
+        v2f_faces[ti] = ii / 3;
+        v2f_indices[ti] = ii;
+    }
+
+    bool match =
+        memcmp(connection.v2f_counts.data(), v2f_counts.data(), sizeof(int) * v2f_counts.size()) == 0 &&
+        memcmp(connection.v2f_offsets.data(), v2f_offsets.data(), sizeof(int) * v2f_offsets.size()) == 0 &&
+        memcmp(connection.v2f_faces.data(), v2f_faces.data(), sizeof(int) * v2f_faces.size()) == 0 &&
+        memcmp(connection.v2f_indices.data(), v2f_indices.data(), sizeof(int) * v2f_indices.size()) == 0;
+    printf("    BuildConnection fan: %.2fms (%s)\n", NS2MS(end - begin), match ? "match" : "mismatch");
+}
+RegisterTestEntry(TestBuildConnection)
+
+void TestGenerateNormals()
+{
+    // grid of triangles, quads and hexagons with creases
+    const int resolution = 300;
+    RawVector<float3> points;
+    RawVector<int> counts, offsets, indices;
+    points.resize_discard(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            points[resolution * iy + ix] = { (float)ix, std::abs(std::sin((float)ix * 0.3f)) * 2.0f, (float)iy };
+        }
+    }
+    auto add_face = [&](std::initializer_list<int> face) {
+        offsets.push_back((int)indices.size());
+        counts.push_back((int)face.size());
+        indices.insert(indices.end(), face.begin(), face.end());
+    };
+    for (int iy = 0; iy < resolution - 1; ++iy) {
+        for (int ix = 0; ix < resolution - 1; ++ix) {
+            int i = resolution * iy + ix;
+            int r = resolution;
+            if (ix % 3 == 0) {
+                add_face({ i, i + r, i + r + 1 });
+                add_face({ i, i + r + 1, i + 1 });
+            }
+            else if (ix % 3 == 1 && ix + 2 < resolution) {
+                add_face({ i, i + r, i + r + 1, i + r + 2, i + 2, i + 1 });
+                ++ix;
+            }
+            else {
+                add_face({ i, i + r, i + r + 1, i + 1 });
+            }
+        }
+    }
+    int num_faces = (int)counts.size();
+    int num_points = (int)points.size();
+
+    ConnectionData connection;
+    connection.buildConnection(indices, counts, offsets, points);
+
+    // per-vertex normals: gathering through the connection must match scattering bit for bit
+    for (int flip = 0; flip < 2; ++flip) {
+        RawVector<float3> expected(num_points), actual(num_points);
+        GenerateNormalsPoly(expected, points, counts, offsets, indices, flip != 0, nullptr);
+        auto begin = Now();
+        GenerateNormalsPoly(actual, points, counts, offsets, indices, flip != 0, &connection);
+        auto end = Now();
+
+        int num_mismatches = 0;
+        for (int vi = 0; vi < num_points; ++vi) {
+            if (memcmp(&actual[vi], &expected[vi], sizeof(float3)) != 0) { ++num_mismatches; }
+        }
+        printf("    GenerateNormalsPoly%s: %.2fms (%d faces, %d mismatches)\n",
+            flip ? " flipped" : "", NS2MS(end - begin), num_faces, num_mismatches);
+    }
+
+    // per-corner normals with smooth angle: compare with the scalar loop over connected faces of each corner
+    RawVector<float3> face_normals(num_faces);
+    GenerateFaceNormals(face_normals, points, offsets, indices);
+    Normalize(face_normals.data(), face_normals.size());
+
+    const float smooth_angles[] = { 30.0f, 60.0f, 180.0f };
+    for (float smooth_angle : smooth_angles) {
+        const float angle = std::cos(smooth_angle * Deg2Rad) - 0.001f;
+        RawVector<float3> expected(indices.size());
+        for (int fi = 0; fi < num_faces; ++fi) {
+            int count = counts[fi];
+            int offset = offsets[fi];
+            float3 face_normal = face_normals[fi];
+            for (int ci = 0; ci < count; ++ci) {
+                float3 normal = float3::zero();
+                connection.eachConnectedFaces(indices[offset + ci], [&](int fi2, int) {
+                    float3 n = face_normals[fi2];
+                    if (dot(face_normal, n) > angle) {
+                        normal += n;
+                    }
+                });
+                expected[offset + ci] = normal;
+            }
+        }
+        Normalize(expected.data(), expected.size());
+
+        MeshRefiner refiner;
+        refiner.prepare(counts, indices, points);
+        auto begin = Now();
+        refiner.genNormalsWithSmoothAngle(smooth_angle, false);
+        auto end = Now();
+
+        int num_mismatches = 0;
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (memcmp(&refiner.normals[i], &expected[i], sizeof(float3)) != 0) { ++num_mismatches; }
+        }
+        printf("    genNormalsWithSmoothAngle %.0f: %.2fms (%d mismatches)\n",
+            smooth_angle, NS2MS(end - begin), num_mismatches);
+    }
+}
+RegisterTestEntry(TestGenerateNormals)
+
+void TestMeshRefiner()
+{
+    // quad grid with per-vertex normals, uv1 and weights, and per-index uv and colors with a seam every 16 columns
+    const int resolution = 200;
+    RawVector<float3> points, normals;
+    RawVector<float2> uv, uv1;
+    RawVector<float4> colors;
+    RawVector<Weights4> weights;
+    RawVector<int> counts, indices;
+    points.resize_discard(resolution * resolution);
+    normals.resize_discard(resolution * resolution);
+    uv1.resize_discard(resolution * resolution);
+    weights.resize_discard(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            int vi = resolution * iy + ix;
+            points[vi] = { (float)ix, std::sin((float)(ix + iy) * 0.1f), (float)iy };
+            normals[vi] = normalize(float3{ std::cos((float)ix * 0.1f), 1.0f, 0.0f });
+            uv1[vi] = { (float)ix / resolution, (float)iy / resolution };
+            weights[vi] = {};
+            weights[vi].indices[0] = ix % 4;
+            weights[vi].indices[1] = iy % 4;
+            weights[vi].weights[0] = 0.75f;
+            weights[vi].weights[1] = 0.25f;
+        }
+    }
+    for (int iy = 0; iy < resolution - 1; ++iy) {
+        for (int ix = 0; ix < resolution - 1; ++ix) {
+            int i = resolution * iy + ix;
+            int quad[4] = { i, i + resolution, i + resolution + 1, i + 1 };
+            counts.push_back(4);
+            for (int vi : quad) {
+                int x = vi % resolution, y = vi / resolution;
+                int tile = ix / 16;
+                indices.push_back(vi);
+                uv.push_back({ (float)(x - tile * 16) / 16.0f, (float)y / resolution });
+                colors.push_back({ (float)tile, 0.0f, 0.0f, 1.0f });
+            }
+        }
+    }
+
+    struct Result
+    {
+        RawVector<MeshRefiner::Split> splits;
+        RawVector<float3> points, normals;
+        RawVector<float4> tangents, colors;
+        RawVector<float2> uv, uv1;
+        RawVector<Weights4> weights;
+        RawVector<int> indices;
+    };
+    auto refine = [&](Result& r, bool optimize, int split_unit) {
+        MeshRefiner refiner;
+        refiner.split_unit = split_unit;
+        refiner.prepare(counts, indices, points);
+        refiner.normals = normals;
+        refiner.uv = uv;
+        refiner.uv1 = uv1;
+        refiner.colors = colors;
+        refiner.weights4 = weights;
+        refiner.refine(optimize);
+        refiner.swapNewData(r.points, r.normals, r.tangents, r.uv, r.uv1, r.colors, r.weights, r.indices);
+        r.splits = refiner.splits;
+        if (!optimize) {
+            // refineDumb() leaves attributes that are already per-index in the source arrays
+            r.points.assign(refiner.points.data(), refiner.points.data() + refiner.points.size());
+            r.normals.assign(refiner.normals.data(), refiner.normals.data() + refiner.normals.size());
+            r.uv.assign(refiner.uv.data(), refiner.uv.data() + refiner.uv.size());
+            r.uv1.assign(refiner.uv1.data(), refiner.uv1.data() + refiner.uv1.size());
+            r.colors.assign(refiner.colors.data(), refiner.colors.data() + refiner.colors.size());
+            r.weights.assign(refiner.weights4.data(), refiner.weights4.data() + refiner.weights4.size());
+        }
+    };
+
+    // refineDumb() never splits if split_unit is larger than the mesh, and it flattens all attributes.
+    // so the attributes of each triangulated corner must match the optimized ones.
+    Result expected;
+    refine(expected, false, 0x7fffffff);
+
+    auto check = [&](int split_unit) {
+        Result actual;
+        auto begin = Now();
+        refine(actual, true, split_unit);
+        auto end = Now();
+
+        int num_mismatches = 0;
+        for (auto& split : actual.splits) {
+            int index_end = split.offset_indices_triangulated + split.num_indices_triangulated;
+            for (int i = split.offset_indices_triangulated; i < index_end; ++i) {
+                int a = split.offset_vertices + actual.indices[i];
+                int b = expected.indices[i];
+                if (!(actual.points[a] == expected.points[b]) ||
+                    !(actual.normals[a] == expected.normals[b]) ||
+                    !(actual.uv[a] == expected.uv[b]) ||
+                    !(actual.uv1[a] == expected.uv1[b]) ||
+                    !(actual.colors[a] == expected.colors[b]) ||
+                    memcmp(&actual.weights[a], &expected.weights[b], sizeof(Weights4)) != 0)
+                {
+                    ++num_mismatches;
+                }
+            }
+        }
+        if (actual.indices.size() != expected.indices.size()) { ++num_mismatches; }
+        printf("    MeshRefiner (split_unit %d): %.2fms (%d splits, %d vertices, %d mismatches)\n",
+            split_unit, NS2MS(end - begin), (int)actual.splits.size(), (int)actual.points.size(), num_mismatches);
+    };
+    check(65000);
+    check(3000);
+}
+RegisterTestEntry(TestMeshRefiner)
+
+void TestGenerateTangents()
+{
+    // quad grid. chunking only starts at 2 * 8192 faces, so it has about 40000 faces.
+    const int resolution = 200;
+    RawVector<float3> points, normals;
+    RawVector<float2> uv;
+    RawVector<int> counts, offsets, indices;
+    points.resize_discard(resolution * resolution);
+    uv.resize_discard(resolution * resolution);
+    for (int iy = 0; iy < resolution; ++iy) {
+        for (int ix = 0; ix < resolution; ++ix) {
+            int vi = resolution * iy + ix;
+            points[vi] = { (float)ix, std::sin((float)ix * 0.1f) * std::cos((float)iy * 0.1f), (float)iy };
+            uv[vi] = { (float)ix / resolution, (float)iy / resolution };
+        }
+    }
+    for (int iy = 0; iy < resolution - 1; ++iy) {
+        for (int ix = 0; ix < resolution - 1; ++ix) {
+            int i = resolution * iy + ix;
+            int quad[4] = { i, i + resolution, i + resolution + 1, i + 1 };
+            offsets.push_back((int)indices.size());
+            counts.push_back(4);
+            indices.insert(indices.end(), quad, quad + 4);
+        }
+    }
+
+    auto check = [&](const char *name, float eps) {
+        normals.resize_discard(points.size());
+        GenerateNormalsPoly(normals, points, counts, offsets, indices);
+
+        RawVector<float4> expected(points.size()), actual(points.size());
+        expected.zeroclear();
+        actual.zeroclear();
+        GenerateTangentsPoly(expected, points, normals, uv, counts, offsets, indices, false);
+        auto begin = Now();
+        GenerateTangentsPoly(actual, points, normals, uv, counts, offsets, indices, true);
+        auto end = Now();
+
+        int num_mismatches = 0;
+        for (size_t i = 0; i < points.size(); ++i) {
+            bool match = eps == 0.0f ?
+                memcmp(&actual[i], &expected[i], sizeof(float4)) == 0 :
+                near_equal(actual[i], expected[i], eps);
+            if (!match) { ++num_mismatches; }
+        }
+        printf("    GenerateTangentsPoly %s: %.2fms (%d faces, %d mismatches)\n",
+            name, NS2MS(end - begin), (int)counts.size(), num_mismatches);
+    };
+
+    // manifold. chunked result must be bit-identical.
+    check("manifold", 0.0f);
+
+    // fins on every 7th quad make edges shared by 3 faces. they can be paired differently in chunks.
+    int num_quads = (int)counts.size();
+    for (int fi = 0; fi < num_quads; fi += 7) {
+        int i0 = indices[offsets[fi] + 0];
+        int i1 = indices[offsets[fi] + 1];
+        int vi = (int)points.size();
+        points.push_back((points[i0] + points[i1]) * 0.5f + float3{ 0.0f, 1.0f, 0.0f });
+        uv.push_back((uv[i0] + uv[i1]) * 0.5f);
+        offsets.push_back((int)indices.size());
+        counts.push_back(3);
+        int tri[3] = { i0, i1, vi };
+        indices.insert(indices.end(), tri, tri + 3);
+    }
+    check("non-manifold", 0.01f);
+}
+RegisterTestEntry(TestGenerateTangents)
+
+// average cache miss ratio per triangle in a simulated LRU cache
+static float ComputeACMR(const RawVector<int>& counts, const RawVector<int>& indices, int cache_size)
+{
+    std::vector<int> cache;
+    int num_misses = 0, num_triangles = 0, ii = 0;
+    for (int count : counts) {
+        for (int ci = 0; ci < count; ++ci) {
+            int vi = indices[ii++];
+            auto it = std::find(cache.begin(), cache.end(), vi);
+            if (it == cache.end()) { ++num_misses; }
+            else { cache.erase(it); }
+            cache.insert(cache.begin(), vi);
+            if ((int)cache.size() > cache_size) { cache.pop_back(); }
+        }
+        num_triangles += count - 2;
+    }
+    return (float)num_misses / (float)num_triangles;
+}
+
+void TestOptimizeVertexCache()
+{
+    // grid of quads and triangle pairs. faces are shuffled to make a worst case input.
+    const int div = 256;
+    const int cache_size = 16;
+    const int num_vertices = (div + 1) * (div + 1);
+    std::vector<std::vector<int>> faces;
+    for (int z = 0; z < div; ++z) {
+        for (int x = 0; x < div; ++x) {
+            int i0 = z * (div + 1) + x, i1 = i0 + 1, i2 = i0 + div + 2, i3 = i0 + div + 1;
+            if ((x + z) % 3 == 0) {
+                faces.push_back({ i0, i1, i2, i3 });
+            }
+            else {
+                faces.push_back({ i0, i1, i2 });
+                faces.push_back({ i0, i2, i3 });
+            }
+        }
+    }
+    for (int i = (int)faces.size() - 1; i > 0; --i) {
+        std::swap(faces[i], faces[((uint32_t)i * 2654435761u) % (uint32_t)(i + 1)]);
+    }
+
+    RawVector<int> counts, indices;
+    for (auto& f : faces) {
+        counts.push_back((int)f.size());
+        indices.insert(indices.end(), f.data(), f.data() + f.size());
+    }
+
+    RawVector<int> dst_counts, dst_indices;
+    auto begin = Now();
+    OptimizeVertexCache(counts, indices, num_vertices, cache_size, dst_counts, dst_indices);
+    auto end = Now();
+
+    // faces must be a permutation of the input faces
+    std::vector<std::vector<int>> dst_faces;
+    for (int fi = 0, ii = 0; fi < (int)dst_counts.size(); ii += dst_counts[fi++]) {
+        dst_faces.push_back(std::vector<int>(&dst_indices[ii], &dst_indices[ii] + dst_counts[fi]));
+    }
+    std::vector<std::vector<int>> sorted_faces = faces;
+    std::sort(sorted_faces.begin(), sorted_faces.end());
+    std::sort(dst_faces.begin(), dst_faces.end());
+    bool valid = sorted_faces == dst_faces;
+
+    // new2old must be a permutation of the vertices and remapped indices must refer to the same vertices
+    RawVector<int> remapped = dst_indices, new2old;
+    OptimizeVertexFetch(remapped, num_vertices, new2old);
+    std::vector<int> seen(num_vertices);
+    for (int vi : new2old) { ++seen[vi]; }
+    valid = valid && (int)new2old.size() == num_vertices && std::count(seen.begin(), seen.end(), 1) == num_vertices;
+    for (size_t i = 0; valid && i < remapped.size(); ++i) {
+        valid = new2old[remapped[i]] == dst_indices[i];
+    }
+
+    printf("    OptimizeVertexCache: %.2fms ACMR %.3f -> %.3f (%s)\n", NS2MS(end - begin),
+        ComputeACMR(counts, indices, cache_size), ComputeACMR(dst_counts, dst_indices, cache_size), valid ? "valid" : "invalid");
+}
+RegisterTestEntry(TestOptimizeVertexCache)
+
+void TestColor32ToFloat4()
+{
+    const int num = 1000003;
+    RawVector<uint32_t> src;
+    RawVector<float4> dst;
+    src.resize_discard(num);
+    dst.resize_discard(num);
+    for (int i = 0; i < num; ++i) {
+        src[i] = (uint32_t)i * 2654435761u;
+    }
+
+    auto begin = Now();
+    Color32ToFloat4(dst.data(), src.data(), num);
+    auto end = Now();
+
+    int num_mismatch = 0;
+    for (int i = 0; i < num; ++i) {
+        if (!near_equal(dst[i], Color32ToFloat4(src[i]))) { ++num_mismatch; }
+    }
+    printf("    Color32ToFloat4: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+}
+RegisterTestEntry(TestColor32ToFloat4)
+
+void TestLimitWeights()
+{
+    // 0 - 12 influences per vertex
+    const int num_vertices = 1000000;
+    const int max_influences = 4;
+    RawVector<int> counts, bone_indices;
+    RawVector<float> bone_weights;
+    counts.resize_discard(num_vertices);
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        counts[vi] = (int)(((uint32_t)vi * 2654435761u) >> 16) % 13;
+        for (int ci = 0; ci < counts[vi]; ++ci) {
+            uint32_t h = (uint32_t)(bone_indices.size() + 1) * 2246822519u;
+            bone_indices.push_back(ci);
+            bone_weights.push_back((float)(h >> 8) / (float)(1 << 24));
+        }
+    }
+
+    RawVector<int> dst_counts, dst_indices;
+    RawVector<float> dst_weights;
+    auto begin = Now();
+    LimitWeights(dst_counts, dst_indices, dst_weights, counts, bone_indices, bone_weights, max_influences);
+    auto end = Now();
+
+    // reference: largest weights by partial sort. vertices with up to max_influences are not sorted
+    int num_mismatch = 0;
+    int si = 0, di = 0;
+    std::vector<std::pair<float, int>> tmp;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        int n = counts[vi];
+        int k = std::min(n, max_influences);
+        tmp.clear();
+        for (int ci = 0; ci < n; ++ci) { tmp.push_back({ bone_weights[si + ci], bone_indices[si + ci] }); }
+        if (n > k) { std::partial_sort(tmp.begin(), tmp.begin() + k, tmp.end(), std::greater<std::pair<float, int>>()); }
+
+        float total = 0.0f;
+        for (int ci = 0; ci < k; ++ci) { total += tmp[ci].first; }
+        float scale = n > k ? 1.0f / total : 1.0f;
+
+        bool match = dst_counts[vi] == k;
+        for (int ci = 0; match && ci < k; ++ci) {
+            match = dst_indices[di + ci] == tmp[ci].second && near_equal(dst_weights[di + ci], tmp[ci].first * scale);
+        }
+        if (!match) { ++num_mismatch; }
+        si += n;
+        di += dst_counts[vi];
+    }
+    printf("    LimitWeights: %.2fms (%d mismatches)\n", NS2MS(end - begin), num_mismatch);
+}
+RegisterTestEntry(TestLimitWeights)
+
+template<int N>
+static void TestGenerateWeightsN(int bones_per_vertex)
+{
+    const int num_vertices = 1000000;
+    RawVector<int> bone_indices;
+    RawVector<float> bone_weights;
+    bone_indices.resize_discard(num_vertices * bones_per_vertex);
+    bone_weights.resize_discard(num_vertices * bones_per_vertex);
+    for (int i = 0; i < (int)bone_indices.size(); ++i) {
+        uint32_t h = (uint32_t)(i + 1) * 2246822519u;
+        bone_indices[i] = i % bones_per_vertex;
+        bone_weights[i] = (float)(h >> 8) / (float)(1 << 24);
+    }
+
+    RawVector<Weights<N>> weights;
+    auto begin = Now();
+    GenerateWeightsN(weights, bone_indices, bone_weights, bones_per_vertex);
+    auto end = Now();
+
+    // reference: largest weights by partial sort
+    int num_mismatch = 0;
+    std::vector<std::pair<float, int>> tmp;
+    for (int vi = 0; vi < num_vertices; ++vi) {
+        int si = bones_per_vertex * vi;
+        tmp.clear();
+        for (int ci = 0; ci < bones_per_vertex; ++ci) { tmp.push_back({ bone_weights[si + ci], bone_indices[si + ci] }); }
+        std::partial_sort(tmp.begin(), tmp.begin() + N, tmp.end(), std::greater<std::pair<float, int>>());
+
+        float total = 0.0f;
+        for (int ci = 0; ci < N; ++ci) { total += tmp[ci].first; }
+
+        bool match = true;
+        for (int ci = 0; match && ci < N; ++ci) {
+            match = weights[vi].indices[ci] == tmp[ci].second && near_equal(weights[vi].weights[ci], tmp[ci].first / total);
+        }
+        if (!match) { ++num_mismatch; }
+    }
+    printf("    GenerateWeightsN %d -> %d: %.2fms (%d mismatches)\n", bones_per_vertex, N, NS2MS(end - begin), num_mismatch);
+}
+
+void TestGenerateWeights()
+{
+    TestGenerateWeightsN<4>(6);
+    TestGenerateWeightsN<4>(8);
+    TestGenerateWeightsN<4>(16);
+    TestGenerateWeightsN<8>(16);
+    TestGenerateWeightsN<8>(12);
+    TestGenerateWeightsN<4>(20);
+}
+RegisterTestEntry(TestGenerateWeights)
+
+template<class T>
+static void CompareSIMDResult(const char *kernel, const char *variant, const RawVector<T>& expected, const RawVector<T>& actual)
+{
+    int num_mismatch = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (!near_equal(expected[i], actual[i])) { ++num_mismatch; }
+    }
+    printf("    %s %s: %d mismatches\n", kernel, variant, num_mismatch);
+}
+static void CompareSIMDResult(const char *kernel, const char *variant, const RawVector<int>& expected, const RawVector<int>& actual)
+{
+    int num_mismatch = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] != actual[i]) { ++num_mismatch; }
+    }
+    printf("    %s %s: %d mismatches\n", kernel, variant, num_mismatch);
+}
+
+template<int N>
+static void CompareSIMDResult(const char *kernel, const char *variant, const RawVector<Weights<N>>& expected, const RawVector<Weights<N>>& actual)
+{
+    int num_mismatch = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (memcmp(&expected[i], &actual[i], sizeof(Weights<N>)) != 0) { ++num_mismatch; }
+    }
+    printf("    %s %s: %d mismatches\n", kernel, variant, num_mismatch);
+}
+
+// compares the SSE and ISPC variants of muSIMD kernels with the _Generic ones.
+// ISPC variants are compared only if they are enabled in muSIMDConfig.h.
+void TestSIMDKernels()
+{
+    const int num = 100003;
+    const int w = 317, h = 317;
+    RawVector<float3> points, normals, expected3, actual3;
+    RawVector<float2> uv;
+    RawVector<float4> expected4, actual4;
+    RawVector<float> heights;
+    RawVector<int> indices, expected_i, actual_i;
+    RawVector<uint16_t> indices16;
+    RawVector<uint32_t> colors;
+    points.resize_discard(num);
+    normals.resize_discard(num);
+    uv.resize_discard(num);
+    heights.resize_discard(w * h);
+    colors.resize_discard(num);
+    indices.resize_discard(num * 3);
+    indices16.resize_discard(num * 3);
+    for (int i = 0; i < num; ++i) {
+        float f = (float)i;
+        points[i] = { std::sin(f * 0.1f), std::cos(f * 0.07f), std::sin(f * 0.013f) * 2.0f };
+        normals[i] = normalize(points[i] + float3{ 0.0f, 0.0f, 3.0f });
+        uv[i] = { std::cos(f * 0.03f), std::sin(f * 0.05f) };
+        colors[i] = (uint32_t)i * 2654435761u;
+    }
+    for (int i = 0; i < num * 3; ++i) {
+        indices[i] = (int)(((uint32_t)i * 2246822519u) % (uint32_t)num);
+        indices16[i] = (uint16_t)((uint32_t)i * 2246822519u);
+    }
+    for (int i = 0; i < w * h; ++i) {
+        heights[i] = std::sin((float)(i % w) * 0.05f) * std::cos((float)(i / w) * 0.03f);
+    }
+    float4x4 m = to_mat4x4(rotate(normalize(float3{ 1.0f, 2.0f, 3.0f }), 0.5f));
+    m[3] = { 1.0f, 2.0f, 3.0f, 1.0f };
+
+    // InvertX
+    expected3 = points;
+    InvertX_Generic(expected3.data(), num);
+#ifdef muEnableSSE
+    actual3 = points;
+    InvertX_SSE(actual3.data(), num);
+    CompareSIMDResult("InvertX", "SSE", expected3, actual3);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_InvertX3)
+    actual3 = points;
+    InvertX_ISPC(actual3.data(), num);
+    CompareSIMDResult("InvertX", "ISPC", expected3, actual3);
+#endif
+
+    // Scale
+    expected3 = points;
+    Scale_Generic(expected3.data(), 1.5f, num);
+#if defined(muEnableISPC) && defined(muSIMD_Scale)
+    actual3 = points;
+    Scale_ISPC(actual3.data(), 1.5f, num);
+    CompareSIMDResult("Scale", "ISPC", expected3, actual3);
+#endif
+
+    // Normalize
+    expected3 = points;
+    Normalize_Generic(expected3.data(), num);
+#ifdef muEnableSSE
+    actual3 = points;
+    Normalize_SSE(actual3.data(), num);
+    CompareSIMDResult("Normalize", "SSE", expected3, actual3);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_Normalize)
+    actual3 = points;
+    Normalize_ISPC(actual3.data(), num);
+    CompareSIMDResult("Normalize", "ISPC", expected3, actual3);
+#endif
+
+    // MinMax
+    {
+        RawVector<float3> expected_mm(2), actual_mm(2);
+        MinMax_Generic(points.data(), num, expected_mm[0], expected_mm[1]);
+#ifdef muEnableSSE
+        MinMax_SSE(points.data(), num, actual_mm[0], actual_mm[1]);
+        CompareSIMDResult("MinMax", "SSE", expected_mm, actual_mm);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_MinMax3)
+        MinMax_ISPC(points.data(), num, actual_mm[0], actual_mm[1]);
+        CompareSIMDResult("MinMax", "ISPC", expected_mm, actual_mm);
+#endif
+    }
+
+    // MulPoints / MulVectors
+    expected3.resize_discard(num);
+    actual3.resize_discard(num);
+    MulPoints_Generic(m, points.data(), expected3.data(), num);
+#ifdef muEnableSSE
+    MulPoints_SSE(m, points.data(), actual3.data(), num);
+    CompareSIMDResult("MulPoints", "SSE", expected3, actual3);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_MulPoints3)
+    MulPoints_ISPC(m, points.data(), actual3.data(), num);
+    CompareSIMDResult("MulPoints", "ISPC", expected3, actual3);
+#endif
+    MulVectors_Generic(m, points.data(), expected3.data(), num);
+#ifdef muEnableSSE
+    MulVectors_SSE(m, points.data(), actual3.data(), num);
+    CompareSIMDResult("MulVectors", "SSE", expected3, actual3);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_MulVectors3)
+    MulVectors_ISPC(m, points.data(), actual3.data(), num);
+    CompareSIMDResult("MulVectors", "ISPC", expected3, actual3);
+#endif
+
+    // GenerateNormalsTriangleIndexed
+    GenerateNormalsTriangleIndexed_Generic(expected3.data(), points.data(), indices.data(), num, num);
+#ifdef muEnableSSE
+    GenerateNormalsTriangleIndexed_SSE(actual3.data(), points.data(), indices.data(), num, num);
+    CompareSIMDResult("GenerateNormalsTriangleIndexed", "SSE", expected3, actual3);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_GenerateNormalsTriangleIndexed)
+    GenerateNormalsTriangleIndexed_ISPC(actual3.data(), points.data(), indices.data(), num, num);
+    CompareSIMDResult("GenerateNormalsTriangleIndexed", "ISPC", expected3, actual3);
+#endif
+
+    // GenerateTangentsTriangleIndexed
+    expected4.resize_discard(num);
+    actual4.resize_discard(num);
+    GenerateTangentsTriangleIndexed_Generic(expected4.data(), points.data(), uv.data(), normals.data(), indices.data(), num, num);
+#ifdef muEnableSSE
+    GenerateTangentsTriangleIndexed_SSE(actual4.data(), points.data(), uv.data(), normals.data(), indices.data(), num, num);
+    CompareSIMDResult("GenerateTangentsTriangleIndexed", "SSE", expected4, actual4);
+#endif
+#if defined(muEnableISPC) && defined(muSIMD_GenerateTangentsTriangleIndexed)
+    GenerateTangentsTriangleIndexed_ISPC(actual4.data(), points.data(), uv.data(), normals.data(), indices.data(), num, num);
+    CompareSIMDResult("GenerateTangentsTriangleIndexed", "ISPC", expected4, actual4);
+#endif
+
+    // RayTrianglesIntersectionSoA. rays along z through a layer of small triangles. some triangles are duplicated
+    // to check that the first of equally near hits is returned
+    {
+        const int num_triangles = 4099, num_rays = 512;
+        RawVector<float> v[9];
+        for (auto& a : v) { a.resize_discard(num_triangles); }
+        for (int ti = 0; ti < num_triangles; ++ti) {
+            int si = ti % 7 == 6 ? ti - 3 : ti;
+            float3 c = { std::sin(si * 0.37f), std::cos(si * 0.53f), std::sin(si * 0.11f) * 0.5f };
+            for (int k = 0; k < 3; ++k) {
+                float a = (float)k * 2.0944f + (float)si;
+                v[k * 3 + 0][ti] = c.x + std::cos(a) * 0.2f;
+                v[k * 3 + 1][ti] = c.y + std::sin(a) * 0.2f;
+                v[k * 3 + 2][ti] = c.z + std::sin(a * 3.0f) * 0.05f;
+            }
+        }
+        RawVector<int> expected_hit(num_rays * 2), actual_hit(num_rays * 2);
+        RawVector<float> expected_d(num_rays), actual_d(num_rays);
+        for (int ri = 0; ri < num_rays; ++ri) {
+            float3 pos = { std::sin(ri * 0.29f), std::cos(ri * 0.71f), -2.0f };
+            float3 dir = normalize(float3{ std::sin(ri * 0.13f) * 0.1f, 0.0f, 1.0f });
+            int count = num_triangles - ri % 4; // remainders
+            expected_hit[ri * 2 + 1] = -1;
+            expected_hit[ri * 2 + 0] = RayTrianglesIntersectionSoA_Generic(pos, dir, v[0].data(), v[1].data(), v[2].data(),
+                v[3].data(), v[4].data(), v[5].data(), v[6].data(), v[7].data(), v[8].data(), count, expected_hit[ri * 2 + 1], expected_d[ri]);
+#ifdef muEnableSSE
+            actual_hit[ri * 2 + 1] = -1;
+            actual_hit[ri * 2 + 0] = RayTrianglesIntersectionSoA_SSE(pos, dir, v[0].data(), v[1].data(), v[2].data(),
+                v[3].data(), v[4].data(), v[5].data(), v[6].data(), v[7].data(), v[8].data(), count, actual_hit[ri * 2 + 1], actual_d[ri]);
+#endif
+        }
+#ifdef muEnableSSE
+        CompareSIMDResult("RayTrianglesIntersectionSoA", "SSE", expected_hit, actual_hit);
+        CompareSIMDResult("RayTrianglesIntersectionSoA distance", "SSE", expected_d, actual_d);
+#endif
+    }
+
+    // SmoothNormalsFan. fans of 1 to 15 faces with normals around the vertex normal
+    {
+        const int num_fans = 256;
+        RawVector<float> nx, ny, nz;
+        RawVector<int> fan_indices;
+        expected3.resize_discard(num_fans * 15);
+        actual3.resize_discard(num_fans * 15);
+        for (int fi = 0; fi < num_fans; ++fi) {
+            int count = fi % 15 + 1;
+            nx.resize_discard(count);
+            ny.resize_discard(count);
+            nz.resize_discard(count);
+            fan_indices.resize_discard(count);
+            for (int i = 0; i < count; ++i) {
+                float3 n = normalize(normals[(fi * 15 + i) % num] + float3{ 0.0f, 0.0f, 1.0f } * (float)(i % 3));
+                nx[i] = n.x; ny[i] = n.y; nz[i] = n.z;
+                fan_indices[i] = fi * 15 + count - 1 - i;
+            }
+            float threshold = std::cos((float)(fi % 7 + 1) * 10.0f * Deg2Rad);
+            SmoothNormalsFan_Generic(expected3.data(), fan_indices.data(), nx.data(), ny.data(), nz.data(), count, threshold);
+#ifdef muEnableSSE
+            SmoothNormalsFan_SSE(actual3.data(), fan_indices.data(), nx.data(), ny.data(), nz.data(), count, threshold);
+#endif
+        }
+#ifdef muEnableSSE
+        CompareSIMDResult("SmoothNormalsFan", "SSE", expected3, actual3);
+#endif
+    }
+
+    // GenerateHeightmapRow
+    {
+        RawVector<float2> expected_uv, actual_uv;
+        expected3.resize_discard(w * h);
+        actual3.resize_discard(w * h);
+        expected_uv.resize_discard(w * h);
+        actual_uv.resize_discard(w * h);
+        float3 unit = { 0.5f, 2.0f, 0.25f };
+        float2 uv_unit = { 1.0f / (w - 1), 1.0f / (h - 1) };
+        for (int z = 0; z < h; ++z) {
+            GenerateHeightmapRow_Generic(&expected3[z * w], &expected_uv[z * w], &heights[z * w], w, 0, z, unit, uv_unit);
+        }
+#ifdef muEnableSSE
+        for (int z = 0; z < h; ++z) {
+            GenerateHeightmapRow_SSE(&actual3[z * w], &actual_uv[z * w], &heights[z * w], w, 0, z, unit, uv_unit);
+        }
+        CompareSIMDResult("GenerateHeightmapRow", "SSE", expected3, actual3);
+        CompareSIMDResult("GenerateHeightmapRow uv", "SSE", expected_uv, actual_uv);
+#endif
+    }
+
+    // GenerateHeightmapNormalsRow
+    expected3.resize_discard(w * h);
+    actual3.resize_discard(w * h);
+    for (int z = 0; z < h; ++z) {
+        const float *prev = &heights[std::max(z - 1, 0) * w];
+        const float *next = &heights[std::min(z + 1, h - 1) * w];
+        GenerateHeightmapNormalsRow_Generic(&expected3[z * w], prev, &heights[z * w], next, w, 2.0f, 0.5f, 0.5f);
+    }
+#ifdef muEnableSSE
+    for (int z = 0; z < h; ++z) {
+        const float *prev = &heights[std::max(z - 1, 0) * w];
+        const float *next = &heights[std::min(z + 1, h - 1) * w];
+        GenerateHeightmapNormalsRow_SSE(&actual3[z * w], prev, &heights[z * w], next, w, 2.0f, 0.5f, 0.5f);
+    }
+    CompareSIMDResult("GenerateHeightmapNormalsRow", "SSE", expected3, actual3);
+#endif
+
+    // WidenIndices
+    expected_i.resize_discard(num * 3);
+    actual_i.resize_discard(num * 3);
+    WidenIndices_Generic(expected_i.data(), indices16.data(), num * 3);
+#ifdef muEnableSSE
+    WidenIndices_SSE(actual_i.data(), indices16.data(), num * 3);
+    CompareSIMDResult("WidenIndices", "SSE", expected_i, actual_i);
+#endif
+
+    // Color32ToFloat4
+    Color32ToFloat4_Generic(expected4.data(), colors.data(), num);
+#ifdef muEnableSSE
+    Color32ToFloat4_SSE(actual4.data(), colors.data(), num);
+    CompareSIMDResult("Color32ToFloat4", "SSE", expected4, actual4);
+#endif
+
+    // SelectWeights. 16 influences per vertex, the first 8 of them are used by 8To4
+    {
+        RawVector<int> bone_indices;
+        RawVector<float> bone_weights;
+        bone_indices.resize_discard(num * 16);
+        bone_weights.resize_discard(num * 16);
+        for (int i = 0; i < num * 16; ++i) {
+            bone_indices[i] = i % 16;
+            bone_weights[i] = (float)(((uint32_t)(i + 1) * 2246822519u) >> 8) / (float)(1 << 24);
+        }
+        RawVector<int> indices8;
+        RawVector<float> weights8;
+        indices8.resize_discard(num * 8);
+        weights8.resize_discard(num * 8);
+        for (int vi = 0; vi < num; ++vi) {
+            for (int ci = 0; ci < 8; ++ci) {
+                indices8[vi * 8 + ci] = bone_indices[vi * 16 + ci];
+                weights8[vi * 8 + ci] = bone_weights[vi * 16 + ci];
+            }
+        }
+
+        RawVector<Weights<4>> expected_w4, actual_w4;
+        RawVector<Weights<8>> expected_w8, actual_w8;
+        expected_w4.resize_discard(num);
+        actual_w4.resize_discard(num);
+        expected_w8.resize_discard(num);
+        actual_w8.resize_discard(num);
+
+        SelectWeights8To4_Generic(expected_w4.data(), indices8.data(), weights8.data(), num);
+#ifdef muEnableSSE
+        SelectWeights8To4_SSE(actual_w4.data(), indices8.data(), weights8.data(), num);
+        CompareSIMDResult("SelectWeights8To4", "SSE", expected_w4, actual_w4);
+#endif
+
+        SelectWeights16To4_Generic(expected_w4.data(), bone_indices.data(), bone_weights.data(), num);
+#ifdef muEnableSSE
+        SelectWeights16To4_SSE(actual_w4.data(), bone_indices.data(), bone_weights.data(), num);
+        CompareSIMDResult("SelectWeights16To4", "SSE", expected_w4, actual_w4);
+#endif
+
+        SelectWeights16To8_Generic(expected_w8.data(), bone_indices.data(), bone_weights.data(), num);
+#ifdef muEnableSSE
+        SelectWeights16To8_SSE(actual_w8.data(), bone_indices.data(), bone_weights.data(), num);
+        CompareSIMDResult("SelectWeights16To8", "SSE", expected_w8, actual_w8);
+#endif
+    }
+}
+RegisterTestEntry(TestSIMDKernels)